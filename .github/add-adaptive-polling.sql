@@ -0,0 +1,47 @@
+-- ========================================================
+-- ADD ADAPTIVE COMMAND POLLING
+-- Run this in Supabase SQL Editor so devices can poll less while idle
+-- ========================================================
+--
+-- Devices no longer poll device_commands every 3 s. They poll every
+-- ~2 s for a minute after activity, then back off to one poll per ~30 s,
+-- with ±20% jitter. Activity means a command, a pushed pending card, or
+-- an admin viewing the device.
+--
+-- Poll: GET /rest/v1/rpc/poll_device_commands?device=<device_id>
+--   {"cmds": [oldest PENDING command, if any], "admin": true | false}
+-- "admin" is true while the dashboard has touched devices.admin_seen_at
+-- in the last 60 s. Firmware falls back to querying device_commands
+-- directly when this function is missing.
+--
+-- device_health.cmd_poll_interval_ms: the device's current base interval.
+
+ALTER TABLE devices ADD COLUMN IF NOT EXISTS admin_seen_at TIMESTAMPTZ;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS cmd_poll_interval_ms INTEGER;
+
+CREATE OR REPLACE FUNCTION poll_device_commands(device TEXT)
+RETURNS JSONB AS $$
+  SELECT jsonb_build_object(
+    'cmds', COALESCE((
+      SELECT jsonb_agg(c)
+      FROM (
+        SELECT id, type, uid, payload
+        FROM device_commands
+        WHERE device_id = device AND status = 'PENDING'
+        ORDER BY created_at ASC
+        LIMIT 1
+      ) c
+    ), '[]'::jsonb),
+    'admin', COALESCE((
+      SELECT admin_seen_at > NOW() - INTERVAL '60 seconds'
+      FROM devices
+      WHERE device_id = device
+    ), false)
+  );
+$$ LANGUAGE sql STABLE;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ poll_device_commands() + devices.admin_seen_at + device_health.cmd_poll_interval_ms added!';
+END $$;
@@ -0,0 +1,18 @@
+-- ========================================================
+-- ADD BOOT TIMINGS COLUMN TO device_health
+-- Run this in Supabase SQL Editor to store boot phase timings
+-- ========================================================
+--
+-- boot_timings: ms since reset at which each boot phase completed,
+-- sent once per boot with the static health fields:
+--   {"setup", "hardware", "access_task", "rfid_ready", "first_poll",
+--    "logstore", "network", "cloud_ready": ms}
+-- first_poll is when the reader starts accepting cards (target 300 ms).
+
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS boot_timings JSONB;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_health boot_timings column added!';
+END $$;
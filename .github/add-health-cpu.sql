@@ -0,0 +1,26 @@
+-- ========================================================
+-- ADD CPU + LOOP PROFILE COLUMNS TO device_health
+-- Run this in Supabase SQL Editor to store CPU accounting
+-- ========================================================
+--
+-- cpu_core0_load / cpu_core1_load: % of the push window each core spent
+--   outside its IDLE task (FreeRTOS run-time stats)
+-- cpu_idle_percent: average idle share across both cores
+-- loop_profile: iteration timing of the access task and loop(), per
+--   ~60 s window (sent early when a loop stalls):
+--   {"access"|"cloud": {"n", "avg_us", "max_us", "max_stage",
+--     "max_stage_us", "window_ms",
+--     "hist": [<1ms, <2, <5, <10, <20, <50, <100, <500, >=500ms],
+--     "stages": [{"name", "total_us", "max_us"}]}}
+-- tasks[].cpu_percent rides in the existing tasks JSON column.
+
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS cpu_core0_load SMALLINT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS cpu_core1_load SMALLINT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS cpu_idle_percent SMALLINT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS loop_profile JSONB;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_health CPU / loop profile columns added!';
+END $$;
@@ -0,0 +1,74 @@
+-- ========================================================
+-- ADD DEVICE HEALTH HISTORY
+-- Run this in Supabase SQL Editor to add device_health_history
+-- ========================================================
+--
+-- device_health keeps only the latest state. Devices also sample a
+-- compact record every 10 s into a local ring (spilled to flash while
+-- offline) and upload it in batches here, so an incident keeps the
+-- heap / RSSI / reader / voltage trajectory that led up to it.
+--
+-- Upload: POST /rest/v1/rpc/ingest_health_samples
+--   {"batch": {"d": device_id, "b": first epoch (UTC seconds),
+--              "t": [seconds since previous sample, first is 0],
+--              "h": [free heap bytes], "l": [largest block KB],
+--              "m": [min free heap KB], "r": [rssi dBm], "v": [3V3 mV],
+--              "f": [flags: 1 wifi, 2 ntp, 4 rfid ok],
+--              "n": [rfid reinits], "w": [wifi disconnects]}}
+
+CREATE TABLE IF NOT EXISTS device_health_history (
+  id BIGSERIAL PRIMARY KEY,
+  device_id TEXT NOT NULL REFERENCES devices(device_id) ON DELETE CASCADE,
+  sampled_at TIMESTAMPTZ NOT NULL,
+  free_heap_bytes INTEGER,
+  largest_free_block_kb INTEGER,
+  min_free_heap_kb INTEGER,
+  wifi_rssi SMALLINT,
+  voltage_mv INTEGER,
+  wifi_connected BOOLEAN,
+  ntp_synced BOOLEAN,
+  rfid_ok BOOLEAN,
+  rfid_reinit_count INTEGER,
+  wifi_disconnect_count INTEGER
+);
+
+CREATE INDEX IF NOT EXISTS idx_device_health_history_device
+ON device_health_history (device_id, sampled_at DESC);
+
+CREATE OR REPLACE FUNCTION ingest_health_samples(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'t');
+
+  INSERT INTO device_health_history (
+    device_id, sampled_at, free_heap_bytes, largest_free_block_kb,
+    min_free_heap_kb, wifi_rssi, voltage_mv, wifi_connected, ntp_synced,
+    rfid_ok, rfid_reinit_count, wifi_disconnect_count
+  )
+  SELECT
+    batch->>'d',
+    to_timestamp((batch->>'b')::BIGINT + SUM(r.dt::BIGINT) OVER (ORDER BY r.i)),
+    (batch->'h'->>(r.i - 1)::INT)::INT,
+    (batch->'l'->>(r.i - 1)::INT)::INT,
+    (batch->'m'->>(r.i - 1)::INT)::INT,
+    (batch->'r'->>(r.i - 1)::INT)::SMALLINT,
+    (batch->'v'->>(r.i - 1)::INT)::INT,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 1) <> 0,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 2) <> 0,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 4) <> 0,
+    (batch->'n'->>(r.i - 1)::INT)::INT,
+    (batch->'w'->>(r.i - 1)::INT)::INT
+  FROM jsonb_array_elements_text(batch->'t') WITH ORDINALITY AS r(dt, i);
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_health_history + ingest_health_samples() added!';
+END $$;
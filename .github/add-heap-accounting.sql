@@ -0,0 +1,22 @@
+-- ========================================================
+-- ADD HEAP ACCOUNTING COLUMNS TO device_health
+-- Run this in Supabase SQL Editor to store heap pressure data
+-- ========================================================
+--
+-- heap_level: NORMAL | WARN | CRIT (device sheds cloud work at WARN/CRIT)
+-- heap_frag_permille: 1000 * (1 - largest free block / free heap)
+-- heap_frag_trend: fragmentation slope, permille per hour
+-- heap_tags: per-subsystem accounting, sent with the loop profile:
+--   {"cloud_http"|"json"|"logging"|"access":
+--     {"live": bytes, "peak": bytes, "allocs": n, "rate": bytes/min}}
+
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS heap_level TEXT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS heap_frag_permille SMALLINT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS heap_frag_trend SMALLINT;
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS heap_tags JSONB;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_health heap accounting columns added!';
+END $$;
@@ -0,0 +1,44 @@
+-- ========================================================
+-- ADD COLUMNAR LOG INGESTION
+-- Run this in Supabase SQL Editor to add ingest_access_logs()
+-- ========================================================
+--
+-- Devices upload log batches column by column instead of one JSON
+-- object per row:
+--   POST /rest/v1/rpc/ingest_access_logs
+--   {"batch": {"d": device_id, "b": base epoch (UTC seconds),
+--              "u": [uid dictionary],
+--              "t": [seconds since previous row, first is 0],
+--              "k": [index into u], "e": [event code]}}
+-- Event codes: 0 GRANTED, 1 DENIED, 2 PENDING, 3 REMOTE.
+-- Returns the number of rows inserted. Firmware falls back to plain
+-- row inserts while this function is missing.
+
+CREATE OR REPLACE FUNCTION ingest_access_logs(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'t');
+  IF jsonb_array_length(batch->'k') <> n OR jsonb_array_length(batch->'e') <> n THEN
+    RAISE EXCEPTION 'ingest_access_logs: column lengths differ';
+  END IF;
+
+  INSERT INTO access_logs (device_id, uid, event_type, logged_at)
+  SELECT
+    batch->>'d',
+    batch->'u'->>((batch->'k'->>(r.i - 1)::INT)::INT),
+    (ARRAY['GRANTED', 'DENIED', 'PENDING', 'REMOTE'])[(batch->'e'->>(r.i - 1)::INT)::INT + 1],
+    to_timestamp((batch->>'b')::BIGINT + SUM(r.dt::BIGINT) OVER (ORDER BY r.i))
+  FROM jsonb_array_elements_text(batch->'t') WITH ORDINALITY AS r(dt, i);
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ ingest_access_logs() added!';
+END $$;
@@ -0,0 +1,49 @@
+-- ========================================================
+-- ADD MULTI-DOOR SUPPORT
+-- Run this in Supabase SQL Editor so one device can report several doors
+-- ========================================================
+--
+-- access_logs.door_id: index of the door on its device (0 for
+-- single-door installs and rows logged before this change).
+-- ingest_access_logs() accepts an optional "dr" column with one door per
+-- row; devices only send it when a batch has a door other than 0.
+-- REMOTE_UNLOCK takes an optional payload {"door": n} (default 0); the
+-- device acks REMOTE_UNLOCK_BAD_DOOR for a door it doesn't have.
+
+ALTER TABLE access_logs ADD COLUMN IF NOT EXISTS door_id SMALLINT NOT NULL DEFAULT 0;
+
+CREATE OR REPLACE FUNCTION ingest_access_logs(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'t');
+  IF jsonb_array_length(batch->'k') <> n OR jsonb_array_length(batch->'e') <> n THEN
+    RAISE EXCEPTION 'ingest_access_logs: column lengths differ';
+  END IF;
+  IF batch ? 'dr' AND jsonb_array_length(batch->'dr') <> n THEN
+    RAISE EXCEPTION 'ingest_access_logs: column lengths differ';
+  END IF;
+
+  INSERT INTO access_logs (device_id, uid, event_type, logged_at, door_id)
+  SELECT
+    batch->>'d',
+    batch->'u'->>((batch->'k'->>(r.i - 1)::INT)::INT),
+    (ARRAY['GRANTED', 'DENIED', 'PENDING', 'REMOTE'])[(batch->'e'->>(r.i - 1)::INT)::INT + 1],
+    to_timestamp((batch->>'b')::BIGINT + SUM(r.dt::BIGINT) OVER (ORDER BY r.i)),
+    COALESCE((batch->'dr'->>(r.i - 1)::INT)::SMALLINT, 0)
+  FROM jsonb_array_elements_text(batch->'t') WITH ORDINALITY AS r(dt, i);
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE INDEX IF NOT EXISTS idx_access_logs_door
+ON access_logs (device_id, door_id, logged_at DESC);
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ Multi-door support added (access_logs.door_id, ingest_access_logs dr column)!';
+END $$;
@@ -0,0 +1,92 @@
+-- ========================================================
+-- ADD PENDING CARD PUSH
+-- Run this in Supabase SQL Editor so devices report new cards immediately
+-- ========================================================
+--
+-- A card the device records as pending for the first time is pushed here
+-- within a second instead of waiting for GET_PENDING. Cards tapped
+-- together arrive in one call.
+--
+-- Upload: POST /rest/v1/rpc/report_pending_cards
+--   {"batch": {"d": device_id, "u": [uids], "dr": [door index],
+--              "t": [epoch seconds, 0 = device clock not set yet]}}
+--
+-- Rows disappear once the card is decided: WHITELIST_ADD, BLACKLIST_ADD
+-- or REMOVE_UID acked for that UID, or SYNC_UIDS (which clears pending on
+-- the device). NVS on the device stays the source of truth; GET_PENDING
+-- still returns the full list.
+
+CREATE TABLE IF NOT EXISTS device_pending_reports (
+  id UUID PRIMARY KEY DEFAULT gen_random_uuid(),
+  device_id TEXT NOT NULL REFERENCES devices(device_id) ON DELETE CASCADE,
+  uid TEXT NOT NULL,
+  created_at TIMESTAMPTZ DEFAULT NOW()
+);
+
+ALTER TABLE device_pending_reports ADD COLUMN IF NOT EXISTS door_id SMALLINT NOT NULL DEFAULT 0;
+ALTER TABLE device_pending_reports ADD COLUMN IF NOT EXISTS last_seen_at TIMESTAMPTZ DEFAULT NOW();
+
+-- Earlier copies of this table allowed duplicates: keep the newest row
+DELETE FROM device_pending_reports a
+USING device_pending_reports b
+WHERE a.device_id = b.device_id
+  AND a.uid = b.uid
+  AND (a.created_at, a.id) < (b.created_at, b.id);
+
+CREATE UNIQUE INDEX IF NOT EXISTS uq_device_pending_reports
+ON device_pending_reports (device_id, uid);
+
+CREATE OR REPLACE FUNCTION report_pending_cards(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'u');
+  IF jsonb_array_length(batch->'dr') <> n OR jsonb_array_length(batch->'t') <> n THEN
+    RAISE EXCEPTION 'report_pending_cards: column lengths differ';
+  END IF;
+
+  INSERT INTO device_pending_reports (device_id, uid, door_id, created_at, last_seen_at)
+  SELECT
+    batch->>'d',
+    r.uid,
+    (batch->'dr'->>(r.i - 1)::INT)::SMALLINT,
+    COALESCE(to_timestamp(NULLIF((batch->'t'->>(r.i - 1)::INT)::BIGINT, 0)), NOW()),
+    COALESCE(to_timestamp(NULLIF((batch->'t'->>(r.i - 1)::INT)::BIGINT, 0)), NOW())
+  FROM jsonb_array_elements_text(batch->'u') WITH ORDINALITY AS r(uid, i)
+  ON CONFLICT (device_id, uid)
+  DO UPDATE SET door_id = EXCLUDED.door_id, last_seen_at = EXCLUDED.last_seen_at;
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Decided cards leave the pending view as soon as the device acks
+CREATE OR REPLACE FUNCTION clear_pending_reports_from_commands()
+RETURNS TRIGGER AS $$
+BEGIN
+  IF NEW.status = 'DONE' AND OLD.status <> 'DONE' THEN
+    IF NEW.type IN ('WHITELIST_ADD', 'BLACKLIST_ADD', 'REMOVE_UID') AND NEW.uid IS NOT NULL THEN
+      DELETE FROM device_pending_reports
+      WHERE device_id = NEW.device_id AND uid = NEW.uid;
+    ELSIF NEW.type = 'SYNC_UIDS' THEN
+      DELETE FROM device_pending_reports
+      WHERE device_id = NEW.device_id;
+    END IF;
+  END IF;
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+DROP TRIGGER IF EXISTS trg_clear_pending_reports ON device_commands;
+CREATE TRIGGER trg_clear_pending_reports
+AFTER UPDATE ON device_commands
+FOR EACH ROW
+EXECUTE FUNCTION clear_pending_reports_from_commands();
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_pending_reports + report_pending_cards() added!';
+END $$;
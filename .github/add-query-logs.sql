@@ -0,0 +1,35 @@
+-- ========================================================
+-- ADD QUERY_LOGS COMMAND TYPE
+-- Run this in Supabase SQL Editor to add QUERY_LOGS support
+-- ========================================================
+--
+-- QUERY_LOGS asks the device to search its own log segments:
+--   uid     = card to look for (NULL = any card)
+--   payload = {"from": epoch | timestamp, "to": epoch | timestamp,
+--              "cursor": "seq:offset", "limit": 1..50}
+-- result  = {"records":[{"t","e","u","i"}...], "next": "seq:offset" | null,
+--            "scanned": n, "skipped": n, "ms": n}
+-- Pass "next" back as "cursor" to fetch the following page.
+
+-- First, drop the existing constraint
+ALTER TABLE device_commands DROP CONSTRAINT IF EXISTS type_check;
+
+-- Add new constraint with QUERY_LOGS
+ALTER TABLE device_commands ADD CONSTRAINT type_check CHECK (
+  type IN (
+    'REMOTE_UNLOCK',
+    'WHITELIST_ADD',
+    'BLACKLIST_ADD',
+    'REMOVE_UID',
+    'GET_PENDING',
+    'SYNC_UIDS',
+    'SYNC_LOGS',
+    'QUERY_LOGS'
+  )
+);
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ QUERY_LOGS command type added!';
+END $$;
@@ -0,0 +1,18 @@
+-- ========================================================
+-- ADD PER-READER RFID STATS TO device_health
+-- Run this in Supabase SQL Editor for devices with several PN532 readers
+-- ========================================================
+--
+-- rfid_readers: one entry per reader, sent with the loop profile by
+-- devices with more than one reader:
+--   [{"door": door index (255 = unbound), "irq": IRQ-driven,
+--     "ok": communicating, "polls": n, "reinits": n, "taps": n}]
+-- The rfid_* columns keep reporting all readers combined.
+
+ALTER TABLE device_health ADD COLUMN IF NOT EXISTS rfid_readers JSONB;
+
+-- Success message
+DO $$
+BEGIN
+  RAISE NOTICE '✅ device_health rfid_readers column added!';
+END $$;
@@ -13,12 +13,19 @@ CREATE EXTENSION IF NOT EXISTS "pgcrypto";
 -- --------------------------------------------------------
 DROP TRIGGER IF EXISTS trg_sync_device_uids ON device_commands;
 DROP TRIGGER IF EXISTS trg_set_acked_at ON device_commands;
+DROP TRIGGER IF EXISTS trg_clear_pending_reports ON device_commands;
 
 DROP FUNCTION IF EXISTS sync_device_uids_from_commands();
 DROP FUNCTION IF EXISTS set_acked_at();
+DROP FUNCTION IF EXISTS clear_pending_reports_from_commands();
+DROP FUNCTION IF EXISTS ingest_access_logs(JSONB);
+DROP FUNCTION IF EXISTS ingest_health_samples(JSONB);
+DROP FUNCTION IF EXISTS report_pending_cards(JSONB);
+DROP FUNCTION IF EXISTS poll_device_commands(TEXT);
 
 DROP VIEW IF EXISTS device_overview;
 
+DROP TABLE IF EXISTS device_health_history CASCADE;
 DROP TABLE IF EXISTS device_pending_reports CASCADE;
 DROP TABLE IF EXISTS device_uids CASCADE;
 DROP TABLE IF EXISTS device_commands CASCADE;
@@ -30,7 +37,8 @@ CREATE TABLE devices (
   device_id TEXT PRIMARY KEY,
   created_at TIMESTAMPTZ DEFAULT NOW(),
   last_seen_at TIMESTAMPTZ,
-  notes TEXT
+  notes TEXT,
+  admin_seen_at TIMESTAMPTZ   -- dashboard has the device open (adaptive polling)
 );
 
 -- 3️⃣ DEVICE COMMANDS (Core Control Pipeline)
@@ -60,7 +68,9 @@ CREATE TABLE device_commands (
       'BLACKLIST_ADD',
       'REMOVE_UID',
       'GET_PENDING',
-      'SYNC_UIDS'
+      'SYNC_UIDS',
+      'SYNC_LOGS',
+      'QUERY_LOGS'
     )
   )
 );
@@ -72,6 +82,29 @@ ON device_commands (device_id, status, created_at);
 CREATE INDEX idx_device_commands_created 
 ON device_commands (created_at DESC);
 
+-- Device poll (see add-adaptive-polling.sql):
+-- {"cmds": [oldest PENDING command], "admin": dashboard open in the last 60 s}
+CREATE OR REPLACE FUNCTION poll_device_commands(device TEXT)
+RETURNS JSONB AS $$
+  SELECT jsonb_build_object(
+    'cmds', COALESCE((
+      SELECT jsonb_agg(c)
+      FROM (
+        SELECT id, type, uid, payload
+        FROM device_commands
+        WHERE device_id = device AND status = 'PENDING'
+        ORDER BY created_at ASC
+        LIMIT 1
+      ) c
+    ), '[]'::jsonb),
+    'admin', COALESCE((
+      SELECT admin_seen_at > NOW() - INTERVAL '60 seconds'
+      FROM devices
+      WHERE device_id = device
+    ), false)
+  );
+$$ LANGUAGE sql STABLE;
+
 -- 4️⃣ DEVICE UIDs (Cloud Mirror of Whitelist/Blacklist)
 -- --------------------------------------------------------
 CREATE TABLE device_uids (
@@ -100,6 +133,7 @@ CREATE TABLE access_logs (
   uid TEXT NOT NULL,
   event_type TEXT NOT NULL,
   logged_at TIMESTAMPTZ DEFAULT NOW(),
+  door_id SMALLINT NOT NULL DEFAULT 0,   -- door index on the device
   
   CONSTRAINT event_type_check CHECK (
     event_type IN ('GRANTED', 'DENIED', 'PENDING', 'REMOTE')
@@ -109,6 +143,131 @@ CREATE TABLE access_logs (
 CREATE INDEX idx_access_logs_device 
 ON access_logs (device_id, logged_at DESC);
 
+CREATE INDEX idx_access_logs_door
+ON access_logs (device_id, door_id, logged_at DESC);
+
+-- Columnar batch upload from devices (see add-log-ingest.sql, add-multi-door.sql):
+-- {"d", "b": base epoch, "u": uids, "t": deltas, "k": uid index, "e": event code,
+--  "dr": door (optional, default 0)}
+CREATE OR REPLACE FUNCTION ingest_access_logs(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'t');
+  IF jsonb_array_length(batch->'k') <> n OR jsonb_array_length(batch->'e') <> n THEN
+    RAISE EXCEPTION 'ingest_access_logs: column lengths differ';
+  END IF;
+  IF batch ? 'dr' AND jsonb_array_length(batch->'dr') <> n THEN
+    RAISE EXCEPTION 'ingest_access_logs: column lengths differ';
+  END IF;
+
+  INSERT INTO access_logs (device_id, uid, event_type, logged_at, door_id)
+  SELECT
+    batch->>'d',
+    batch->'u'->>((batch->'k'->>(r.i - 1)::INT)::INT),
+    (ARRAY['GRANTED', 'DENIED', 'PENDING', 'REMOTE'])[(batch->'e'->>(r.i - 1)::INT)::INT + 1],
+    to_timestamp((batch->>'b')::BIGINT + SUM(r.dt::BIGINT) OVER (ORDER BY r.i)),
+    COALESCE((batch->'dr'->>(r.i - 1)::INT)::SMALLINT, 0)
+  FROM jsonb_array_elements_text(batch->'t') WITH ORDINALITY AS r(dt, i);
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Health history samples from devices (see add-health-history.sql)
+CREATE TABLE device_health_history (
+  id BIGSERIAL PRIMARY KEY,
+  device_id TEXT NOT NULL REFERENCES devices(device_id) ON DELETE CASCADE,
+  sampled_at TIMESTAMPTZ NOT NULL,
+  free_heap_bytes INTEGER,
+  largest_free_block_kb INTEGER,
+  min_free_heap_kb INTEGER,
+  wifi_rssi SMALLINT,
+  voltage_mv INTEGER,
+  wifi_connected BOOLEAN,
+  ntp_synced BOOLEAN,
+  rfid_ok BOOLEAN,
+  rfid_reinit_count INTEGER,
+  wifi_disconnect_count INTEGER
+);
+
+CREATE INDEX idx_device_health_history_device
+ON device_health_history (device_id, sampled_at DESC);
+
+CREATE OR REPLACE FUNCTION ingest_health_samples(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'t');
+
+  INSERT INTO device_health_history (
+    device_id, sampled_at, free_heap_bytes, largest_free_block_kb,
+    min_free_heap_kb, wifi_rssi, voltage_mv, wifi_connected, ntp_synced,
+    rfid_ok, rfid_reinit_count, wifi_disconnect_count
+  )
+  SELECT
+    batch->>'d',
+    to_timestamp((batch->>'b')::BIGINT + SUM(r.dt::BIGINT) OVER (ORDER BY r.i)),
+    (batch->'h'->>(r.i - 1)::INT)::INT,
+    (batch->'l'->>(r.i - 1)::INT)::INT,
+    (batch->'m'->>(r.i - 1)::INT)::INT,
+    (batch->'r'->>(r.i - 1)::INT)::SMALLINT,
+    (batch->'v'->>(r.i - 1)::INT)::INT,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 1) <> 0,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 2) <> 0,
+    ((batch->'f'->>(r.i - 1)::INT)::INT & 4) <> 0,
+    (batch->'n'->>(r.i - 1)::INT)::INT,
+    (batch->'w'->>(r.i - 1)::INT)::INT
+  FROM jsonb_array_elements_text(batch->'t') WITH ORDINALITY AS r(dt, i);
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+-- New pending cards pushed by devices (see add-pending-push.sql):
+-- {"d", "u": uids, "dr": door, "t": epoch (0 = device clock not set)}
+CREATE TABLE device_pending_reports (
+  id UUID PRIMARY KEY DEFAULT gen_random_uuid(),
+  device_id TEXT NOT NULL REFERENCES devices(device_id) ON DELETE CASCADE,
+  uid TEXT NOT NULL,
+  created_at TIMESTAMPTZ DEFAULT NOW(),
+  door_id SMALLINT NOT NULL DEFAULT 0,
+  last_seen_at TIMESTAMPTZ DEFAULT NOW()
+);
+
+CREATE UNIQUE INDEX uq_device_pending_reports
+ON device_pending_reports (device_id, uid);
+
+CREATE OR REPLACE FUNCTION report_pending_cards(batch JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+  n INTEGER;
+BEGIN
+  n := jsonb_array_length(batch->'u');
+  IF jsonb_array_length(batch->'dr') <> n OR jsonb_array_length(batch->'t') <> n THEN
+    RAISE EXCEPTION 'report_pending_cards: column lengths differ';
+  END IF;
+
+  INSERT INTO device_pending_reports (device_id, uid, door_id, created_at, last_seen_at)
+  SELECT
+    batch->>'d',
+    r.uid,
+    (batch->'dr'->>(r.i - 1)::INT)::SMALLINT,
+    COALESCE(to_timestamp(NULLIF((batch->'t'->>(r.i - 1)::INT)::BIGINT, 0)), NOW()),
+    COALESCE(to_timestamp(NULLIF((batch->'t'->>(r.i - 1)::INT)::BIGINT, 0)), NOW())
+  FROM jsonb_array_elements_text(batch->'u') WITH ORDINALITY AS r(uid, i)
+  ON CONFLICT (device_id, uid)
+  DO UPDATE SET door_id = EXCLUDED.door_id, last_seen_at = EXCLUDED.last_seen_at;
+
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
 -- 6️⃣ TRIGGER: Auto-set acked_at timestamp
 -- --------------------------------------------------------
 CREATE OR REPLACE FUNCTION set_acked_at()
@@ -192,6 +351,29 @@ AFTER UPDATE ON device_commands
 FOR EACH ROW
 EXECUTE FUNCTION sync_device_uids_from_commands();
 
+-- TRIGGER: Decided cards leave device_pending_reports on ACK
+-- --------------------------------------------------------
+CREATE OR REPLACE FUNCTION clear_pending_reports_from_commands()
+RETURNS TRIGGER AS $$
+BEGIN
+  IF NEW.status = 'DONE' AND OLD.status <> 'DONE' THEN
+    IF NEW.type IN ('WHITELIST_ADD', 'BLACKLIST_ADD', 'REMOVE_UID') AND NEW.uid IS NOT NULL THEN
+      DELETE FROM device_pending_reports
+      WHERE device_id = NEW.device_id AND uid = NEW.uid;
+    ELSIF NEW.type = 'SYNC_UIDS' THEN
+      DELETE FROM device_pending_reports
+      WHERE device_id = NEW.device_id;
+    END IF;
+  END IF;
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trg_clear_pending_reports
+AFTER UPDATE ON device_commands
+FOR EACH ROW
+EXECUTE FUNCTION clear_pending_reports_from_commands();
+
 -- 8️⃣ VIEW: Device Overview (for dashboard)
 -- --------------------------------------------------------
 CREATE OR REPLACE VIEW device_overview AS
@@ -208,9 +390,10 @@ GROUP BY d.device_id;
 DO $$
 BEGIN
   RAISE NOTICE '✅ Database reset complete!';
-  RAISE NOTICE '📋 Tables created: devices, device_commands, device_uids, access_logs';
-  RAISE NOTICE '⚡ Triggers active: auto-ack, auto-sync UIDs';
+  RAISE NOTICE '📋 Tables created: devices, device_commands, device_uids, access_logs, device_health_history, device_pending_reports';
+  RAISE NOTICE '⚡ Triggers active: auto-ack, auto-sync UIDs, clear pending reports';
   RAISE NOTICE '👀 View created: device_overview';
+  RAISE NOTICE '📥 Functions created: ingest_access_logs, ingest_health_samples, report_pending_cards, poll_device_commands';
   RAISE NOTICE '';
   RAISE NOTICE '🚀 Ready for ESP32 + Admin Dashboard';
 END $$;
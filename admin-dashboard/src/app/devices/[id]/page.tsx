@@ -21,6 +21,7 @@ import {
   sendBlacklistAdd,
   sendRemoveUID,
   updateUIDName,
+  touchAdminSession,
 } from '@/lib/api'
 import type { DeviceDetail, DeviceUID, PendingUID, Command, AccessLog, DeviceHealth } from '@/lib/types'
 
@@ -49,6 +50,14 @@ export default function DeviceDetailPage() {
     return () => clearInterval(interval)
   }, [deviceId])
 
+  // Tells the device someone is here: it polls for commands fast while this
+  // is fresh (devices.admin_seen_at, 60 s window)
+  useEffect(() => {
+    touchAdminSession(deviceId)
+    const interval = setInterval(() => touchAdminSession(deviceId), 30000)
+    return () => clearInterval(interval)
+  }, [deviceId])
+
   async function loadAll() {
     try {
       const [detailData, pendingData, whitelistData, blacklistData, commandsData, logsData, namesData, healthData] =
@@ -88,8 +97,8 @@ export default function DeviceDetailPage() {
   }
 
   const lastSeen = detail ? new Date(detail.last_seen) : null
-  // Use health heartbeat (pushed every 60s) as primary online indicator.
-  // Threshold = 120s (2× push interval) to avoid false offline during slow cycles.
+  // Use health heartbeat (pushed every 15s) as primary online indicator.
+  // Threshold = 120s (several push intervals) to ride out failed pushes and slow cycles.
   const healthTs = health ? new Date(health.updated_at) : null
   const onlineRef = healthTs ?? lastSeen
   const isOnline = onlineRef ? Date.now() - onlineRef.getTime() < 120000 : false
@@ -710,6 +719,12 @@ function HealthTab({ health }: { health: DeviceHealth | null }) {
               <span className={health.wifi_connected ? 'text-green-600' : 'text-red-600'}>Disconnects:</span>
               <span className="font-medium">{health.wifi_disconnect_count}</span>
             </div>
+            {health.cmd_poll_interval_ms != null && (
+              <div className="flex justify-between">
+                <span className={health.wifi_connected ? 'text-green-600' : 'text-red-600'}>Command poll:</span>
+                <span className="font-medium">every {(health.cmd_poll_interval_ms / 1000).toFixed(0)} s</span>
+              </div>
+            )}
           </div>
         </div>
 
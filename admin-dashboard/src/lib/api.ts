@@ -1,5 +1,5 @@
 import { supabase } from './supabase'
-import type { Command, DeviceSummary, DeviceDetail, DeviceUID, PendingUID, CommandType, AccessLog, DeviceHealth } from './types'
+import type { Command, DeviceSummary, DeviceDetail, DeviceUID, PendingUID, CommandType, AccessLog, DeviceHealth, HealthSample, LogQueryParams, PendingPage, PendingPageParams } from './types'
 
 // Query #1: List all devices (using device_overview view)
 export async function fetchDevices(): Promise<DeviceSummary[]> {
@@ -15,7 +15,7 @@ export async function fetchDevices(): Promise<DeviceSummary[]> {
 // Query #2: Device summary
 export async function fetchDeviceDetail(deviceId: string): Promise<DeviceDetail | null> {
   // Use device_health.updated_at as the primary "last seen" indicator
-  // because it's pushed every 60s while the device is alive.
+  // because it's pushed every 15s while the device is alive.
   // Fall back to the most recent device_command created_at.
   const [healthRes, cmdRes] = await Promise.all([
     supabase
@@ -80,38 +80,71 @@ export async function fetchBlacklistUIDs(deviceId: string): Promise<DeviceUID[]>
   return data as DeviceUID[]
 }
 
-// Query #5: Fetch pending UIDs (from last GET_PENDING command result)
+// Query #5: Fetch pending UIDs
+// Devices push new cards to device_pending_reports as they are tapped;
+// the last GET_PENDING result adds any the push missed (older firmware,
+// device offline at the time, cards from before the table existed),
+// minus cards decided since that snapshot.
 export async function fetchPendingUIDs(deviceId: string): Promise<PendingUID[]> {
-  // Get the most recent successful GET_PENDING command
-  const { data, error } = await supabase
-    .from('device_commands')
-    .select('result, acked_at')
-    .eq('device_id', deviceId)
-    .eq('type', 'GET_PENDING')
-    .eq('status', 'DONE')
-    .not('result', 'is', null)
-    .order('acked_at', { ascending: false })
-    .limit(1)
-    .single()
+  const [pushedRes, snapshotRes, decidedRes] = await Promise.all([
+    supabase
+      .from('device_pending_reports')
+      .select('uid, door_id, created_at')
+      .eq('device_id', deviceId)
+      .order('created_at', { ascending: false }),
+    supabase
+      .from('device_commands')
+      .select('result, acked_at')
+      .eq('device_id', deviceId)
+      .eq('type', 'GET_PENDING')
+      .eq('status', 'DONE')
+      .not('result', 'is', null)
+      .order('acked_at', { ascending: false })
+      .limit(1)
+      .single(),
+    supabase
+      .from('device_uids')
+      .select('uid')
+      .eq('device_id', deviceId),
+  ])
 
-  if (error) {
-    if (error.code === 'PGRST116') return [] // No results
-    throw error
-  }
+  // Table not created yet (add-pending-push.sql): snapshot only
+  if (pushedRes.error && pushedRes.error.code !== '42P01') throw pushedRes.error
+  if (snapshotRes.error && snapshotRes.error.code !== 'PGRST116') throw snapshotRes.error
+  if (decidedRes.error) throw decidedRes.error
+
+  const pending: PendingUID[] = (pushedRes.data ?? []).map(r => ({
+    uid: r.uid,
+    reported_at: r.created_at,
+    door_id: r.door_id,
+  }))
 
-  if (!data || !data.result) return []
+  const data = snapshotRes.data
+  if (!data || !data.result) return pending
 
   try {
-    const uids = JSON.parse(data.result)
-    // Convert array of UIDs to array of objects with reported_at
-    return uids.map((uid: string) => ({
-      uid,
-      reported_at: data.acked_at || new Date().toISOString()
-    }))
+    const parsed: PendingPage | string[] = JSON.parse(data.result)
+    const uids = Array.isArray(parsed) ? parsed : parsed.uids
+    const seen = new Set([...pending.map(p => p.uid), ...(decidedRes.data ?? []).map(r => r.uid)])
+    for (const uid of uids) {
+      if (seen.has(uid)) continue
+      pending.push({ uid, reported_at: data.acked_at || new Date().toISOString() })
+    }
   } catch (e) {
     console.error('Failed to parse pending UIDs:', e)
-    return []
   }
+  return pending
+}
+
+// Devices poll for commands fast while devices.admin_seen_at is recent
+// (poll_device_commands, add-adaptive-polling.sql). Best effort.
+export async function touchAdminSession(deviceId: string): Promise<void> {
+  const { error } = await supabase
+    .from('devices')
+    .update({ admin_seen_at: new Date().toISOString() })
+    .eq('device_id', deviceId)
+
+  if (error && error.code !== '42703') console.error('Failed to mark admin session:', error)
 }
 
 // Query #12: Command history
@@ -184,9 +217,9 @@ export async function sendCommand(
   return data as Command
 }
 
-// Query #6: Remote unlock
-export async function sendRemoteUnlock(deviceId: string): Promise<Command> {
-  return sendCommand(deviceId, 'REMOTE_UNLOCK')
+// Query #6: Remote unlock (door index on multi-door devices, default 0)
+export async function sendRemoteUnlock(deviceId: string, door?: number): Promise<Command> {
+  return sendCommand(deviceId, 'REMOTE_UNLOCK', undefined, door ? { door } : undefined)
 }
 
 // Query #7: Whitelist UID
@@ -217,8 +250,8 @@ export async function sendSyncUIDs(
 }
 
 // Query #11: Get pending
-export async function sendGetPending(deviceId: string): Promise<Command> {
-  return sendCommand(deviceId, 'GET_PENDING')
+export async function sendGetPending(deviceId: string, page?: PendingPageParams): Promise<Command> {
+  return sendCommand(deviceId, 'GET_PENDING', undefined, page)
 }
 
 // Query #12: Sync logs
@@ -226,6 +259,12 @@ export async function sendSyncLogs(deviceId: string): Promise<Command> {
   return sendCommand(deviceId, 'SYNC_LOGS')
 }
 
+// Query #12b: Search logs stored on the device (result arrives as JSON in command.result)
+export async function sendQueryLogs(deviceId: string, params: LogQueryParams): Promise<Command> {
+  const { uid, ...payload } = params
+  return sendCommand(deviceId, 'QUERY_LOGS', uid, payload)
+}
+
 // Query #14: Fetch access logs
 export async function fetchAccessLogs(deviceId: string, limit = 100): Promise<AccessLog[]> {
   const { data, error } = await supabase
@@ -301,3 +340,20 @@ export async function fetchAllDeviceHealthTimestamps(): Promise<Record<string, s
   }
   return map
 }
+
+// Query #19: Health history for incident forensics (newest last)
+export async function fetchHealthHistory(deviceId: string, hours = 24): Promise<HealthSample[]> {
+  const since = new Date(Date.now() - hours * 3600 * 1000).toISOString()
+  const { data, error } = await supabase
+    .from('device_health_history')
+    .select('sampled_at, free_heap_bytes, largest_free_block_kb, min_free_heap_kb, wifi_rssi, voltage_mv, wifi_connected, ntp_synced, rfid_ok, rfid_reinit_count, wifi_disconnect_count')
+    .eq('device_id', deviceId)
+    .gte('sampled_at', since)
+    .order('sampled_at', { ascending: true })
+
+  if (error) {
+    if (error.code === '42P01') return []
+    throw error
+  }
+  return (data ?? []) as HealthSample[]
+}
@@ -8,6 +8,7 @@ export type CommandType =
   | 'SYNC_UIDS'
   | 'GET_PENDING'
   | 'SYNC_LOGS'
+  | 'QUERY_LOGS'
 
 export type UIDState = 'WHITELIST' | 'BLACKLIST'
 
@@ -35,6 +36,20 @@ export interface DeviceUID {
 export interface PendingUID {
   uid: string
   reported_at: string
+  door_id?: number  // pushed by the device (device_pending_reports); absent for GET_PENDING results
+}
+
+// GET_PENDING: optional payload and the JSON the device returns in `result`
+// (firmware before paging returned a bare string[])
+export interface PendingPageParams {
+  cursor?: string  // `next` from the previous page
+  limit?: number   // 1..64, default: the whole list
+}
+
+export interface PendingPage {
+  uids: string[]
+  next: string | null
+  total: number
 }
 
 export interface DeviceSummary {
@@ -56,6 +71,33 @@ export interface AccessLog {
   uid: string
   event_type: 'GRANTED' | 'DENIED' | 'PENDING' | 'REMOTE'
   logged_at: string
+  door_id?: number  // door index on the device, 0 for single-door installs
+}
+
+// QUERY_LOGS: payload sent to the device and the JSON it returns in `result`
+export interface LogQueryParams {
+  uid?: string
+  from?: number | string  // epoch seconds or "YYYY-MM-DD HH:MM:SS+05:30"
+  to?: number | string
+  cursor?: string         // `next` from the previous page
+  limit?: number          // 1..50
+  events?: string[]       // LogEvent names, e.g. ['ACCESS_DENIED', 'UNKNOWN_CARD']; omit for all
+}
+
+export interface DeviceLogRecord {
+  t: string  // device timestamp with zone offset
+  e: string  // LogEvent name, e.g. ACCESS_GRANTED
+  u: string
+  i: string
+  d?: number  // door, omitted for door 0
+}
+
+export interface LogQueryResult {
+  records: DeviceLogRecord[]
+  next: string | null
+  scanned: number
+  skipped: number
+  ms: number
 }
 
 export interface TaskInfo {
@@ -65,6 +107,50 @@ export interface TaskInfo {
   stack_size: number
   priority: number
   is_running: boolean
+  cpu_percent?: number   // share of one core; core = -1 when unpinned
+}
+
+export interface RfidReaderStats {
+  door: number      // 255 = not bound to a door
+  irq: boolean      // IRQ-driven rather than polled
+  ok: boolean
+  polls: number
+  reinits: number
+  taps: number
+}
+
+export interface HeapTagStats {
+  live: number
+  peak: number
+  allocs: number
+  rate: number   // bytes allocated per minute
+}
+
+export type BootPhase =
+  | 'setup'
+  | 'hardware'
+  | 'access_task'
+  | 'rfid_ready'
+  | 'first_poll'
+  | 'logstore'
+  | 'network'
+  | 'cloud_ready'
+
+export interface LoopStageProfile {
+  name: string
+  total_us: number
+  max_us: number
+}
+
+export interface LoopProfile {
+  n: number
+  avg_us: number
+  max_us: number
+  max_stage: string | null
+  max_stage_us: number
+  window_ms: number
+  hist: number[]   // <1, <2, <5, <10, <20, <50, <100, <500, >=500 ms
+  stages: LoopStageProfile[]
 }
 
 export interface CoreStatus {
@@ -98,6 +184,7 @@ export interface DeviceHealth {
   wifi_rssi: number
   ntp_synced: boolean
   wifi_disconnect_count: number
+  cmd_poll_interval_ms?: number | null  // adaptive command poll, base interval before jitter
 
   // Processor
   cpu_freq_mhz: number | null
@@ -123,10 +210,25 @@ export interface DeviceHealth {
   watchdog_enabled: boolean | null
   watchdog_timeout_ms: number | null
 
+  // Boot phases, ms since reset (first_poll = reader accepting cards)
+  boot_timings?: Partial<Record<BootPhase, number>> | null
+
   // Tasks
   tasks: TaskInfo[] | null
   task_count: number | null
 
+  // CPU accounting
+  cpu_core0_load?: number | null
+  cpu_core1_load?: number | null
+  cpu_idle_percent?: number | null
+  loop_profile?: { access: LoopProfile; cloud: LoopProfile } | null
+
+  // Heap pressure
+  heap_level?: 'NORMAL' | 'WARN' | 'CRIT' | null
+  heap_frag_permille?: number | null
+  heap_frag_trend?: number | null
+  heap_tags?: Record<'cloud_http' | 'json' | 'logging' | 'access', HeapTagStats> | null
+
   // RFID / PN532
   rfid_healthy: boolean
   rfid_communication_ok: boolean | null
@@ -136,6 +238,7 @@ export interface DeviceHealth {
   rfid_firmware_minor: number | null
   rfid_firmware_support: number | null
   rfid_reinit_count: number
+  rfid_readers?: RfidReaderStats[] | null  // multi-reader devices only
   rfid_poll_count: number | null
 
   // Voltage monitoring
@@ -149,3 +252,18 @@ export interface DeviceHealth {
   // Row metadata
   updated_at: string
 }
+
+// One row of device_health_history (sampled every 10s, uploaded in batches)
+export interface HealthSample {
+  sampled_at: string
+  free_heap_bytes: number
+  largest_free_block_kb: number
+  min_free_heap_kb: number
+  wifi_rssi: number
+  voltage_mv: number
+  wifi_connected: boolean
+  ntp_synced: boolean
+  rfid_ok: boolean
+  rfid_reinit_count: number
+  wifi_disconnect_count: number
+}
@@ -1,8 +1,15 @@
 #include "access_controller.h"
 #include "relay/relay_controller.h"
+#include "access/doors.h"
+#include "access/tap_cache.h"
 #include "buzzer/buzzer_manager.h"
 #include <Arduino.h>
 #include "storage/log_store.h"
+#include "core/metrics.h"
+#include "core/stage_queue.h"
+#include "core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_ACCESS
 
 // ================= TIMING =================
 
@@ -11,25 +18,51 @@ static const uint32_t UNLOCK_COOLDOWN_MS = 1000;
 
 // ================= STATE =================
 
-static bool doorUnlocked = false;
-static uint32_t unlockStartTime = 0;
-static uint32_t lastUnlockTime = 0;
+// Per door. The relay's own timer re-locks the door; this only mirrors
+// it for the cooldown and the gauge
+static bool doorUnlocked[DOOR_COUNT] = {};
+static uint32_t lastUnlockTime[DOOR_COUNT] = {};
+
+// Access log records, written by the decision task so the actuator never
+// waits on the LittleFS mutex or a flash flush
+struct JournalRecord {
+    LogEvent    evt;
+    uint8_t     door;
+    char        uid[21];
+    const char* info;   // string literal
+};
+static StageQueue journal("queue=\"journal\"", PIPELINE_JOURNAL_QUEUE_LEN, sizeof(JournalRecord));
+
+// ================= METRICS =================
+
+static Counter unlocksRfid("emlock_door_unlocks_total", "Door unlocks by source", "source=\"rfid\"");
+static Counter unlocksExit("emlock_door_unlocks_total", "Door unlocks by source", "source=\"exit\"");
+static Counter unlocksRemote("emlock_door_unlocks_total", "Door unlocks by source", "source=\"remote\"");
+static Counter cooldownIgnored("emlock_access_cooldown_ignored_total", "Events dropped by the unlock cooldown");
+static Gauge   doorUnlockedGauge("emlock_door_unlocked", "Doors the relays currently hold open");
 
 // ================= PUBLIC =================
 
 void AccessController::init() {
-    doorUnlocked = false;
-    unlockStartTime = 0;
-    lastUnlockTime = 0;
-
-    RelayController::lock();
+    journal.init();
+    for (uint8_t d = 0; d < DOOR_COUNT; d++) {
+        doorUnlocked[d] = false;
+        lastUnlockTime[d] = 0;
+        RelayController::lock(d);
+    }
 }
 
 void AccessController::handleEvent(const Event& evt) {
+    const uint8_t door = evt.door;
+    if (!Doors::valid(door)) {
+        LOGW("[ACCESS] Event for unknown door %u ignored\n", door);
+        return;
+    }
 
-    // Enforce cooldown
-    if (isCooldownActive()) {
-        Serial.println("[ACCESS] Cooldown active, event ignored");
+    // Enforce cooldown (per door: a busy door doesn't hold up its neighbours)
+    if (isCooldownActive(door)) {
+        LOGD("[ACCESS] Door %u cooldown active, event ignored\n", door);
+        cooldownIgnored.inc();
         return;
     }
     // ===== RFID DEBUG VISIBILITY =====
@@ -38,17 +71,15 @@ if (evt.type == EventType::RFID_GRANTED ||
     evt.type == EventType::RFID_PENDING ||
     evt.type == EventType::RFID_INVALID) {
 
-    Serial.print("[RFID] UID=");
-    Serial.print(evt.uid);
-    Serial.print(" RESULT=");
-
+    const char* result = "";
     switch (evt.type) {
-        case EventType::RFID_GRANTED: Serial.println("GRANTED"); break;
-        case EventType::RFID_DENIED:  Serial.println("DENIED");  break;
-        case EventType::RFID_PENDING: Serial.println("PENDING"); break;
-        case EventType::RFID_INVALID: Serial.println("INVALID"); break;
+        case EventType::RFID_GRANTED: result = "GRANTED"; break;
+        case EventType::RFID_DENIED:  result = "DENIED";  break;
+        case EventType::RFID_PENDING: result = "PENDING"; break;
+        case EventType::RFID_INVALID: result = "INVALID"; break;
         default: break;
     }
+    LOGI("[RFID] Door %u UID=%s RESULT=%s\n", door, evt.uid, result);
 }
 
 
@@ -56,39 +87,50 @@ if (evt.type == EventType::RFID_GRANTED ||
     switch (evt.type) {
 
         case EventType::EXIT_TRIGGERED:
-            LogStore::log(LogEvent::EXIT_UNLOCK, "-", "ok");
-            unlockDoor();
+            unlockDoor(door);
+            unlocksExit.inc();
+            record(LogEvent::EXIT_UNLOCK, "-", "ok", door);
             BuzzerManager::playExitTone();
             break;
 
         case EventType::REMOTE_UNLOCK:
-            LogStore::log(LogEvent::REMOTE_UNLOCK, "-", "ok");
-            unlockDoor();
+            unlockDoor(door);
+            unlocksRemote.inc();
+            record(LogEvent::REMOTE_UNLOCK, "-", "ok", door);
             BuzzerManager::playRemoteTone();
             break;
 
         case EventType::RFID_GRANTED:
-            Serial.println("[RFID] CARD UID = " + String(evt.uid));
-            LogStore::log(LogEvent::ACCESS_GRANTED, evt.uid, "ok");
-            unlockDoor();
+            unlockDoor(door);
+            unlocksRfid.inc();
+            LOGD("[RFID] CARD UID = %s\n", evt.uid);
+            record(LogEvent::ACCESS_GRANTED, evt.uid, "ok", door);
             BuzzerManager::playGrantTone();
             break;
 
         case EventType::RFID_DENIED:
-            Serial.println("[RFID] CARD UID = " + String(evt.uid));
-            LogStore::log(LogEvent::ACCESS_DENIED, evt.uid, "blacklist");
+            LOGD("[RFID] CARD UID = %s\n", evt.uid);
+            if (evt.repeat) {   // counted by TapCache, summarised by writeJournal()
+                BuzzerManager::playRepeatTone();
+                break;
+            }
+            record(LogEvent::ACCESS_DENIED, evt.uid, "blacklist", door);
             BuzzerManager::playDenyTone();
             break;
 
         case EventType::RFID_PENDING:
-            Serial.println("[RFID] CARD UID = " + String(evt.uid));
-            LogStore::log(LogEvent::UNKNOWN_CARD, evt.uid, "pending");
+            LOGD("[RFID] CARD UID = %s\n", evt.uid);
+            if (evt.repeat) {
+                BuzzerManager::playRepeatTone();
+                break;
+            }
+            record(LogEvent::UNKNOWN_CARD, evt.uid, "pending", door);
             BuzzerManager::playPendingTone();
             break;
             
         case EventType::RFID_INVALID:
-            Serial.println("[RFID] INVALID CARD");
-            LogStore::log(LogEvent::RFID_INVALID, "-", "invalid UID");
+            LOGD("[RFID] INVALID CARD\n");
+            record(LogEvent::RFID_INVALID, "-", "invalid UID", door);
             BuzzerManager::playInvalid();
             break;
 
@@ -98,31 +140,67 @@ if (evt.type == EventType::RFID_GRANTED ||
 }
 
 void AccessController::update() {
-    uint32_t now = millis();
+    // Locked on time by RelayController's esp_timer, however late this runs
+    for (uint8_t d = 0; d < DOOR_COUNT; d++) {
+        if (doorUnlocked[d] && !RelayController::isOpen(d)) {
+            doorUnlocked[d] = false;
+            doorUnlockedGauge.add(-1);
+            lastUnlockTime[d] = RelayController::lastLockMs(d);
+        }
+    }
+}
+
+void AccessController::writeJournal() {
+    JournalRecord r;
+    while (journal.receive(&r, 0)) {
+        LogStore::log(r.evt, r.uid, r.info, r.door);
+    }
 
-    if (doorUnlocked && (now - unlockStartTime >= UNLOCK_DURATION_MS)) {
-        lockDoor();
-        lastUnlockTime = now;
+    // One record per burst of repeated taps: "repeat x<count> <first>+<span s>"
+    TapBurst b;
+    while (TapCache::takeEndedBurst(b)) {
+        char info[32];
+        snprintf(info, sizeof(info), "repeat x%u %lu+%lu", b.repeats,
+                 (unsigned long)b.firstEpoch, (unsigned long)(b.lastEpoch - b.firstEpoch));
+        LogEvent evt = b.verdict == AccessResult::DENY_BLACKLIST ? LogEvent::ACCESS_DENIED
+                                                                 : LogEvent::UNKNOWN_CARD;
+        LogStore::log(evt, b.uid, info, b.door);
     }
 }
 
+StageQueueStats AccessController::journalStats() {
+    return journal.stats();
+}
+
 // ================= PRIVATE =================
 
-void AccessController::unlockDoor() {
-    RelayController::unlock();
-    doorUnlocked = true;
-    unlockStartTime = millis();
-    lastUnlockTime = millis();
+void AccessController::record(LogEvent evt, const char* uid, const char* info, uint8_t door) {
+    JournalRecord r = {};
+    r.evt  = evt;
+    r.door = door;
+    r.info = info;
+    strncpy(r.uid, uid, sizeof(r.uid) - 1);
+    if (!journal.send(&r)) {
+        LOGW("[ACCESS] Access log backlogged, door %u record dropped\n", door);
+    }
+}
+
+void AccessController::unlockDoor(uint8_t door) {
+    RelayController::openFor(door, UNLOCK_DURATION_MS);   // extends an open window
+    if (!doorUnlocked[door]) doorUnlockedGauge.add(1);
+    doorUnlocked[door] = true;
+    lastUnlockTime[door] = millis();
 
-    Serial.println("[ACCESS] Door UNLOCKED");
+    LOGI("[ACCESS] Door %u UNLOCKED\n", door);
 }
 
-void AccessController::lockDoor() {
-    RelayController::lock();
-    doorUnlocked = false;
+void AccessController::lockDoor(uint8_t door) {
+    RelayController::lock(door);
+    if (doorUnlocked[door]) doorUnlockedGauge.add(-1);
+    doorUnlocked[door] = false;
 }
 
-bool AccessController::isCooldownActive() {
+bool AccessController::isCooldownActive(uint8_t door) {
     uint32_t now = millis();
-    return (now - lastUnlockTime < UNLOCK_COOLDOWN_MS);
+    return (now - lastUnlockTime[door] < UNLOCK_COOLDOWN_MS);
 }
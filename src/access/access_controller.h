@@ -2,18 +2,30 @@
 
 #include <stdint.h>
 #include "core/event_types.h"
+#include "core/stage_queue.h"
+#include "storage/log_store.h"
 
 // ================= ACCESS CONTROLLER =================
+// Routes each event to its door (Event::door); unlock window and
+// cooldown are tracked per door.
+//
+// handleEvent() and update() run on the actuator task: relay first, then
+// the buzzer, both non-blocking. Access log records are queued and
+// written by writeJournal() on the decision task.
 
 class AccessController {
 public:
     static void init();
     static void handleEvent(const Event& evt);
-    static void update();   // called periodically (Core 1)
+    static void update();   // called periodically (actuator task)
+    static StageQueueStats journalStats();
+
+    static void writeJournal();   // decision task: queued records -> LogStore
 
 private:
-    static void unlockDoor();
-    static void lockDoor();
+    static void unlockDoor(uint8_t door);
+    static void lockDoor(uint8_t door);
+    static void record(LogEvent evt, const char* uid, const char* info, uint8_t door);
 
-    static bool isCooldownActive();
+    static bool isCooldownActive(uint8_t door);
 };
@@ -2,6 +2,9 @@
 #include "../storage/nvs_store.h"
 #include "../core/thread_safe.h"
 #include <ctype.h>
+#include "../core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_ACCESS
 
 // ================= UID VALIDATION =================
 static bool isValidUID(const String &uid) {
@@ -14,11 +17,12 @@ static bool isValidUID(const String &uid) {
 }
 
 // ================= DECISION LOGIC =================
-AccessResult AccessDecision::evaluate(const String& uid) {
+AccessResult AccessDecision::evaluate(const String& uid, bool* fromStore) {
+    if (fromStore) *fromStore = false;
 
     // 1️⃣ INVALID UID → HARD DENY
     if (!isValidUID(uid)) {
-        Serial.printf("[ACCESS] UID '%s' failed validation (len=%d)\n", uid.c_str(), uid.length());
+        LOGI("[ACCESS] UID '%s' failed validation (len=%d)\n", uid.c_str(), uid.length());
         return AccessResult::INVALID;
     }
 
@@ -28,25 +32,26 @@ AccessResult AccessDecision::evaluate(const String& uid) {
     // Use 300ms timeout to survive brief SYNC_UIDS operations
     ThreadSafe::Guard guard(300);
     if (!guard.isAcquired()) {
-        Serial.printf("[ACCESS] MUTEX TIMEOUT for UID %s - cannot evaluate, denying\n", c_uid);
+        LOGW("[ACCESS] MUTEX TIMEOUT for UID %s - cannot evaluate, denying\n", c_uid);
         return AccessResult::PENDING_REPEAT;
     }
+    if (fromStore) *fromStore = true;
 
     // 2️⃣ BLACKLIST → DENY
     if (NVSStore::isBlacklisted(c_uid)) {
-        Serial.printf("[ACCESS] UID %s -> BLACKLISTED\n", c_uid);
+        LOGD("[ACCESS] UID %s -> BLACKLISTED\n", c_uid);
         return AccessResult::DENY_BLACKLIST;
     }
 
     // 3️⃣ WHITELIST → GRANT
     if (NVSStore::isWhitelisted(c_uid)) {
-        Serial.printf("[ACCESS] UID %s -> WHITELISTED (WL count=%d)\n", c_uid, NVSStore::whitelistCount());
+        LOGD("[ACCESS] UID %s -> WHITELISTED (WL count=%d)\n", c_uid, NVSStore::whitelistCount());
         return AccessResult::GRANT;
     }
 
     // 4️⃣ UNKNOWN → ADD TO PENDING (ONCE)
-    Serial.printf("[ACCESS] UID %s NOT in WL(%d) or BL(%d), adding to PENDING\n",
-                  c_uid, NVSStore::whitelistCount(), NVSStore::blacklistCount());
+    LOGD("[ACCESS] UID %s NOT in WL(%d) or BL(%d), adding to PENDING\n",
+         c_uid, NVSStore::whitelistCount(), NVSStore::blacklistCount());
     if (NVSStore::addToPending(c_uid)) {
         return AccessResult::PENDING_NEW;
     }
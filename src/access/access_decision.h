@@ -11,6 +11,8 @@ INVALID
 };
 
 namespace AccessDecision {
-  AccessResult evaluate(const String &uid);
+  // `fromStore` (optional) is set when the verdict came from NVS, as
+  // opposed to a validation failure or a mutex timeout
+  AccessResult evaluate(const String &uid, bool* fromStore = nullptr);
   const char* toString(AccessResult r);
 }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include "config/config.h"
+
+// ================= DOOR TABLE =================
+// Per-door wiring and reader bindings from config.h (DOOR_*, RFID_READER_*).
+// Header-only so the host replay build can route reader events without
+// the relay code.
+
+namespace Doors {
+    const uint8_t NONE = 0xFF;
+
+    const uint8_t RELAY_PINS[DOOR_COUNT]          = DOOR_RELAY_PINS;
+    const uint8_t EXIT_PINS[DOOR_COUNT]           = DOOR_EXIT_PINS;
+    const uint8_t READER_DOORS[RFID_READER_COUNT] = RFID_READER_DOORS;
+
+    inline bool valid(uint8_t door) { return door < DOOR_COUNT; }
+
+    // Door a reader is mounted on; NONE if it serves no door
+    inline uint8_t forReader(uint8_t reader) {
+        if (reader >= RFID_READER_COUNT) return NONE;
+        return valid(READER_DOORS[reader]) ? READER_DOORS[reader] : NONE;
+    }
+}
@@ -1,11 +1,13 @@
 #include "exit_sensor.h"
 #include <Arduino.h>
+#include "access/doors.h"
 #include "core/event_queue.h"
 #include "core/event_types.h"
+#include "core/console_log.h"
 
-// ================= CONFIG =================
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_ACCESS
 
-static uint8_t exitPin;
+// ================= CONFIG =================
 
 // Timing (LOCKED)
 static const uint32_t EXIT_DEBOUNCE_MS = 80;
@@ -13,73 +15,89 @@ static const uint32_t EXIT_COOLDOWN_MS = 1000;
 
 // ================= STATE =================
 
-static bool lastStableState = LOW;     // current stable state
-static bool debouncing = false;
-static bool idleState = LOW;           // measured idle state at init
-static bool activeState = HIGH;        // state representing "presence"
+struct SensorState {
+    bool     lastStableState;   // current stable state
+    bool     debouncing;
+    bool     idleState;         // measured idle state at init
+    bool     activeState;       // state representing "presence"
+    uint32_t debounceStart;
+    uint32_t lastTriggerTime;
+};
 
-static uint32_t debounceStart = 0;
-static uint32_t lastTriggerTime = 0;
+static SensorState sensors[DOOR_COUNT] = {};
 
 // ================= PUBLIC =================
 
-void ExitSensor::init(uint8_t pin) {
-    exitPin = pin;
+void ExitSensor::init() {
+    for (uint8_t d = 0; d < DOOR_COUNT; d++) {
+        uint8_t pin = Doors::EXIT_PINS[d];
+        if (pin == Doors::NONE) continue;
 
-    pinMode(exitPin, INPUT);  // GPIO 35: input-only, no pullups
+        pinMode(pin, INPUT);  // GPIO 35: input-only, no pullups
 
-    // Measure idle level and compute active level (assume active is opposite)
-    idleState = digitalRead(exitPin);
-    activeState = !idleState;
-    lastStableState = idleState;
-    lastTriggerTime = 0;
+        // Measure idle level and compute active level (assume active is opposite)
+        SensorState& s = sensors[d];
+        s.idleState       = digitalRead(pin);
+        s.activeState     = !s.idleState;
+        s.lastStableState = s.idleState;
+        s.debouncing      = false;
+        s.lastTriggerTime = 0;
 
-    Serial.println("[EXIT] Exit sensor initialized");
+        LOGI("[EXIT] Door %u exit sensor initialized (GPIO %u)\n", d, pin);
+    }
 }
 
 void ExitSensor::poll() {
     uint32_t now = millis();
+    for (uint8_t d = 0; d < DOOR_COUNT; d++) {
+        if (Doors::EXIT_PINS[d] != Doors::NONE) pollDoor(d, now);
+    }
+}
+
+// ================= PRIVATE =================
+
+void ExitSensor::pollDoor(uint8_t door, uint32_t now) {
+    SensorState& s = sensors[door];
 
     // Enforce cooldown
-    if (now - lastTriggerTime < EXIT_COOLDOWN_MS) {
+    if (now - s.lastTriggerTime < EXIT_COOLDOWN_MS) {
         return;
     }
 
-    bool currentState = digitalRead(exitPin);
+    bool currentState = digitalRead(Doors::EXIT_PINS[door]);
 
     // Detect activation (idle -> active) and trigger immediately when active
-    if (!debouncing) {
-        if (currentState == activeState && lastStableState == idleState) {
-            debouncing = true;
-            debounceStart = now;
+    if (!s.debouncing) {
+        if (currentState == s.activeState && s.lastStableState == s.idleState) {
+            s.debouncing = true;
+            s.debounceStart = now;
         }
     } else {
         // Debounce in progress
-        if (currentState == activeState) {
-            if (now - debounceStart >= EXIT_DEBOUNCE_MS) {
+        if (currentState == s.activeState) {
+            if (now - s.debounceStart >= EXIT_DEBOUNCE_MS) {
                 // Valid exit trigger (presence detected)
-                emitEvent();
-                lastTriggerTime = now;
+                emitEvent(door);
+                s.lastTriggerTime = now;
 
-                debouncing = false;
-                lastStableState = activeState;
+                s.debouncing = false;
+                s.lastStableState = s.activeState;
             }
         } else {
             // Bounce/noise → cancel debounce
-            debouncing = false;
+            s.debouncing = false;
         }
     }
 
     // Reset stable state back to idle when active clears
-    if (lastStableState == activeState && currentState == idleState) {
-        lastStableState = idleState;
+    if (s.lastStableState == s.activeState && currentState == s.idleState) {
+        s.lastStableState = s.idleState;
     }
 }
 
-// ================= PRIVATE =================
-
-void ExitSensor::emitEvent() {
+void ExitSensor::emitEvent(uint8_t door) {
     Event e{};
     e.type = EventType::EXIT_TRIGGERED;
+    e.door = door;
     EventQueue::send(e);
 }
@@ -16,11 +16,14 @@ struct ExitEvent {
 
 // ================= EXIT SENSOR MANAGER =================
 
+// One sensor per door (DOOR_EXIT_PINS); each is debounced on its own and
+// its EXIT_TRIGGERED event carries the door index.
 class ExitSensor {
 public:
-    static void init(uint8_t pin);
+    static void init();
     static void poll();   // non-blocking, Core 1 only
 
 private:
-    static void emitEvent();
+    static void pollDoor(uint8_t door, uint32_t now);
+    static void emitEvent(uint8_t door);
 };
@@ -1,34 +1,95 @@
 #include "rfid_manager.h"
 #include "core/event_queue.h"
 #include "access/access_decision.h"
+#include "access/tap_cache.h"
+#include "access/doors.h"
+#include "core/metrics.h"
+#include "core/stage_queue.h"
+#include "core/trace.h"
+#include "cloud/pending_push.h"
 
 #include <Adafruit_PN532.h>
 #include <SPI.h>
 #include <string.h>
 #include <ctype.h>
 #include <Arduino.h>
+#include <new>
+#include "core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_RFID
 
 // ================= HARDWARE CONFIG =================
-// PN532 over SPI – SS and RST pins passed at init()
-static Adafruit_PN532* pn532 = nullptr;
-static uint8_t _ssPin = 21;
-static uint8_t _rstPin = 22;
+// All readers share the hardware SPI bus; pins per reader from config.h
+static const uint8_t SS_PINS[RFID_READER_COUNT]  = RFID_READER_SS_PINS;
+static const uint8_t RST_PINS[RFID_READER_COUNT] = RFID_READER_RST_PINS;
+static const uint8_t IRQ_PINS[RFID_READER_COUNT] = RFID_READER_IRQ_PINS;
+static const uint8_t NO_IRQ = 0xFF;
 
 // ================= INTERNAL STATE =================
 static const uint32_t RFID_COOLDOWN_MS = 500;  // Prevent rapid re-reads
 
-// Health monitoring state
-static uint32_t lastSuccessfulReadMs = 0;
-static uint32_t lastHealthCheckMs = 0;
-static uint32_t pollCount = 0;
-static uint32_t reinitCount = 0;
-
-// Cached firmware info
-static uint8_t cachedIC = 0;
-static uint8_t cachedVerMaj = 0;
-static uint8_t cachedVerMin = 0;
-static uint8_t cachedSupport = 0;
-static bool    samOk = false;
+enum class ReaderPhase : uint8_t {
+    IDLE,       // IRQ reader: next poll sends InListPassiveTarget
+    ARMED       // IRQ reader: waiting for IRQ low (card in field)
+};
+
+struct Reader {
+    Adafruit_PN532* pn532;
+    uint8_t  rstPin;
+    uint8_t  irqPin;
+    ReaderPhase phase;
+    uint32_t armedMs;
+
+    // Health monitoring state
+    uint32_t lastSuccessfulReadMs;
+    uint32_t lastHealthCheckMs;
+    uint32_t lastReadMs;         // cooldown
+    uint32_t lastTapMs;
+    uint32_t pollCount;
+    uint32_t reinitCount;
+    uint32_t tapCount;
+
+    // Cached firmware info
+    uint8_t  ic;
+    uint8_t  verMaj;
+    uint8_t  verMin;
+    uint8_t  support;
+    bool     samOk;
+};
+
+// Drivers live in static storage: Adafruit_PN532 has no default constructor
+alignas(Adafruit_PN532) static uint8_t driverStorage[RFID_READER_COUNT][sizeof(Adafruit_PN532)];
+static Reader  readers[RFID_READER_COUNT] = {};
+static bool    initialized = false;
+static uint8_t nextBlocking = 0;   // round-robin position among non-IRQ readers
+
+// Reader stage -> decision stage
+struct Tap {
+    char     uid[15];  // 7 bytes -> 14 hex + null
+    uint8_t  reader;
+    uint32_t readUs;   // micros() when the UID came off the card
+};
+static StageQueue tapQueue("queue=\"tap\"", PIPELINE_TAP_QUEUE_LEN, sizeof(Tap));
+
+// ================= METRICS =================
+static const uint32_t DECISION_BOUNDS_US[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 50000 };
+
+static Counter   pollsTotal("emlock_rfid_polls_total", "Reader polls");
+static Counter   reinitsTotal("emlock_rfid_reinits_total", "PN532 reinitialisations");
+static Counter   cooldownTotal("emlock_rfid_cooldown_ignored_total", "Reads ignored inside the re-read cooldown");
+static Counter   tapsGranted("emlock_rfid_taps_total", "Card taps by decision", "result=\"granted\"");
+static Counter   tapsDenied("emlock_rfid_taps_total", "Card taps by decision", "result=\"denied\"");
+static Counter   tapsPending("emlock_rfid_taps_total", "Card taps by decision", "result=\"pending\"");
+static Counter   tapsInvalid("emlock_rfid_taps_total", "Card taps by decision", "result=\"invalid\"");
+static Histogram decisionSeconds("emlock_rfid_decision_seconds", "AccessDecision::evaluate latency",
+                                 DECISION_BOUNDS_US, sizeof(DECISION_BOUNDS_US) / sizeof(DECISION_BOUNDS_US[0]),
+                                 1000000.0f);
+
+static const uint32_t WAIT_BOUNDS_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000 };
+
+static Histogram tapWaitSeconds("emlock_pipeline_wait_seconds", "Time an item spent queued before its stage took it",
+                                WAIT_BOUNDS_US, sizeof(WAIT_BOUNDS_US) / sizeof(WAIT_BOUNDS_US[0]),
+                                1000000.0f, "queue=\"tap\"");
 
 // Timing constants for health monitoring
 static const uint32_t HEALTH_CHECK_INTERVAL_MS = 10000;  // Check health every 10 seconds
@@ -36,201 +97,320 @@ static const uint32_t READER_TIMEOUT_MS = 30000;          // Reinit if no reads
 
 // ================= PRIVATE HELPER FUNCTIONS =================
 
-static bool readFirmwareVersion() {
-    uint32_t versiondata = pn532->getFirmwareVersion();
+static bool readFirmwareVersion(Reader& r) {
+    uint32_t t0 = micros();
+    uint32_t versiondata = r.pn532->getFirmwareVersion();
+    Trace::record(TraceEvent::SPI_CHECK, t0, versiondata != 0);
     if (!versiondata) return false;
 
-    cachedIC      = (versiondata >> 24) & 0xFF;
-    cachedVerMaj  = (versiondata >> 16) & 0xFF;
-    cachedVerMin  = (versiondata >>  8) & 0xFF;
-    cachedSupport = versiondata & 0xFF;
+    r.ic      = (versiondata >> 24) & 0xFF;
+    r.verMaj  = (versiondata >> 16) & 0xFF;
+    r.verMin  = (versiondata >>  8) & 0xFF;
+    r.support = versiondata & 0xFF;
     return true;
 }
 
-static bool performHealthCheck() {
-    // getFirmwareVersion() returns 0 on communication failure
-    uint32_t ver = pn532->getFirmwareVersion();
+static bool performHealthCheck(Reader& r, uint8_t idx) {
+    // getFirmwareVersion() returns 0 on communication failure. Any command
+    // also cancels a pending InListPassiveTarget, so the reader re-arms.
+    r.phase = ReaderPhase::IDLE;
+    uint32_t ver = r.pn532->getFirmwareVersion();
     if (!ver) {
-        Serial.println("[RFID] Health check FAILED - no communication with PN532");
-        samOk = false;
+        LOGE("[RFID] Reader %u health check FAILED - no communication with PN532\n", idx);
+        r.samOk = false;
         return false;
     }
-    samOk = true;
+    r.samOk = true;
     return true;
 }
 
-static void reinitReader() {
-    Serial.println("[RFID] Reinitializing PN532...");
-    reinitCount++;
+static void reinitReader(Reader& r, uint8_t idx) {
+    LOGI("[RFID] Reinitializing PN532 %u...\n", idx);
+    r.reinitCount++;
+    reinitsTotal.inc();
+    r.phase = ReaderPhase::IDLE;
 
     // Hardware reset via RST pin
-    digitalWrite(_rstPin, LOW);
+    digitalWrite(r.rstPin, LOW);
     delay(100);
-    digitalWrite(_rstPin, HIGH);
+    digitalWrite(r.rstPin, HIGH);
     delay(150);
 
-    pn532->begin();
+    r.pn532->begin();
 
-    if (!readFirmwareVersion()) {
-        Serial.println("[RFID] WARNING: Reinit failed - still no communication");
-        samOk = false;
+    if (!readFirmwareVersion(r)) {
+        LOGW("[RFID] WARNING: Reader %u reinit failed - still no communication\n", idx);
+        r.samOk = false;
         return;
     }
 
     // Configure as NFC tag reader
-    pn532->SAMConfig();
-    samOk = true;
+    r.pn532->SAMConfig();
+    r.samOk = true;
 
     // Reset timing counters
-    lastSuccessfulReadMs = millis();
-    lastHealthCheckMs = millis();
+    r.lastSuccessfulReadMs = millis();
+    r.lastHealthCheckMs = millis();
 
-    Serial.printf("[RFID] Reinit complete  IC=0x%02X  FW=%d.%d\n",
-                  cachedIC, cachedVerMaj, cachedVerMin);
+    LOGI("[RFID] Reader %u reinit complete  IC=0x%02X  FW=%d.%d\n",
+         idx, r.ic, r.verMaj, r.verMin);
 }
 
-// ================= PUBLIC FUNCTIONS =================
-
-void RFIDManager::init(uint8_t ssPin, uint8_t rstPin) {
-    _ssPin  = ssPin;
-    _rstPin = rstPin;
-
-    Serial.println("[RFID] Initializing PN532 (SPI)...");
+// Health check and watchdog; true if the reader may be polled now.
+// At most one reader is reset per poll() so the others keep running.
+static bool maintainReader(Reader& r, uint8_t idx, uint32_t now, bool& reinitDone) {
+    if (reinitDone) return true;
 
-    // RST pin - active-low reset
-    pinMode(_rstPin, OUTPUT);
-    digitalWrite(_rstPin, HIGH);
-
-    // Create PN532 driver (hardware SPI, SS pin)
-    static Adafruit_PN532 instance(_ssPin);
-    pn532 = &instance;
+    // ----- PERIODIC HEALTH CHECK -----
+    if (now - r.lastHealthCheckMs >= HEALTH_CHECK_INTERVAL_MS) {
+        r.lastHealthCheckMs = now;
+
+        if (!performHealthCheck(r, idx)) {
+            LOGW("[RFID] Reader %u health check failed, reinitializing...\n", idx);
+            reinitReader(r, idx);
+            reinitDone = true;
+            return false;  // Skip this poll cycle after reinit
+        }
+    }
 
-    pn532->begin();
+    // ----- WATCHDOG: Reinit if reader hasn't responded in a while -----
+    if (r.lastSuccessfulReadMs > 0 && (now - r.lastSuccessfulReadMs > READER_TIMEOUT_MS)) {
+        LOGW("[RFID] Watchdog: reader %u no successful reads for 30s, reinitializing...\n", idx);
+        reinitReader(r, idx);
+        reinitDone = true;
+        return false;
+    }
+    return true;
+}
 
-    // Initialize timing state
-    lastSuccessfulReadMs = millis();
-    lastHealthCheckMs    = millis();
-    pollCount            = 0;
-    reinitCount          = 0;
+// A UID came off reader `idx`
+static void handleCard(Reader& r, uint8_t idx, const uint8_t* uid, uint8_t uidLen) {
+    // Mark successful read - proves reader is working
+    r.lastSuccessfulReadMs = millis();
 
-    // Read firmware info
-    if (!readFirmwareVersion()) {
-        Serial.println("[RFID] WARNING: No communication with PN532 - check wiring!");
-        samOk = false;
-    } else {
-        Serial.println("======== RFID DIAGNOSTICS (PN532) ========");
-        Serial.printf("  IC      : 0x%02X (expect 0x32)\n", cachedIC);
-        Serial.printf("  Firmware: %d.%d\n", cachedVerMaj, cachedVerMin);
-        Serial.printf("  Support : 0x%02X\n", cachedSupport);
-        Serial.println("===========================================");
+    // ----- COOLDOWN (per reader) -----
+    if (millis() - r.lastReadMs < RFID_COOLDOWN_MS) {
+        LOGD("[RFID] Reader %u cooldown active, ignoring scan.\n", idx);
+        cooldownTotal.inc();
+        return;
+    }
+    r.lastReadMs = millis();
+    r.lastTapMs  = r.lastReadMs;
+    r.tapCount++;
 
-        // Configure as passive NFC tag reader
-        pn532->SAMConfig();
-        samOk = true;
+    // ----- CONVERT UID TO HEX -----
+    Tap tap = {};
+    for (uint8_t i = 0; i < uidLen && i < 7; i++) {
+        sprintf(tap.uid + (i * 2), "%02X", uid[i]);
     }
+    tap.reader = idx;
+    tap.readUs = micros();
 
-    Serial.println("[RFID] Initialization complete");
+    // Decided on the decision task: NVS and its mutex never hold up the bus
+    if (!tapQueue.send(&tap)) {
+        LOGW("[RFID] Reader %u tap %s dropped, decision stage backlogged\n", idx, tap.uid);
+    }
 }
 
-void RFIDManager::poll() {
-    if (!pn532) return;
-
-    uint32_t now = millis();
-    pollCount++;
-
-    // ----- PERIODIC HEALTH CHECK -----
-    if (now - lastHealthCheckMs >= HEALTH_CHECK_INTERVAL_MS) {
-        lastHealthCheckMs = now;
-
-        if (!performHealthCheck()) {
-            Serial.println("[RFID] Health check failed, reinitializing...");
-            reinitReader();
-            return;  // Skip this poll cycle after reinit
+// IRQ reader: never waits. Arms detection, then collects the UID once the
+// PN532 pulls IRQ low.
+static void serviceIrqReader(Reader& r, uint8_t idx, uint32_t now) {
+    if (r.phase == ReaderPhase::ARMED) {
+        if (digitalRead(r.irqPin) == HIGH) {
+            // Re-arm now and then in case an IRQ edge was lost
+            if (now - r.armedMs < RFID_ARM_TIMEOUT_MS) return;
+            r.phase = ReaderPhase::IDLE;
+        } else {
+            uint8_t uid[7] = {0};
+            uint8_t uidLen  = 0;
+            uint32_t t0 = micros();
+            bool success = r.pn532->readDetectedPassiveTargetID(uid, &uidLen);
+            Trace::record(TraceEvent::SPI_READ, t0, success);
+            r.phase = ReaderPhase::IDLE;
+            if (success) handleCard(r, idx, uid, uidLen);
+            return;   // re-arm on the next pass, after the card had time to leave
         }
     }
 
-    // ----- WATCHDOG: Reinit if reader hasn't responded in a while -----
-    if (lastSuccessfulReadMs > 0 && (now - lastSuccessfulReadMs > READER_TIMEOUT_MS)) {
-        Serial.println("[RFID] Watchdog: No successful reads for 30s, reinitializing...");
-        reinitReader();
-        return;
+    r.pollCount++;
+    pollsTotal.inc();
+    if (r.pn532->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A)) {
+        r.phase   = ReaderPhase::ARMED;
+        r.armedMs = now;
     }
+}
+
+// Reader without IRQ: one bounded blocking read
+static void serviceBlockingReader(Reader& r, uint8_t idx) {
+    r.pollCount++;
+    pollsTotal.inc();
 
-    // ----- CARD DETECTION (non-blocking, short timeout) -----
     uint8_t uid[7] = {0};
     uint8_t uidLen  = 0;
 
     // readPassiveTargetID with a very short timeout keeps polling non-blocking
-    bool success = pn532->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLen, 50);
+    uint32_t t0 = micros();
+    bool success = r.pn532->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLen,
+                                                RFID_READ_TIMEOUT_MS);
+    Trace::record(TraceEvent::SPI_READ, t0, success);
 
-    if (!success) return;
+    if (success) handleCard(r, idx, uid, uidLen);
+}
 
-    // Mark successful read - proves reader is working
-    lastSuccessfulReadMs = millis();
+// ================= PUBLIC FUNCTIONS =================
 
-    // ----- COOLDOWN -----
-    static uint32_t lastReadMs = 0;
-    if (millis() - lastReadMs < RFID_COOLDOWN_MS) {
-        Serial.println("[RFID] Cooldown active, ignoring scan.");
-        return;
+void RFIDManager::init() {
+    LOGI("[RFID] Initializing %u PN532 reader(s) (SPI)...\n", RFID_READER_COUNT);
+    tapQueue.init();
+
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        Reader& r = readers[i];
+        r = {};
+        r.rstPin = RST_PINS[i];
+        r.irqPin = IRQ_PINS[i];
+
+        // RST pin - active-low reset
+        pinMode(r.rstPin, OUTPUT);
+        digitalWrite(r.rstPin, HIGH);
+        if (r.irqPin != NO_IRQ) pinMode(r.irqPin, INPUT_PULLUP);
+
+        // Create PN532 driver (hardware SPI, SS pin)
+        r.pn532 = new (driverStorage[i]) Adafruit_PN532(SS_PINS[i]);
+        r.pn532->begin();
+
+        // Initialize timing state
+        r.lastSuccessfulReadMs = millis();
+        r.lastHealthCheckMs    = millis();
+
+        // Read firmware info
+        if (!readFirmwareVersion(r)) {
+            LOGW("[RFID] WARNING: No communication with PN532 %u (SS %u) - check wiring!\n",
+                 i, SS_PINS[i]);
+            r.samOk = false;
+            continue;
+        }
+        LOGI("======== RFID DIAGNOSTICS (PN532 %u) ========\n", i);
+        LOGI("  SS/IRQ  : %u / %s\n", SS_PINS[i], r.irqPin != NO_IRQ ? "wired" : "polled");
+        LOGI("  Door    : %u\n", Doors::forReader(i));
+        LOGI("  IC      : 0x%02X (expect 0x32)\n", r.ic);
+        LOGI("  Firmware: %d.%d\n", r.verMaj, r.verMin);
+        LOGI("  Support : 0x%02X\n", r.support);
+        LOGI("===========================================\n");
+
+        // Configure as passive NFC tag reader
+        r.pn532->SAMConfig();
+        r.samOk = true;
     }
-    lastReadMs = millis();
 
-    // ----- CONVERT UID TO HEX -----
-    char uidStr[15] = {0};  // 7 bytes -> 14 hex + null
-    for (uint8_t i = 0; i < uidLen && i < 7; i++) {
-        sprintf(uidStr + (i * 2), "%02X", uid[i]);
+    initialized = true;
+    LOGI("[RFID] Initialization complete\n");
+}
+
+void RFIDManager::poll() {
+    if (!initialized) return;
+
+    uint32_t now = millis();
+    bool reinitDone = false;
+
+    // IRQ readers: every pass, each costs one short SPI transaction at most
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        Reader& r = readers[i];
+        if (r.irqPin == NO_IRQ) continue;
+        if (maintainReader(r, i, now, reinitDone)) serviceIrqReader(r, i, now);
     }
 
-    Serial.printf("[RFID] UID=%s\n", uidStr);
+    // Polled readers: one blocking read per pass, taking turns
+    for (uint8_t n = 0; n < RFID_READER_COUNT; n++) {
+        uint8_t i = nextBlocking;
+        nextBlocking = (nextBlocking + 1) % RFID_READER_COUNT;
+        Reader& r = readers[i];
+        if (r.irqPin != NO_IRQ) continue;
+
+        if (maintainReader(r, i, now, reinitDone)) serviceBlockingReader(r, i);
+        break;
+    }
+}
+
+bool RFIDManager::decideNext(TickType_t wait) {
+    Tap tap;
+    if (!tapQueue.receive(&tap, wait)) return false;
+    tapWaitSeconds.observe(micros() - tap.readUs);
+    submitUID(tap.uid, nullptr, tap.reader);
+    return true;
+}
+
+StageQueueStats RFIDManager::tapQueueStats() {
+    return tapQueue.stats();
+}
+
+EventType RFIDManager::submitUID(const char* uidStr, RFIDTapTiming* timing, uint8_t reader) {
+    LOGI("[RFID] Reader %u UID=%s\n", reader, uidStr);
+
+    const uint8_t door = Doors::forReader(reader);
 
     // ---- ACCESS DECISION ----
-    AccessResult result = AccessDecision::evaluate(String(uidStr));
+    // Recent unknown / blacklisted cards are answered from RAM
+    uint32_t t0 = micros();
+    AccessResult result;
+    uint16_t repeat = 0;
+    if (!TapCache::lookup(uidStr, door, result, repeat)) {
+        bool fromStore = false;
+        result = AccessDecision::evaluate(String(uidStr), &fromStore);
+        if (fromStore) TapCache::remember(uidStr, door, result);
+    }
+    uint32_t t1 = micros();
+    decisionSeconds.observe(t1 - t0);
+    Trace::record(TraceEvent::DECISION, t0, (int16_t)result);
 
     Event evt{};
     strncpy(evt.uid, uidStr, sizeof(evt.uid) - 1);
+    evt.door   = door;
+    evt.reader = reader;
+    evt.repeat = repeat;
 
     switch (result) {
         case AccessResult::GRANT:
             evt.type = EventType::RFID_GRANTED;
+            tapsGranted.inc();
             break;
 
         case AccessResult::DENY_BLACKLIST:
             evt.type = EventType::RFID_DENIED;
+            tapsDenied.inc();
             break;
 
         case AccessResult::PENDING_NEW:
-            Serial.printf("[RFID] UID %s -> PENDING (NEW)\n", uidStr);
+            LOGD("[RFID] UID %s -> PENDING (NEW)\n", uidStr);
             evt.type = EventType::RFID_PENDING;
+            tapsPending.inc();
+            PendingPush::notify(uidStr, door);   // queued; posted from the loop task
             break;
 
         case AccessResult::PENDING_REPEAT:
-            Serial.printf("[RFID] UID %s -> PENDING (REPEAT)\n", uidStr);
+            LOGD("[RFID] UID %s -> PENDING (REPEAT)\n", uidStr);
             evt.type = EventType::RFID_PENDING;
+            tapsPending.inc();
             break;
 
         case AccessResult::INVALID:
         default:
             evt.type = EventType::RFID_INVALID;
+            tapsInvalid.inc();
             break;
     }
 
     EventQueue::send(evt);
 
-    // Small delay to let reader recover before next poll
-    delay(20);
+    if (timing) {
+        timing->decisionUs = t1 - t0;
+        timing->enqueueUs  = micros() - t1;
+    }
+    return evt.type;
 }
 
 RFIDHealth RFIDManager::getHealth() {
     RFIDHealth h = {};
 
-    if (!pn532) {
-        h.communicationOk = false;
-        h.pollCount       = pollCount;
-        h.reinitCount     = reinitCount;
-        return h;
-    }
-
     // IMPORTANT: Do NOT call pn532->getFirmwareVersion() here!
     // getHealth() is called from Core 0 (HealthMonitor), while poll()
     // runs on Core 1 using the same SPI bus.  Issuing SPI commands from
@@ -238,14 +418,40 @@ RFIDHealth RFIDManager::getHealth() {
     //   1) Health check always reports "Failed"
     //   2) Card reads return garbage UIDs → phantom pending entries
     // Instead, return the cached values that poll() already maintains.
-    h.communicationOk    = samOk;  // updated by init() and reinitReader()
-    h.samConfigured      = samOk;
-    h.ic                 = cachedIC;
-    h.firmwareVersionMaj = cachedVerMaj;
-    h.firmwareVersionMin = cachedVerMin;
-    h.firmwareSupport    = cachedSupport;
-    h.pollCount          = pollCount;
-    h.reinitCount        = reinitCount;
+    h.communicationOk = initialized;
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        const Reader& r = readers[i];
+        h.communicationOk = h.communicationOk && r.samOk;  // updated by init() and reinitReader()
+        h.pollCount      += r.pollCount;
+        h.reinitCount    += r.reinitCount;
+    }
+    h.samConfigured      = h.communicationOk;
+    h.ic                 = readers[0].ic;
+    h.firmwareVersionMaj = readers[0].verMaj;
+    h.firmwareVersionMin = readers[0].verMin;
+    h.firmwareSupport    = readers[0].support;
+
+    return h;
+}
+
+uint8_t RFIDManager::readerCount() {
+    return RFID_READER_COUNT;
+}
 
+RFIDReaderHealth RFIDManager::getReaderHealth(uint8_t reader) {
+    RFIDReaderHealth h = {};
+    if (reader >= RFID_READER_COUNT) return h;
+
+    const Reader& r = readers[reader];
+    h.communicationOk    = r.samOk;
+    h.irqDriven          = r.irqPin != NO_IRQ;
+    h.door               = Doors::forReader(reader);
+    h.ic                 = r.ic;
+    h.firmwareVersionMaj = r.verMaj;
+    h.firmwareVersionMin = r.verMin;
+    h.pollCount          = r.pollCount;
+    h.reinitCount        = r.reinitCount;
+    h.tapCount           = r.tapCount;
+    h.lastTapMs          = r.lastTapMs;
     return h;
 }
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "core/event_types.h"
+#include "core/stage_queue.h"
 
 // ================= RFID EVENT TYPES =================
 
@@ -19,26 +21,66 @@ struct RFIDEvent {
 };
 
 // ================= RFID MANAGER INTERFACE =================
+// Owns RFID_READER_COUNT PN532s on one SPI bus (config.h) and schedules
+// their transactions from poll() on Core 1:
+//   - readers with an IRQ line are armed (InListPassiveTarget sent) and
+//     collected once IRQ goes low, so they never block the loop
+//   - the rest get one blocking read of RFID_READ_TIMEOUT_MS per poll,
+//     taking turns round-robin
+// so a silent reader costs the others at most one short read per poll.
+// Health checks, reinit and statistics are kept per reader.
+//
+// poll() only reads: each tap goes on a bounded queue and decideNext(),
+// on the decision task, looks it up and raises the event.
 
-// RFID Health Information (PN532)
+// RFID Health Information (PN532), all readers combined
 struct RFIDHealth {
-    bool communicationOk;       // Can talk to PN532 over SPI
-    bool samConfigured;         // SAM configuration succeeded
-    uint8_t ic;                 // PN532 IC code (should be 0x32)
-    uint8_t firmwareVersionMaj; // Firmware major version
-    uint8_t firmwareVersionMin; // Firmware minor version
-    uint8_t firmwareSupport;    // Firmware supported features bitmask
-    uint32_t pollCount;         // Total poll() invocations
-    uint32_t reinitCount;       // How many times we reinitialized
+    bool communicationOk;       // Can talk to every PN532 over SPI
+    bool samConfigured;         // SAM configuration succeeded on every reader
+    uint8_t ic;                 // PN532 IC code of reader 0 (should be 0x32)
+    uint8_t firmwareVersionMaj; // Firmware major version (reader 0)
+    uint8_t firmwareVersionMin; // Firmware minor version (reader 0)
+    uint8_t firmwareSupport;    // Firmware supported features bitmask (reader 0)
+    uint32_t pollCount;         // Reader transactions, all readers
+    uint32_t reinitCount;       // How many times we reinitialized, all readers
+};
+
+// One reader's view, from cached state only (no SPI)
+struct RFIDReaderHealth {
+    bool     communicationOk;
+    bool     irqDriven;
+    uint8_t  door;               // Doors::NONE if unbound
+    uint8_t  ic;
+    uint8_t  firmwareVersionMaj;
+    uint8_t  firmwareVersionMin;
+    uint32_t pollCount;
+    uint32_t reinitCount;
+    uint32_t tapCount;
+    uint32_t lastTapMs;          // millis(), 0 = never
+};
+
+// Per-tap stage timings filled by submitUID() (microseconds)
+struct RFIDTapTiming {
+    uint32_t decisionUs;        // AccessDecision::evaluate
+    uint32_t enqueueUs;         // EventQueue::send
 };
 
 class RFIDManager {
 public:
-    static void init(uint8_t ssPin, uint8_t rstPin);
-    static void poll();   // Non-blocking, called repeatedly on Core 1
+    static void init();   // every reader in RFID_READER_* (config.h)
+    static void poll();   // Non-blocking for IRQ readers, reader task (Core 1)
+
+    // Decision task: waits up to `wait` for a tap and runs submitUID() on it.
+    // False if none arrived.
+    static bool decideNext(TickType_t wait);
+    static StageQueueStats tapQueueStats();
     static RFIDHealth getHealth();  // Get current RFID health status
 
-private:
-    static void emitEvent(RFIDEventType type, const char* uid);
-    static bool isValidUID(const char* uid);
+    static uint8_t readerCount();
+    static RFIDReaderHealth getReaderHealth(uint8_t reader);
+
+    // Decision + event path for a UID already read off the card by
+    // `reader`. Also used by the host-side log replay tool.
+    static EventType submitUID(const char* uidStr, RFIDTapTiming* timing = nullptr,
+                               uint8_t reader = 0);
 };
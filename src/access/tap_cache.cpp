@@ -0,0 +1,169 @@
+#include "tap_cache.h"
+#include <Arduino.h>
+#include <string.h>
+#include <time.h>
+#include "config/config.h"
+#include "storage/nvs_store.h"
+#include "core/metrics.h"
+
+// ================= STATE =================
+
+struct Entry {
+    bool         used;
+    char         uid[15];
+    AccessResult verdict;
+    uint32_t     generation;     // NVSStore::generation() when cached
+    uint8_t      door;
+    uint32_t     lastMs;         // LRU order and burst gap
+    uint32_t     burstStartMs;   // last summary or first tap of the burst
+    uint32_t     firstEpoch;
+    uint32_t     lastEpoch;
+    uint16_t     repeats;        // not yet summarised
+};
+
+static Entry    entries[TAP_CACHE_ENTRIES] = {};
+static uint32_t missGeneration = 0;   // read before the NVS lookup that follows a miss
+
+// Bursts cut short by eviction or invalidation, waiting for takeEndedBurst()
+static TapBurst ended[TAP_CACHE_ENTRIES];
+static uint8_t  endedCount = 0;
+
+// ================= METRICS =================
+
+static Counter hitsTotal("emlock_tap_cache_lookups_total", "Tap cache lookups", "result=\"hit\"");
+static Counter missesTotal("emlock_tap_cache_lookups_total", "Tap cache lookups", "result=\"miss\"");
+static Counter evictionsTotal("emlock_tap_cache_evictions_total", "UIDs pushed out of the tap cache");
+static Counter suppressedTotal("emlock_tap_repeats_suppressed_total", "Repeated taps answered without a log record");
+
+// ================= PRIVATE =================
+
+static Entry* find(const char* uid) {
+    for (uint8_t i = 0; i < TAP_CACHE_ENTRIES; i++) {
+        if (entries[i].used && strcmp(entries[i].uid, uid) == 0) return &entries[i];
+    }
+    return nullptr;
+}
+
+static void fillBurst(const Entry& e, TapBurst& b) {
+    memset(&b, 0, sizeof(b));
+    strncpy(b.uid, e.uid, sizeof(b.uid) - 1);
+    b.verdict    = e.verdict;
+    b.door       = e.door;
+    b.repeats    = e.repeats;
+    b.firstEpoch = e.firstEpoch;
+    b.lastEpoch  = e.lastEpoch;
+}
+
+// Hands unsummarised repeats to the ended list; the oldest gives way
+static void endBurst(Entry& e) {
+    if (e.repeats == 0) return;
+    if (endedCount == TAP_CACHE_ENTRIES) {
+        memmove(&ended[0], &ended[1], sizeof(ended[0]) * (TAP_CACHE_ENTRIES - 1));
+        endedCount--;
+    }
+    fillBurst(e, ended[endedCount++]);
+    e.repeats = 0;
+}
+
+// ================= PUBLIC =================
+
+bool TapCache::lookup(const char* uid, uint8_t door, AccessResult& result, uint16_t& repeat) {
+    uint32_t generation = NVSStore::generation();
+    Entry*   e          = find(uid);
+    if (e && e->generation != generation) {
+        endBurst(*e);
+        e->used = false;
+        e = nullptr;
+    }
+    if (!e) {
+        // A change landing during the lookup leaves the entry already stale
+        missGeneration = generation;
+        missesTotal.inc();
+        return false;
+    }
+    hitsTotal.inc();
+
+    uint32_t now     = millis();
+    bool     inBurst = now - e->lastMs < TAP_BURST_GAP_MS;
+    if (inBurst) {
+        uint32_t epoch = (uint32_t)time(nullptr);
+        if (e->repeats == 0) e->firstEpoch = epoch;
+        if (e->repeats < UINT16_MAX) e->repeats++;
+        e->lastEpoch = epoch;
+        suppressedTotal.inc();
+    } else {
+        endBurst(*e);
+        e->burstStartMs = now;
+    }
+    e->lastMs = now;
+    e->door   = door;
+
+    result = e->verdict;
+    repeat = inBurst ? e->repeats : 0;
+    return true;
+}
+
+void TapCache::remember(const char* uid, uint8_t door, AccessResult result) {
+    if (result == AccessResult::PENDING_NEW) result = AccessResult::PENDING_REPEAT;
+    if (result != AccessResult::DENY_BLACKLIST && result != AccessResult::PENDING_REPEAT) return;
+
+    Entry* e = find(uid);
+    if (!e) {
+        // Free slot, else the least recently tapped
+        e = &entries[0];
+        for (uint8_t i = 0; i < TAP_CACHE_ENTRIES; i++) {
+            if (!entries[i].used) { e = &entries[i]; break; }
+            if ((int32_t)(entries[i].lastMs - e->lastMs) < 0) e = &entries[i];
+        }
+        if (e->used) {
+            endBurst(*e);
+            evictionsTotal.inc();
+        }
+    } else {
+        endBurst(*e);
+    }
+
+    uint32_t now = millis();
+    memset(e, 0, sizeof(*e));
+    e->used         = true;
+    strncpy(e->uid, uid, sizeof(e->uid) - 1);
+    e->verdict      = result;
+    e->generation   = missGeneration;
+    e->door         = door;
+    e->lastMs       = now;
+    e->burstStartMs = now;
+}
+
+bool TapCache::takeEndedBurst(TapBurst& out) {
+    if (endedCount > 0) {
+        out = ended[0];
+        memmove(&ended[0], &ended[1], sizeof(ended[0]) * (endedCount - 1));
+        endedCount--;
+        return true;
+    }
+
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < TAP_CACHE_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (!e.used || e.repeats == 0) continue;
+        if (now - e.lastMs < TAP_BURST_GAP_MS && now - e.burstStartMs < TAP_BURST_MAX_MS) continue;
+
+        fillBurst(e, out);
+        e.repeats      = 0;
+        e.burstStartMs = now;
+        return true;
+    }
+    return false;
+}
+
+TapCacheStats TapCache::stats() {
+    TapCacheStats s = {};
+    s.hits       = hitsTotal.value();
+    s.misses     = missesTotal.value();
+    s.evictions  = evictionsTotal.value();
+    s.suppressed = suppressedTotal.value();
+    for (uint8_t i = 0; i < TAP_CACHE_ENTRIES; i++) {
+        if (entries[i].used) s.entries++;
+    }
+    return s;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include "access/access_decision.h"
+
+// ================= TAP CACHE =================
+// RAM LRU of recently seen unknown (pending) and blacklisted UIDs, so a
+// card held against the reader is answered without NVS probes, the
+// ThreadSafe mutex or a pending write.
+//
+// Taps of a cached UID less than TAP_BURST_GAP_MS apart form a burst. The
+// first tap of a burst is logged and beeped as usual; the repeats are only
+// counted and come back from takeEndedBurst() as one summary once the
+// card goes quiet, or every TAP_BURST_MAX_MS while it doesn't. Access log
+// writes under abuse are bounded by time, not by taps.
+//
+// Cached verdicts are dropped whenever NVSStore::generation() moves
+// (UID sync, whitelist / blacklist / remove, pending cleared). Used from
+// the decision task only.
+
+struct TapBurst {
+    char         uid[15];
+    AccessResult verdict;      // DENY_BLACKLIST or PENDING_REPEAT
+    uint8_t      door;         // of the latest repeat
+    uint16_t     repeats;      // taps after the logged one
+    uint32_t     firstEpoch;   // time() of the first and last repeat
+    uint32_t     lastEpoch;
+};
+
+struct TapCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t suppressed;   // repeats that wrote nothing
+    uint8_t  entries;
+};
+
+class TapCache {
+public:
+    // Cached verdict for `uid`, counting the tap; `repeat` is its position
+    // in the current burst (0 = first tap, log it as usual)
+    static bool lookup(const char* uid, uint8_t door, AccessResult& result, uint16_t& repeat);
+
+    // Verdict read from NVS after a missed lookup(); only unknown and
+    // blacklisted cards are kept
+    static void remember(const char* uid, uint8_t door, AccessResult result);
+
+    // One summary of a finished (or long-running) burst per call
+    static bool takeEndedBurst(TapBurst& out);
+
+    static TapCacheStats stats();
+};
@@ -1,69 +1,122 @@
 #include "buzzer_manager.h"
 #include "../config/config.h"
 #include <Arduino.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "../core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_HARDWARE
 
 // LEDC channel for buzzer PWM
 #define BUZZER_CHANNEL  0
 #define BUZZER_RESOLUTION 8
 
+// ================= TONES =================
+// One step per note or gap; freq 0 = silence. A pattern ends at ms 0.
+struct ToneStep {
+    uint16_t freq;
+    uint16_t ms;
+};
+
+// GRANT: Two ascending happy beeps (success sound)
+static const ToneStep TONE_GRANT[]   = { {1000, 100}, {0, 50}, {1500, 150}, {0, 0} };
+// DENY: Three short descending harsh beeps (error/rejection)
+static const ToneStep TONE_DENY[]    = { {800, 150}, {0, 50}, {600, 150}, {0, 50}, {400, 200}, {0, 0} };
+// PENDING: Single medium beep (acknowledgment, awaiting decision)
+static const ToneStep TONE_PENDING[] = { {1200, 200}, {0, 0} };
+// EXIT: Quick double chirp (door exit confirmation)
+static const ToneStep TONE_EXIT[]    = { {1800, 80}, {0, 40}, {1800, 80}, {0, 0} };
+// REMOTE: Ascending melody (remote unlock notification)
+static const ToneStep TONE_REMOTE[]  = { {800, 100}, {0, 30}, {1200, 100}, {0, 30}, {1600, 150}, {0, 0} };
+// INVALID: Long low buzz (invalid card format)
+static const ToneStep TONE_INVALID[] = { {300, 400}, {0, 0} };
+// REPEAT: Short low tick (same refused card again, already logged)
+static const ToneStep TONE_REPEAT[]  = { {600, 40}, {0, 0} };
+
+// ================= STATE =================
+// Patterns are stepped by an esp_timer, so play*() returns at once and
+// the actuator task is free for the next event. Only the timer task
+// touches the LEDC channel; a new pattern replaces one still playing.
+static esp_timer_handle_t stepTimer = nullptr;
+static const ToneStep*    pattern   = nullptr;
+static uint8_t            step      = 0;
+static portMUX_TYPE       toneMux   = portMUX_INITIALIZER_UNLOCKED;
+
+// esp_timer task
+static void onStep(void*) {
+    ToneStep s = { 0, 0 };
+    portENTER_CRITICAL(&toneMux);
+    if (pattern) {
+        s = pattern[step];
+        if (s.ms == 0) pattern = nullptr;
+        else step++;
+    }
+    portEXIT_CRITICAL(&toneMux);
+
+    ledcWriteTone(BUZZER_CHANNEL, s.freq);
+    if (s.ms) esp_timer_start_once(stepTimer, (uint64_t)s.ms * 1000);
+}
+
+static void play(const ToneStep* p) {
+    if (!stepTimer) return;
+    esp_timer_stop(stepTimer);   // fails harmlessly when idle
+    portENTER_CRITICAL(&toneMux);
+    pattern = p;
+    step    = 0;
+    portEXIT_CRITICAL(&toneMux);
+    esp_timer_start_once(stepTimer, 1);
+}
+
+// ================= PUBLIC =================
+
 void BuzzerManager::init() {
     ledcSetup(BUZZER_CHANNEL, 2000, BUZZER_RESOLUTION);
     ledcAttachPin(BUZZER_PIN, BUZZER_CHANNEL);
     ledcWriteTone(BUZZER_CHANNEL, 0); // Start silent
-    Serial.println("[BUZZER] Initialized on pin " + String(BUZZER_PIN));
-}
 
-// Helper to play a tone
-static void playTone(uint32_t freq, uint32_t duration) {
-    ledcWriteTone(BUZZER_CHANNEL, freq);
-    delay(duration);
-    ledcWriteTone(BUZZER_CHANNEL, 0);
+    esp_timer_create_args_t args = {};
+    args.callback        = onStep;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name            = "buzzer_step";
+    if (esp_timer_create(&args, &stepTimer) != ESP_OK) {
+        stepTimer = nullptr;
+        LOGE("[BUZZER] Step timer unavailable, buzzer silent\n");
+        return;
+    }
+    LOGI("[BUZZER] Initialized on pin %d\n", BUZZER_PIN);
 }
 
-// GRANT: Two ascending happy beeps (success sound)
 void BuzzerManager::playGrantTone() {
-    Serial.println("[BUZZER] GRANT");
-    playTone(1000, 100);  // Low beep
-    delay(50);
-    playTone(1500, 150);  // Higher beep
+    LOGD("[BUZZER] GRANT\n");
+    play(TONE_GRANT);
 }
 
-// DENY: Three short descending harsh beeps (error/rejection)
 void BuzzerManager::playDenyTone() {
-    Serial.println("[BUZZER] DENY");
-    playTone(800, 150);
-    delay(50);
-    playTone(600, 150);
-    delay(50);
-    playTone(400, 200);
+    LOGD("[BUZZER] DENY\n");
+    play(TONE_DENY);
 }
 
-// PENDING: Single medium beep (acknowledgment, awaiting decision)
 void BuzzerManager::playPendingTone() {
-    Serial.println("[BUZZER] PENDING");
-    playTone(1200, 200);
+    LOGD("[BUZZER] PENDING\n");
+    play(TONE_PENDING);
 }
 
-// EXIT: Quick double chirp (door exit confirmation)
 void BuzzerManager::playExitTone() {
-    Serial.println("[BUZZER] EXIT");
-    playTone(1800, 80);
-    delay(40);
-    playTone(1800, 80);
+    LOGD("[BUZZER] EXIT\n");
+    play(TONE_EXIT);
 }
 
-// REMOTE: Ascending melody (remote unlock notification)
 void BuzzerManager::playRemoteTone() {
-    Serial.println("[BUZZER] REMOTE");
-    playTone(800, 100);
-    delay(30);
-    playTone(1200, 100);
-    delay(30);
-    playTone(1600, 150);
+    LOGD("[BUZZER] REMOTE\n");
+    play(TONE_REMOTE);
 }
 
-// INVALID: Long low buzz (invalid card format)
 void BuzzerManager::playInvalid() {
-    Serial.println("[BUZZER] INVALID");
-    playTone(300, 400);
+    LOGD("[BUZZER] INVALID\n");
+    play(TONE_INVALID);
+}
+
+void BuzzerManager::playRepeatTone() {
+    LOGD("[BUZZER] REPEAT\n");
+    play(TONE_REPEAT);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+// Non-blocking: each play*() starts a pattern on the buzzer's esp_timer
+// and returns; a later call cuts off one still playing.
 class BuzzerManager {
 public:
     static void init();
@@ -10,4 +12,5 @@ public:
     static void playExitTone();
     static void playRemoteTone();
     static void playInvalid();
+    static void playRepeatTone();
 };
@@ -4,62 +4,96 @@
 #include <WiFi.h>
 #include "../core/event_queue.h"
 #include "../core/thread_safe.h"
+#include "../core/heap_monitor.h"
+#include "../core/cloud_arena.h"
+#include "../core/json_writer.h"
+#include "../core/metrics.h"
+#include "../core/trace.h"
+#include "../config/config.h"
+#include "../storage/log_format.h"
 #include "../storage/log_store.h"
 #include "../storage/nvs_store.h"
+#include "../access/doors.h"
+#include "log_sync.h"
 
 #include <ArduinoJson.h>
+#include <ctype.h>
 
 static String deviceId;
-static String lastAckedCmd; // runtime cache
-
-
-// ---------- JSON ESCAPE (REQUIRED) ----------
-static String jsonEscape(const String& s) {
-    String out;
-    out.reserve(s.length() + 16);
-
-    for (size_t i = 0; i < s.length(); i++) {
-        char c = s[i];
-        switch (c) {
-            case '\"': out += "\\\""; break;
-            case '\\': out += "\\\\"; break;
-            case '\n': out += "\\n";  break;
-            case '\r': out += "\\r";  break;
-            case '\t': out += "\\t";  break;
-            default:   out += c;
-        }
-    }
-    return out;
+static char   lastAckedCmd[48] = "";   // runtime cache
+static char   pollUrl[CLOUD_URL_BYTES];   // built in init(), again on the table fallback
+static bool   pollRpc = true;             // false once poll_device_commands() is missing (404)
+
+// ---------- POLL SCHEDULE ----------
+// Fast while something is happening, doubling up to CMD_POLL_IDLE_MAX_MS
+// once it stops; every interval is spread by +/- CMD_POLL_JITTER_PCT
+static uint32_t pollBaseMs    = CMD_POLL_FAST_MS;
+static uint32_t nextPollMs    = 0;
+static uint32_t activeUntilMs = 0;
+
+// ---------- METRICS ----------
+static const uint32_t POLL_BOUNDS_MS[] = { 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+static Counter   pollsTotal("emlock_cmd_polls_total", "device_commands polls");
+static Counter   pollFailures("emlock_cmd_poll_failures_total", "Polls without a readable HTTP 200 response");
+static Counter   receivedTotal("emlock_cmd_received_total", "New commands taken for execution");
+static Counter   ackFailures("emlock_cmd_ack_failures_total", "Command results the cloud did not accept");
+static Histogram pollSeconds("emlock_cmd_poll_seconds", "Round trip of one device_commands poll",
+                             POLL_BOUNDS_MS, sizeof(POLL_BOUNDS_MS) / sizeof(POLL_BOUNDS_MS[0]),
+                             1000.0f);
+static Gauge     pollInterval("emlock_cmd_poll_interval_ms", "Current base interval between command polls");
+
+
+static void noteAcked(const char* cmdId) {
+    strncpy(lastAckedCmd, cmdId, sizeof(lastAckedCmd) - 1);
+}
+
+static void copyUpper(char* dst, size_t size, const char* src) {
+    size_t n = 0;
+    for (; src[n] && n < size - 1; n++) dst[n] = toupper((uint8_t)src[n]);
+    dst[n] = '\0';
+}
+
+
+// Query bounds arrive as epoch seconds or a log-style timestamp string
+static uint32_t parseQueryTime(JsonVariant v) {
+    if (v.is<const char*>()) return LogFormat::parseTimestamp(v.as<const char*>());
+    return v.as<uint32_t>();
 }
 
 
-static bool ackCommand(const String& cmdId, const String& result) {
+static bool ackCommand(const char* cmdId, const char* result) {
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
     HTTPClient http;
 
-    String url = String(SUPABASE_URL) +
-        "/rest/v1/device_commands?id=eq." + cmdId;
+    char url[CLOUD_URL_BYTES];
+    snprintf(url, sizeof(url), SUPABASE_URL "/rest/v1/device_commands?id=eq.%s", cmdId);
 
     http.begin(url);
     http.addHeader("apikey", SUPABASE_KEY);
-    http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
     http.addHeader("Content-Type", "application/json");
 
-    String body =
-        "{\"status\":\"DONE\",\"result\":\"" + jsonEscape(result) + "\"}";
-
+    // The result travels as a JSON string: sized for its escaped form
+    ArenaBuffer body(JsonWriter::quotedLength(result) + 32);
+    JsonWriter w(body.data(), body.size());
+    w.beginObject().key("status").string("DONE").key("result").string(result).endObject();
 
-
-    int code = http.PATCH(body);
+    uint32_t t0 = micros();
+    int code = http.PATCH((uint8_t*)body.data(), w.length());
+    Trace::record(TraceEvent::HTTP_CMD_ACK, t0, code);
+    heap.checkpoint();
     http.end();
 
     if (code == 200 || code == 204) {
-        Serial.printf("[CMD] ACK OK %s\n", cmdId.c_str());
+        Serial.printf("[CMD] ACK OK %s\n", cmdId);
         return true;
     }
 
+    ackFailures.inc();
     Serial.printf(
         "[CMD][ACK FAIL] %s HTTP %d BODY=%s\n",
-        cmdId.c_str(), code, body.c_str()
+        cmdId, code, body.data()
     );
     return false;
 }
@@ -68,59 +102,124 @@ static bool ackCommand(const String& cmdId, const String& result) {
 
 
 
-void CommandProcessor::init() {
-    deviceId = WiFi.macAddress();
-    deviceId.replace(":", "");
-    lastAckedCmd = NVSStore::getLastCommandId();
-    Serial.println("[CMD] Last command restored: " + lastAckedCmd);
-
-    Serial.println("[CMD] Supabase processor ready for " + deviceId);
+static uint32_t jittered(uint32_t base) {
+    uint32_t span = base * CMD_POLL_JITTER_PCT / 100;
+    return base - span + random(2 * span + 1);
 }
 
+// Called before each poll: assumes the poll will find nothing
+static void scheduleIdle(uint32_t now) {
+    if ((int32_t)(activeUntilMs - now) > 0) pollBaseMs = CMD_POLL_FAST_MS;
+    else pollBaseMs = min(pollBaseMs * 2, (uint32_t)CMD_POLL_IDLE_MAX_MS);
+    nextPollMs = now + jittered(pollBaseMs);
+    pollInterval.set(pollBaseMs);
+}
 
-void CommandProcessor::update() {
-    if (WiFi.status() != WL_CONNECTED) return;
+// Brings the next poll forward, never later than already planned
+static void noteActivity(uint32_t now) {
+    activeUntilMs = now + CMD_POLL_ACTIVE_HOLD_MS;
+    pollBaseMs    = CMD_POLL_FAST_MS;
+    uint32_t next = now + jittered(pollBaseMs);
+    if ((int32_t)(next - nextPollMs) < 0) nextPollMs = next;
+    pollInterval.set(pollBaseMs);
+}
 
-    static uint32_t lastPoll = 0;
-    if (millis() - lastPoll < 3000) return;
-    lastPoll = millis();
+static void buildPollUrl() {
+    if (pollRpc) {
+        // {"cmds": [oldest PENDING command], "admin": someone has the device open}
+        snprintf(pollUrl, sizeof(pollUrl),
+                 SUPABASE_URL "/rest/v1/rpc/poll_device_commands?device=%s", deviceId.c_str());
+    } else {
+        snprintf(pollUrl, sizeof(pollUrl),
+                 SUPABASE_URL "/rest/v1/device_commands"
+                 "?device_id=eq.%s&status=eq.PENDING&order=created_at.asc&limit=1",
+                 deviceId.c_str());
+    }
+}
 
+// Response body goes straight into `response`, no String in between
+static bool fetchPendingCommand(ArenaBuffer& response) {
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
     HTTPClient http;
 
-    String url = String(SUPABASE_URL) +
-        "/rest/v1/device_commands"
-        "?device_id=eq." + deviceId +
-        "&status=eq.PENDING"
-        "&order=created_at.asc"
-        "&limit=1";
-
-    http.begin(url);
+    http.begin(pollUrl);
     http.addHeader("apikey", SUPABASE_KEY);
-    http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
     http.addHeader("Accept", "application/json");
 
+    uint32_t t0 = micros();
     int code = http.GET();
+    Trace::record(TraceEvent::HTTP_CMD_POLL, t0, code);
+    pollSeconds.observe((micros() - t0) / 1000);
+    pollsTotal.inc();
+    if (code == 404 && pollRpc) {
+        Serial.println("[CMD] poll_device_commands() missing, polling the table");
+        pollRpc = false;
+        buildPollUrl();
+    }
     if (code != 200) {
+        pollFailures.inc();
         http.end();
-        return;
+        return false;
     }
 
-    String payload = http.getString();
+    int read = http.writeToStream(&response);
+    heap.checkpoint();
     http.end();
+    if (read < 0 || response.overflowed()) {
+        pollFailures.inc();
+        Serial.printf("[CMD] Poll response unreadable or over %u bytes\n",
+                      (unsigned)response.capacity());
+        return false;
+    }
+    return true;
+}
+
+
+void CommandProcessor::init() {
+    deviceId = WiFi.macAddress();
+    deviceId.replace(":", "");
+    buildPollUrl();
+
+    // Doors that lose power together must not poll in lockstep afterwards
+    nextPollMs = millis() + random(CMD_POLL_FAST_MS);
+    pollInterval.set(pollBaseMs);
+
+    noteAcked(NVSStore::getLastCommandId().c_str());
+    Serial.printf("[CMD] Last command restored: %s\n", lastAckedCmd);
+
+    Serial.println("[CMD] Supabase processor ready for " + deviceId);
+}
+
+
+void CommandProcessor::update() {
+    if (WiFi.status() != WL_CONNECTED) return;
+
+    uint32_t now = millis();
+    if ((int32_t)(now - nextPollMs) < 0) return;
+    scheduleIdle(now);
+
+    // One scope for the whole poll: the payload and document outlive the request
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
+    ArenaBuffer payload(CLOUD_RESPONSE_BYTES);
+    if (!fetchPendingCommand(payload)) return;
     if (payload.length() < 5) return;
 
-    // Use DynamicJsonDocument to handle large SYNC_UIDS payloads
-    // (50 UIDs * ~20 bytes each + command envelope ≈ 2KB+)
-    DynamicJsonDocument doc(4096);
-    DeserializationError jsonErr = deserializeJson(doc, payload);
+    // Parsed in place (writable char*): the document holds only the tree,
+    // strings stay in `payload`, which outlives it
+    ArenaJsonDocument doc(CLOUD_CMD_DOC_BYTES);
+    DeserializationError jsonErr = deserializeJson(doc, payload.data(), payload.length());
     if (jsonErr) {
         Serial.printf("[CMD] JSON parse error: %s (payload len=%d)\n", 
                       jsonErr.c_str(), payload.length());
         return;
     }
 
-    JsonArray arr = doc.as<JsonArray>();
+    // poll_device_commands() wraps the rows; the table query returns them bare
+    JsonArray arr = doc.is<JsonArray>() ? doc.as<JsonArray>() : doc["cmds"].as<JsonArray>();
+    if (doc["admin"] | false) noteActivity(now);
     if (arr.size() == 0) return;
+    noteActivity(now);
 
     JsonObject cmd = arr[0];
 
@@ -131,23 +230,28 @@ void CommandProcessor::update() {
     if (!cmdId || !type) return;
 
     // Normalize and trim incoming type to avoid whitespace/case issues
-    String typeStr = String(type);
-    typeStr.trim();
+    char typeStr[24];
+    while (isspace((uint8_t)*type)) type++;
+    strncpy(typeStr, type, sizeof(typeStr) - 1);
+    typeStr[sizeof(typeStr) - 1] = '\0';
+    for (size_t n = strlen(typeStr); n > 0 && isspace((uint8_t)typeStr[n - 1]); n--) {
+        typeStr[n - 1] = '\0';
+    }
 
     // Normalize UID to uppercase so NVS keys always match the RFID reader
-    String uidNorm;
+    char uidNorm[24];
     if (uid && strlen(uid) > 0) {
-        uidNorm = String(uid);
-        uidNorm.toUpperCase();
-        uid = uidNorm.c_str();
+        copyUpper(uidNorm, sizeof(uidNorm), uid);
+        uid = uidNorm;
     }
 
     // -------- DUPLICATE GUARD --------
-    if (lastAckedCmd == cmdId) {
-        Serial.println("[CMD] Duplicate ignored: " + String(cmdId));
+    if (strcmp(lastAckedCmd, cmdId) == 0) {
+        Serial.printf("[CMD] Duplicate ignored: %s\n", cmdId);
         return;
     }
 
+    receivedTotal.inc();
     Serial.printf(
         "[CMD] Received: id=%s type=%s uid=%s\n",
         cmdId,
@@ -157,74 +261,95 @@ void CommandProcessor::update() {
 
     // -------- EXECUTION --------
 
-    if (typeStr == "REMOTE_UNLOCK") {
+    // payload (optional): {"door": n}, default door 0. A door that is
+    // present but not a uint8_t (256, -1, "1") is rejected, not door 0.
+    if (strcmp(typeStr, "REMOTE_UNLOCK") == 0) {
+        JsonVariant doorVar = cmd["payload"]["door"];
+        bool doorOk  = doorVar.isNull() || doorVar.is<uint8_t>();
+        uint8_t door = doorVar.isNull() ? 0 : doorVar.as<uint8_t>();
+        if (!doorOk || !Doors::valid(door)) {
+            if (doorOk) Serial.printf("[CMD] REMOTE_UNLOCK for unknown door %u\n", door);
+            else        Serial.println("[CMD] REMOTE_UNLOCK with a malformed door");
+            ackCommand(cmdId, "REMOTE_UNLOCK_BAD_DOOR");
+            noteAcked(cmdId);
+            NVSStore::setLastCommandId(cmdId);
+            return;
+        }
 
         Event e{};
         e.type = EventType::REMOTE_UNLOCK;
+        e.door = door;
         EventQueue::send(e);
 
         // Note: Log is recorded by access_controller when event is handled
 
         if (ackCommand(cmdId, "REMOTE_UNLOCK_OK")) {
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
         }
         return;
     }
 
-    // -------- GET_PENDING: Admin explicitly requests all pending UIDs --------
-    if (typeStr == "GET_PENDING") {
-        StaticJsonDocument<512> out;
-        JsonArray arr = out.to<JsonArray>();
+    // -------- GET_PENDING: Admin explicitly requests pending UIDs --------
+    // payload (optional): {"cursor": "<next of the previous page>", "limit": n}
+    // result: {"uids": [...], "next": "..." | null, "total": n}
+    if (strcmp(typeStr, "GET_PENDING") == 0) {
+        JsonObject payload = cmd["payload"];
 
-        // Lock mutex only for NVS access, release before logging
-        {
-            ThreadSafe::Guard guard(200);
-            if (!guard.isAcquired()) {
-                ackCommand(cmdId, "MUTEX_TIMEOUT");
-                return;
-            }
+        UidCursor cursor = {};
+        const char* cursorStr = payload["cursor"];
+        if (cursorStr) strncpy(cursor.after, cursorStr, sizeof(cursor.after) - 1);
 
-            NVSStore::forEachPending([&](const char* uid) {
-                // Use String to force ArduinoJson to copy the data
-                arr.add(String(uid));
-            });
-        } // Mutex released here
+        uint16_t limit = payload["limit"] | NVS_UID_PAGE_MAX;
+        if (limit == 0 || limit > NVS_UID_PAGE_MAX) limit = NVS_UID_PAGE_MAX;
 
-        String result;
-        serializeJson(arr, result);
+        // At most 18 bytes per UID ("...15...",) plus next / total
+        ArenaBuffer result(64 + limit * 18);
+        JsonWriter w(result.data(), result.size());
+        w.beginObject().key("uids").beginArray();
+
+        // Locks for the copy only; the JSON is written after release
+        UidPage page = NVSStore::listPage(UIDState::PENDING, cursor, (uint8_t)limit,
+                                          [&w](const char* uid) { w.string(uid); });
+        if (page.busy) {
+            ackCommand(cmdId, "MUTEX_TIMEOUT");
+            return;
+        }
+        w.endArray().key("next");
+        if (page.more) w.string(page.next.after);
+        else           w.null();
+        w.key("total").u32(NVSStore::pendingCount()).endObject();
 
-        // Log after mutex is released
         LogStore::log(LogEvent::UID_SYNC, "-", "get_pending");
 
-        if (ackCommand(cmdId, result)) {
-            lastAckedCmd = cmdId;
+        if (ackCommand(cmdId, result.data())) {
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
         }
         return;
     }
 
     // -------- GET_DEBUG: Get NVS stats --------
-    if (typeStr == "GET_DEBUG") {
+    if (strcmp(typeStr, "GET_DEBUG") == 0) {
 
-        String debug = "WL:" + String(NVSStore::whitelistCount()) +
-                       ",BL:" + String(NVSStore::blacklistCount()) +
-                       ",PD:" + String(NVSStore::pendingCount());
+        char debug[32];
+        snprintf(debug, sizeof(debug), "WL:%u,BL:%u,PD:%u",
+                 NVSStore::whitelistCount(), NVSStore::blacklistCount(), NVSStore::pendingCount());
 
-        Serial.println("[CMD] GET_DEBUG: " + debug);
+        Serial.printf("[CMD] GET_DEBUG: %s\n", debug);
 
         if (ackCommand(cmdId, debug)) {
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
         }
         return;
     }
 
     // -------- WHITELIST_ADD: Add UID to whitelist --------
-    if (typeStr == "WHITELIST_ADD") {
+    if (strcmp(typeStr, "WHITELIST_ADD") == 0) {
         if (!uid || strlen(uid) == 0) {
             ackCommand(cmdId, "WHITELIST_ADD_NO_UID");
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
             return;
         }
@@ -242,25 +367,25 @@ void CommandProcessor::update() {
         } // Mutex released here
 
         if (success) {
-            Serial.println("[CMD] Whitelisted UID: " + String(uid));
+            Serial.printf("[CMD] Whitelisted UID: %s\n", uid);
             LogStore::log(LogEvent::UID_WHITELISTED, uid, "supabase");
             ackCommand(cmdId, "WHITELIST_ADD_OK");
         } else {
-            Serial.println("[CMD] Whitelist FAILED for UID: " + String(uid));
+            Serial.printf("[CMD] Whitelist FAILED for UID: %s\n", uid);
             LogStore::log(LogEvent::COMMAND_ERROR, uid, "wl_failed");
             ackCommand(cmdId, "WHITELIST_ADD_FAIL");
         }
 
-        lastAckedCmd = cmdId;
+        noteAcked(cmdId);
         NVSStore::setLastCommandId(cmdId);
         return;
     }
 
     // -------- BLACKLIST_ADD: Add UID to blacklist --------
-    if (typeStr == "BLACKLIST_ADD") {
+    if (strcmp(typeStr, "BLACKLIST_ADD") == 0) {
         if (!uid || strlen(uid) == 0) {
             ackCommand(cmdId, "BLACKLIST_ADD_NO_UID");
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
             return;
         }
@@ -278,25 +403,25 @@ void CommandProcessor::update() {
         } // Mutex released here
 
         if (success) {
-            Serial.println("[CMD] Blacklisted UID: " + String(uid));
+            Serial.printf("[CMD] Blacklisted UID: %s\n", uid);
             LogStore::log(LogEvent::UID_BLACKLISTED, uid, "supabase");
             ackCommand(cmdId, "BLACKLIST_ADD_OK");
         } else {
-            Serial.println("[CMD] Blacklist FAILED for UID: " + String(uid));
+            Serial.printf("[CMD] Blacklist FAILED for UID: %s\n", uid);
             LogStore::log(LogEvent::COMMAND_ERROR, uid, "bl_failed");
             ackCommand(cmdId, "BLACKLIST_ADD_FAIL");
         }
 
-        lastAckedCmd = cmdId;
+        noteAcked(cmdId);
         NVSStore::setLastCommandId(cmdId);
         return;
     }
 
     // -------- REMOVE_UID: Remove UID from all lists --------
-    if (typeStr == "REMOVE_UID") {
+    if (strcmp(typeStr, "REMOVE_UID") == 0) {
         if (!uid || strlen(uid) == 0) {
             ackCommand(cmdId, "REMOVE_UID_NO_UID");
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
             return;
         }
@@ -312,118 +437,117 @@ void CommandProcessor::update() {
             NVSStore::removeUID(uid);
         } // Mutex released here
 
-        Serial.println("[CMD] Removed UID: " + String(uid));
+        Serial.printf("[CMD] Removed UID: %s\n", uid);
         LogStore::log(LogEvent::UID_REMOVED, uid, "supabase");
         ackCommand(cmdId, "REMOVE_UID_OK");
 
-        lastAckedCmd = cmdId;
+        noteAcked(cmdId);
         NVSStore::setLastCommandId(cmdId);
         return;
     }
 
-    // -------- SYNC_LOGS: Send access logs to cloud (BATCHED) --------
-    if (typeStr == "SYNC_LOGS") {
-        Serial.println("[CMD] SYNC_LOGS received - batching logs");
-
-        // Build JSON array of all logs
-        String body = "[";
-        uint16_t count = 0;
-        bool first = true;
-
-        LogStore::forEach([&body, &count, &first](const LogEntry& entry) {
-            const char* eventType = nullptr;
-            
-            switch (entry.event) {
-                case LogEvent::ACCESS_GRANTED:
-                    eventType = "GRANTED";
-                    break;
-                case LogEvent::ACCESS_DENIED:
-                    eventType = "DENIED";
-                    break;
-                case LogEvent::UNKNOWN_CARD:
-                    eventType = "PENDING";
-                    break;
-                case LogEvent::REMOTE_UNLOCK:
-                    eventType = "REMOTE";
-                    break;
-                default:
-                    return;  // Skip unknown event types
-            }
+    // -------- QUERY_LOGS: Indexed lookup of on-device logs --------
+    // uid column = card filter (optional); payload:
+    //   {"from": epoch | "YYYY-MM-DD HH:MM:SS+05:30", "to": ..., "cursor": "seq:offset", "limit": n,
+    //    "events": ["ACCESS_DENIED", ...]}
+    if (strcmp(typeStr, "QUERY_LOGS") == 0) {
+        JsonObject payload = cmd["payload"];
 
-            // Convert timestamp to ISO 8601 format (replace space with T)
-            String isoTimestamp = String(entry.timestampStr);
-            isoTimestamp.replace(" ", "T");
-            
-            // Skip entries with invalid 1970 timestamps (before NTP sync)
-            if (isoTimestamp.startsWith("1970") || isoTimestamp.length() < 10) {
-                return;  // Skip this entry - don't add anything
-            }
+        LogQuery q = {};
+        q.uid  = uid;
+        q.from = parseQueryTime(payload["from"]);
+        q.to   = parseQueryTime(payload["to"]);
+        for (JsonVariant v : payload["events"].as<JsonArray>()) {
+            LogEvent evt;
+            const char* name = v.as<const char*>();
+            if (name && LogFormat::strToEvent(name, evt)) q.events |= logEventBit(evt);
+        }
 
-            // Add comma AFTER we know the entry is valid
-            if (!first) body += ",";
-            first = false;
+        LogCursor cursor = {};
+        const char* cursorStr = payload["cursor"];
+        if (cursorStr) {
+            unsigned long seq = 0, offset = 0;
+            if (sscanf(cursorStr, "%lu:%lu", &seq, &offset) == 2) {
+                cursor.seq = seq;
+                cursor.offset = offset;
+            }
+        }
 
-            // Include actual scan timestamp (logged_at)
-            body += "{\"device_id\":\"" + deviceId +
-                    "\",\"uid\":\"" + String(entry.uid) +
-                    "\",\"event_type\":\"" + String(eventType) +
-                    "\",\"logged_at\":\"" + isoTimestamp + "\"}";
-            count++;
+        uint16_t limit = payload["limit"] | LOG_QUERY_DEFAULT_LIMIT;
+        if (limit == 0 || limit > LOG_QUERY_MAX_LIMIT) limit = LOG_QUERY_MAX_LIMIT;
+
+        // A record with every field at its longest is 128 bytes
+        ArenaBuffer result(128 + limit * 136);
+        JsonWriter w(result.data(), result.size());
+        w.beginObject().key("records").beginArray();
+
+        uint32_t startUs = micros();
+        LogQueryResult r = LogStore::query(q, cursor, limit, [&w](const LogEntry& e) {
+            w.beginObject();
+            w.key("t").string(e.timestampStr);
+            w.key("e").string(LogFormat::eventToStr(e.event));
+            w.key("u").string(e.uid);
+            w.key("i").string(e.info);
+            if (e.door) w.key("d").u32(e.door);
+            w.endObject();
         });
+        uint32_t elapsedMs = (micros() - startUs) / 1000;
 
-        body += "]";
+        w.endArray().key("next");
+        if (r.more) {
+            w.raw("\"%lu:%lu\"", (unsigned long)r.next.seq, (unsigned long)r.next.offset);
+        } else {
+            w.null();
+        }
+        w.key("scanned").u32(r.segmentsScanned);
+        w.key("skipped").u32(r.segmentsSkipped);
+        w.key("ms").u32(elapsedMs);
+        w.endObject();
+
+        Serial.printf("[CMD] QUERY_LOGS uid=%s %lu..%lu -> %u records, %u/%u segments scanned, %lu ms\n",
+                      uid ? uid : "*", (unsigned long)q.from, (unsigned long)q.to,
+                      r.matched, r.segmentsScanned,
+                      r.segmentsScanned + r.segmentsSkipped, (unsigned long)elapsedMs);
+
+        if (ackCommand(cmdId, w.ok() ? result.data() : "QUERY_LOGS_OVERFLOW")) {
+            noteAcked(cmdId);
+            NVSStore::setLastCommandId(cmdId);
+        }
+        return;
+    }
 
-        String result;
-        if (count == 0) {
-            result = "LOGS_SYNCED:0";
-            Serial.println("[CMD] No logs to sync");
+    // -------- SYNC_LOGS: Upload the log backlog now --------
+    // LogSync trickles logs on its own; this just drains whatever is
+    // still waiting instead of waiting for the scheduler
+    if (strcmp(typeStr, "SYNC_LOGS") == 0) {
+        Serial.println("[CMD] SYNC_LOGS received - draining backlog");
+
+        uint32_t uploaded = 0;
+        int httpCode = 0;
+        char result[32];
+        if (LogSync::syncNow(uploaded, httpCode)) {
+            snprintf(result, sizeof(result), "LOGS_SYNCED:%lu", (unsigned long)uploaded);
+            Serial.printf("[CMD] Synced %lu logs\n", (unsigned long)uploaded);
         } else {
-            Serial.printf("[CMD] Sending %d logs in one request...\n", count);
-            Serial.println("[CMD] Payload preview:");
-            Serial.println(body.substring(0, min((unsigned int)500, body.length())));
-
-            HTTPClient post;
-            String url = String(SUPABASE_URL) + "/rest/v1/access_logs";
-
-            post.begin(url);
-            post.addHeader("apikey", SUPABASE_KEY);
-            post.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
-            post.addHeader("Content-Type", "application/json");
-            post.addHeader("Prefer", "return=minimal");
-
-            int code = post.POST(body);
-            String responseBody = post.getString();  // Capture response
-            post.end();
-
-            if (code == 201 || code == 200) {
-                result = "LOGS_SYNCED:" + String(count);
-                Serial.printf("[CMD] Batch insert OK - %d logs\n", count);
-                
-                // Clear local logs after successful sync
-                LogStore::clearAllLogs();
-                Serial.println("[CMD] Local logs cleared after sync");
-            } else {
-                result = "LOGS_SYNC_FAILED:" + String(code);
-                Serial.printf("[CMD] Batch insert FAILED HTTP %d\n", code);
-                Serial.println("[CMD] Error response:");
-                Serial.println(responseBody);
-            }
+            snprintf(result, sizeof(result), "LOGS_SYNC_FAILED:%d", httpCode);
+            Serial.printf("[CMD] Log sync FAILED HTTP %d after %lu logs\n",
+                          httpCode, (unsigned long)uploaded);
         }
-        
+
         if (ackCommand(cmdId, result)) {
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
         }
         return;
     }
 
     // -------- SYNC_UIDS: Full sync from server --------
-    if (typeStr == "SYNC_UIDS") {
+    if (strcmp(typeStr, "SYNC_UIDS") == 0) {
         Serial.println("[CMD] SYNC_UIDS received");
 
         JsonObject payload = cmd["payload"];
         if (payload.isNull()) {
             ackCommand(cmdId, "SYNC_UIDS_NO_PAYLOAD");
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
             return;
         }
@@ -433,7 +557,7 @@ void CommandProcessor::update() {
 
         if (wl.isNull() || bl.isNull()) {
             ackCommand(cmdId, "SYNC_UIDS_BAD_PAYLOAD");
-            lastAckedCmd = cmdId;
+            noteAcked(cmdId);
             NVSStore::setLastCommandId(cmdId);
             return;
         }
@@ -443,12 +567,13 @@ void CommandProcessor::update() {
             ThreadSafe::Guard guard(1000);  // Generous timeout for bulk operations
             if (!guard.isAcquired()) {
                 ackCommand(cmdId, "MUTEX_TIMEOUT");
-                lastAckedCmd = cmdId;
+                noteAcked(cmdId);
                 NVSStore::setLastCommandId(cmdId);
                 return;
             }
 
-            // Clear all local state first
+            // Clear all local state first; the batch writes only what changed
+            NVSStore::beginBatch();
             NVSStore::clearWhitelist();
             NVSStore::clearBlacklist();
             NVSStore::clearPending();
@@ -460,11 +585,11 @@ void CommandProcessor::update() {
             for (JsonVariant v : wl) {
                 const char* raw = v.as<const char*>();
                 if (!raw || strlen(raw) == 0) { wlFail++; continue; }
-                String uidUpper = String(raw);
-                uidUpper.toUpperCase();
-                bool ok = NVSStore::addToWhitelist(uidUpper.c_str(), true);  // bypassLimit for sync
+                char uidUpper[16];
+                copyUpper(uidUpper, sizeof(uidUpper), raw);
+                bool ok = NVSStore::addToWhitelist(uidUpper, true);  // bypassLimit for sync
                 if (ok) wlOk++; else wlFail++;
-                Serial.printf("[SYNC] WL %s -> %s\n", uidUpper.c_str(), ok ? "OK" : "FAIL");
+                Serial.printf("[SYNC] WL %s -> %s\n", uidUpper, ok ? "OK" : "FAIL");
             }
 
             // Apply blacklist from server
@@ -472,13 +597,14 @@ void CommandProcessor::update() {
             for (JsonVariant v : bl) {
                 const char* raw = v.as<const char*>();
                 if (!raw || strlen(raw) == 0) { blFail++; continue; }
-                String uidUpper = String(raw);
-                uidUpper.toUpperCase();
-                bool ok = NVSStore::addToBlacklist(uidUpper.c_str(), true);  // bypassLimit for sync
+                char uidUpper[16];
+                copyUpper(uidUpper, sizeof(uidUpper), raw);
+                bool ok = NVSStore::addToBlacklist(uidUpper, true);  // bypassLimit for sync
                 if (ok) blOk++; else blFail++;
-                Serial.printf("[SYNC] BL %s -> %s\n", uidUpper.c_str(), ok ? "OK" : "FAIL");
+                Serial.printf("[SYNC] BL %s -> %s\n", uidUpper, ok ? "OK" : "FAIL");
             }
 
+            NVSStore::commitBatch();
             Serial.printf("[SYNC] Applied WL: %d ok / %d fail, BL: %d ok / %d fail\n",
                           wlOk, wlFail, blOk, blFail);
 
@@ -492,21 +618,30 @@ void CommandProcessor::update() {
         } // Mutex released here
 
         // Log after mutex is released
-        String syncResult = "SYNC_UIDS_OK WL:" + String(NVSStore::whitelistCount()) +
-                            " BL:" + String(NVSStore::blacklistCount());
-        Serial.println("[SYNC] Final counts - " + syncResult);
+        char syncResult[40];
+        snprintf(syncResult, sizeof(syncResult), "SYNC_UIDS_OK WL:%u BL:%u",
+                 NVSStore::whitelistCount(), NVSStore::blacklistCount());
+        Serial.printf("[SYNC] Final counts - %s\n", syncResult);
         LogStore::log(LogEvent::UID_SYNC, "-", "cloud");
         ackCommand(cmdId, syncResult);
 
-        lastAckedCmd = cmdId;
+        noteAcked(cmdId);
         NVSStore::setLastCommandId(cmdId);
         return;
     }
 
     // ---- UNKNOWN COMMAND ----
-    Serial.println("[CMD] Unknown command type: " + typeStr);
-    LogStore::log(LogEvent::COMMAND_ERROR, typeStr.c_str(), "unknown_cmd");
+    Serial.printf("[CMD] Unknown command type: %s\n", typeStr);
+    LogStore::log(LogEvent::COMMAND_ERROR, typeStr, "unknown_cmd");
     ackCommand(cmdId, "UNKNOWN_COMMAND");
-    lastAckedCmd = cmdId;
+    noteAcked(cmdId);
     NVSStore::setLastCommandId(cmdId);
 }
+
+void CommandProcessor::expedite() {
+    noteActivity(millis());
+}
+
+uint32_t CommandProcessor::pollIntervalMs() {
+    return pollBaseMs;
+}
@@ -1,7 +1,18 @@
 #pragma once
 
+#include <stdint.h>
+
+// Polls device_commands on an adaptive schedule (CMD_POLL_* in config.h):
+// fast for a while after activity, backing off exponentially when idle,
+// with random jitter on every interval.
 class CommandProcessor {
 public:
     static void init();
     static void update();
+
+    // Poll fast for the next CMD_POLL_ACTIVE_HOLD_MS: an admin decision is
+    // likely (a new pending card was just reported). Loop task only.
+    static void expedite();
+
+    static uint32_t pollIntervalMs();   // current base interval, before jitter
 };
@@ -0,0 +1,295 @@
+#include "health_history.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <time.h>
+#include "wifi_manager.h"
+#include "supabase_config.h"
+#include "../config/config.h"
+#include "../core/thread_safe.h"
+#include "../core/heap_monitor.h"
+#include "../core/cloud_arena.h"
+#include "../core/json_writer.h"
+#include "../core/trace.h"
+
+// ========== STATE ==========
+// RAM ring of the newest samples; when it fills while offline the oldest
+// batch moves to an append-only spill file. Uploads drain the spill file
+// first so the cloud receives samples roughly in order.
+static HealthSample       ring[HEALTH_HISTORY_SAMPLES];
+static uint16_t           ringHead  = 0;   // oldest sample
+static uint16_t           ringCount = 0;
+static HealthSample       scratch[HEALTH_HISTORY_BATCH];
+static String             deviceId;
+static uint32_t           nextUploadMs = 0;
+static uint32_t           lastUploadMs = 0;
+static HealthHistoryStats stats = {};
+
+static const char* SPILL_PATH = "/health.bin";
+static uint32_t spillSize      = 0;
+static uint32_t spillReadPos   = 0;   // already uploaded
+static uint32_t spillBootStart = 0;   // bytes before this are from an earlier boot
+static bool     spillKnown     = false;
+
+// ========== DATING ==========
+// Samples taken before NTP sync carry only uptime; date them from the
+// current clock offset once it is known. Only valid within the same boot.
+static bool dateSample(HealthSample& s) {
+    if (s.epoch) return true;
+    if (!WiFiManager::isTimeValid()) return false;
+    uint32_t upNow = millis() / 1000;
+    s.epoch = (uint32_t)time(nullptr) - (upNow - s.uptimeSeconds);
+    return true;
+}
+
+static void popOldest(uint16_t n) {
+    ringHead   = (ringHead + n) % HEALTH_HISTORY_SAMPLES;
+    ringCount -= n;
+}
+
+// ========== SPILL ==========
+// Whatever is in the file at first touch predates this boot. Caller holds
+// the ThreadSafe guard.
+static void discoverSpillLocked() {
+    if (spillKnown) return;
+    spillKnown = true;
+
+    spillSize = 0;
+    if (LittleFS.exists(SPILL_PATH)) {
+        File f = LittleFS.open(SPILL_PATH, FILE_READ);
+        if (f) {
+            spillSize = f.size();
+            f.close();
+        }
+    }
+    spillSize     -= spillSize % sizeof(HealthSample);   // a torn tail is overwritten by the next spill
+    spillReadPos   = 0;
+    spillBootStart = spillSize;
+
+    if (spillSize) {
+        Serial.printf("[HEALTH] %lu bytes of spilled history from a previous boot\n",
+                      (unsigned long)spillSize);
+    }
+}
+
+// Moves the oldest batch from the ring to LittleFS. False if spilling is
+// disabled, the file is at its cap, or the filesystem is busy.
+// Writes go at spillSize, not the end of the file: a short write (full
+// filesystem) leaves part of a sample there, and LittleFS can't truncate,
+// so the next batch overwrites it instead of landing misaligned after it.
+static bool spillOldest() {
+#if HEALTH_HISTORY_SPILL
+    ThreadSafe::Guard guard(50);
+    if (!guard.isAcquired()) return false;
+    discoverSpillLocked();
+
+    uint16_t n = min(ringCount, (uint16_t)HEALTH_HISTORY_BATCH);
+    if (spillSize + n * sizeof(HealthSample) > HEALTH_HISTORY_SPILL_BYTES) return false;
+
+    uint32_t t0 = micros();
+    File f = LittleFS.open(SPILL_PATH, LittleFS.exists(SPILL_PATH) ? "r+" : FILE_WRITE);
+    if (!f) return false;
+    if (!f.seek(spillSize)) {
+        f.close();
+        return false;
+    }
+    uint16_t written = 0;
+    for (; written < n; written++) {
+        HealthSample s = ring[(ringHead + written) % HEALTH_HISTORY_SAMPLES];
+        dateSample(s);
+        if (f.write((const uint8_t*)&s, sizeof(s)) != sizeof(s)) break;
+    }
+    f.close();
+    Trace::record(TraceEvent::FLASH_SPILL, t0, written);
+
+    spillSize += written * sizeof(HealthSample);
+    popOldest(written);
+    return written == n;
+#else
+    return false;
+#endif
+}
+
+// Reads the next batch of spilled samples into scratch, dropping undated
+// ones from earlier boots. Returns samples read; `consumed` is file bytes.
+static int readSpill(uint16_t maxSamples, uint32_t& consumed) {
+    consumed = 0;
+    ThreadSafe::Guard guard(50);
+    if (!guard.isAcquired()) return -1;
+
+    File f = LittleFS.open(SPILL_PATH, FILE_READ);
+    if (!f || !f.seek(spillReadPos)) return -1;
+
+    uint16_t n = 0;
+    HealthSample s;
+    while (n < maxSamples &&
+           f.read((uint8_t*)&s, sizeof(s)) == sizeof(s)) {
+        uint32_t at = spillReadPos + consumed;
+        consumed += sizeof(s);
+        if (!s.epoch && (at < spillBootStart || !dateSample(s))) {
+            stats.dropped++;
+            continue;
+        }
+        scratch[n++] = s;
+    }
+    f.close();
+    return n;
+}
+
+static void removeSpill() {
+    ThreadSafe::Guard guard(50);
+    if (!guard.isAcquired()) return;
+    LittleFS.remove(SPILL_PATH);
+    spillSize      = 0;
+    spillReadPos   = 0;
+    spillBootStart = 0;
+}
+
+// ========== UPLOAD ==========
+// {"batch":{"d":"<device>","b":<first epoch>,"t":[seconds since previous],
+//           "h":[free heap],"l":[largest block KB],"m":[min free KB],
+//           "r":[rssi],"v":[mV],"f":[flags],"n":[reinits],"w":[disconnects]}}
+typedef int32_t (*SampleField)(const HealthSample&);
+
+static void appendColumn(JsonWriter& w, const char* key, uint16_t n, SampleField get) {
+    w.key(key).beginArray();
+    for (uint16_t i = 0; i < n; i++) w.i32(get(scratch[i]));
+    w.endArray();
+}
+
+static bool postBatch(uint16_t n) {
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
+    // Nine columns of up to 11 characters per sample
+    ArenaBuffer body(64 + deviceId.length() + n * 9 * 12);
+    JsonWriter w(body.data(), body.size());
+    w.beginObject().key("batch").beginObject();
+    w.key("d").string(deviceId.c_str());
+    w.key("b").u32(scratch[0].epoch);
+    w.key("t").beginArray();
+    uint32_t prev = scratch[0].epoch;
+    for (uint16_t i = 0; i < n; i++) {
+        w.i32((int32_t)(scratch[i].epoch - prev));
+        prev = scratch[i].epoch;
+    }
+    w.endArray();
+    appendColumn(w, "h", n, [](const HealthSample& s) { return (int32_t)s.freeHeapBytes; });
+    appendColumn(w, "l", n, [](const HealthSample& s) { return (int32_t)s.largestFreeBlockKb; });
+    appendColumn(w, "m", n, [](const HealthSample& s) { return (int32_t)s.minFreeHeapKb; });
+    appendColumn(w, "r", n, [](const HealthSample& s) { return (int32_t)s.wifiRssi; });
+    appendColumn(w, "v", n, [](const HealthSample& s) { return (int32_t)s.voltageMv; });
+    appendColumn(w, "f", n, [](const HealthSample& s) { return (int32_t)s.flags; });
+    appendColumn(w, "n", n, [](const HealthSample& s) { return (int32_t)s.rfidReinitCount; });
+    appendColumn(w, "w", n, [](const HealthSample& s) { return (int32_t)s.wifiDisconnectCount; });
+    w.endObject().endObject();
+    if (!w.ok()) {
+        stats.failures++;
+        Serial.printf("[HEALTH] History batch overflowed %u bytes, not sent\n", (unsigned)body.size());
+        return false;
+    }
+
+    HTTPClient http;
+    http.begin(SUPABASE_URL "/rest/v1/rpc/ingest_health_samples");
+    http.addHeader("apikey",        SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
+    http.addHeader("Content-Type",  "application/json");
+
+    uint32_t t0 = micros();
+    int code = http.POST((uint8_t*)body.data(), w.length());
+    Trace::record(TraceEvent::HTTP_HISTORY, t0, code);
+    heap.checkpoint();
+    http.end();
+    stats.lastHttpCode = code;
+
+    if (code != 200 && code != 204) {
+        stats.failures++;
+        Serial.printf("[HEALTH] History upload FAILED HTTP %d (%d samples)\n", code, n);
+        return false;
+    }
+    stats.uploaded += n;
+    Serial.printf("[HEALTH] Uploaded %d history samples (%u bytes)\n", n, (unsigned)w.length());
+    return true;
+}
+
+// One batch of up to maxSamples, spill file first. False on failure.
+static bool uploadOne(uint16_t maxSamples, bool& more) {
+    if (spillSize > spillReadPos) {
+        uint32_t consumed;
+        int n = readSpill(maxSamples, consumed);
+        if (n < 0) return false;
+        if (n > 0 && !postBatch(n)) return false;
+
+        spillReadPos += consumed;
+        if (consumed == 0 || spillReadPos >= spillSize) removeSpill();
+        more = spillSize > spillReadPos || ringCount > 0;
+        return true;
+    }
+
+    uint16_t n = min(ringCount, maxSamples);
+    for (uint16_t i = 0; i < n; i++) {
+        scratch[i] = ring[(ringHead + i) % HEALTH_HISTORY_SAMPLES];
+        dateSample(scratch[i]);
+    }
+    if (n > 0 && !postBatch(n)) return false;
+
+    popOldest(n);
+    more = ringCount >= HEALTH_HISTORY_BATCH;
+    return true;
+}
+
+// ========== PUBLIC FUNCTIONS ==========
+
+// Called once the network is up; samples recorded before that stay in
+// the ring so the boot itself is part of the history
+void HealthHistory::init(const String& id) {
+    deviceId     = id;
+    nextUploadMs = 0;
+    lastUploadMs = millis();
+
+    ThreadSafe::Guard guard(100);
+    if (guard.isAcquired()) discoverSpillLocked();
+}
+
+void HealthHistory::record(const HealthSample& sample) {
+    if (ringCount == HEALTH_HISTORY_SAMPLES && !spillOldest()) {
+        popOldest(1);
+        stats.dropped++;
+    }
+    ring[(ringHead + ringCount) % HEALTH_HISTORY_SAMPLES] = sample;
+    ringCount++;
+}
+
+void HealthHistory::update() {
+    uint32_t now = millis();
+    if ((int32_t)(now - nextUploadMs) < 0) return;
+    if (deviceId.length() == 0) return;   // not initialised yet
+    if (WiFi.status() != WL_CONNECTED || !WiFiManager::isTimeValid()) return;
+
+    if (!spillKnown) {
+        ThreadSafe::Guard guard(50);
+        if (guard.isAcquired()) discoverSpillLocked();
+    }
+
+    bool due = ringCount >= HEALTH_HISTORY_BATCH || spillSize > spillReadPos ||
+               (ringCount > 0 && now - lastUploadMs >= HEALTH_HISTORY_UPLOAD_MS);
+    if (!due) return;
+
+    // Heap pressure: smaller batches at WARN, none at CRIT (the ring and
+    // spill file keep the samples)
+    uint16_t batch = HeapMonitor::scaleBatch(HEALTH_HISTORY_BATCH);
+    if (batch == 0) return;
+
+    bool more = false;
+    if (!uploadOne(batch, more)) {
+        nextUploadMs = now + HEALTH_HISTORY_UPLOAD_MS / 5;
+        return;
+    }
+    lastUploadMs = now;
+    nextUploadMs = more ? now + 1000 : now;
+}
+
+HealthHistoryStats HealthHistory::getStats() {
+    HealthHistoryStats s = stats;
+    s.buffered     = ringCount;
+    s.spilledBytes = spillSize - spillReadPos;
+    return s;
+}
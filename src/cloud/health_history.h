@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+
+// ==================== HEALTH SAMPLE ====================
+// One point of the heap / RSSI / reader / voltage trajectory. Fixed size
+// so the ring and the LittleFS spill file share the same layout.
+
+enum HealthSampleFlags : uint8_t {
+    HS_WIFI_CONNECTED = 1 << 0,
+    HS_NTP_SYNCED     = 1 << 1,
+    HS_RFID_OK        = 1 << 2
+};
+
+struct HealthSample {
+    uint32_t epoch;              // 0 = taken before NTP sync
+    uint32_t uptimeSeconds;
+    uint32_t freeHeapBytes;
+    uint16_t largestFreeBlockKb;
+    uint16_t minFreeHeapKb;
+    uint16_t voltageMv;
+    uint16_t rfidReinitCount;
+    uint16_t wifiDisconnectCount;
+    int8_t   wifiRssi;
+    uint8_t  flags;              // HealthSampleFlags
+};
+
+struct HealthHistoryStats {
+    uint16_t buffered;           // samples in the RAM ring
+    uint32_t spilledBytes;       // waiting in the spill file
+    uint32_t uploaded;
+    uint32_t dropped;            // overwritten or undatable
+    uint32_t failures;
+    int      lastHttpCode;
+};
+
+// ==================== HEALTH HISTORY ====================
+// Samples are recorded by HealthMonitor; update() spills and uploads them
+// to device_health_history in columnar batches (ingest_health_samples RPC).
+
+class HealthHistory {
+public:
+    static void init(const String& deviceId);
+    static void record(const HealthSample& sample);
+    static void update();                  // Core 0 loop, via HealthMonitor
+    static HealthHistoryStats getStats();
+};
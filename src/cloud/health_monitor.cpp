@@ -1,54 +1,40 @@
 #include "health_monitor.h"
+#include "health_history.h"
 #include "supabase_config.h"
 #include "wifi_manager.h"
+#include "command_processor.h"
 #include "../access/rfid_manager.h"
 #include "../config/config.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <time.h>
+#include <math.h>
 #include <LittleFS.h>
 #include <esp_system.h>
 #include <esp_task_wdt.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "../storage/nvs_store.h"
+#include "../storage/log_format.h"
 #include "../core/thread_safe.h"
+#include "../core/loop_profiler.h"
+#include "../core/heap_monitor.h"
+#include "../core/json_writer.h"
+#include "../core/trace.h"
+#include "../core/boot_profile.h"
 
 // ==================== STATIC STATE ====================
-static DeviceHealth health = {};
-static String       deviceId;
-static uint32_t     lastCloudSyncMs = 0;
-static uint32_t     bootTimeMs      = 0;
-
-static const uint32_t CLOUD_SYNC_INTERVAL_MS = 60000;   // push every 60 s
-
-// ==================== HELPERS ====================
-
-static String getCurrentTimestamp() {
-    time_t now = time(nullptr);
-    struct tm t;
-    localtime_r(&now, &t);
-    char buf[30];
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
-             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-             t.tm_hour, t.tm_min, t.tm_sec);
-    return String(buf);
-}
-
-static String jsonEscape(const String& s) {
-    String out;
-    out.reserve(s.length() + 16);
-    for (size_t i = 0; i < s.length(); i++) {
-        char c = s[i];
-        if (c == '"')       out += "\\\"";
-        else if (c == '\\') out += "\\\\";
-        else if (c == '\n') out += "\\n";
-        else if (c == '\r') out += "\\r";
-        else if (c == '\t') out += "\\t";
-        else                out += c;
-    }
-    return out;
-}
+static DeviceHealth    health = {};
+static DeviceHealth    acked  = {};        // as of the last accepted push
+static bool            haveAcked      = false;
+static String          deviceId;
+static uint32_t        lastCloudSyncMs = 0;
+static uint32_t        lastFullPushMs  = 0;
+static uint32_t        lastSampleMs    = 0;
+static uint32_t        lastProfileMs   = 0;
+static uint32_t        stallReportedUs[(uint8_t)ProfiledLoop::COUNT] = {};
+static uint32_t        bootTimeMs      = 0;
+static HealthPushStats pushStats       = {};
 
 // ==================== COLLECTORS ====================
 
@@ -67,17 +53,18 @@ static void collectRfidHealth() {
     health.rfidHealthy = rh.communicationOk && rh.samConfigured;
 
     // Update last-read timestamp when the reader is healthy
+    uint32_t now = time(nullptr);
     if (rh.communicationOk) {
-        health.lastSuccessfulReadTime = getCurrentTimestamp();
+        health.lastSuccessfulReadTime = now;
     }
 
     // Record error if communication down
     if (!rh.communicationOk) {
         health.lastRfidError     = "PN532 SPI communication failed";
-        health.lastRfidErrorTime = getCurrentTimestamp();
+        health.lastRfidErrorTime = now;
     } else if (!rh.samConfigured) {
         health.lastRfidError     = "PN532 SAM not configured";
-        health.lastRfidErrorTime = getCurrentTimestamp();
+        health.lastRfidErrorTime = now;
     }
 }
 
@@ -93,6 +80,7 @@ static void collectWifiHealth() {
     health.wifiConnected = WiFi.status() == WL_CONNECTED;
     health.wifiRssi      = WiFi.RSSI();
     health.ntpSynced     = WiFiManager::isTimeValid();
+    health.cmdPollIntervalMs = CommandProcessor::pollIntervalMs();
 }
 
 static void collectProcessorInfo() {
@@ -129,7 +117,7 @@ static void collectCoreStatus() {
         health.core0FreeStackBytes = free;
         // Core 1 approximation
         health.core1IsIdle = false;
-        strcpy(health.core1CurrentTask, "core1_access");
+        strcpy(health.core1CurrentTask, "access_reader");
         health.core1FreeStackBytes = 0;
     } else {
         health.core1IsIdle = false;
@@ -142,6 +130,84 @@ static void collectCoreStatus() {
     }
 }
 
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+// FreeRTOS run-time stats, diffed between collections. Counters are the
+// run-time clock (µs) and wrap every ~71 min; unsigned deltas absorb that.
+static const uint8_t MAX_SYSTEM_TASKS = 24;
+static TaskStatus_t  taskStatus[MAX_SYSTEM_TASKS];
+
+struct TaskRunTime {
+    TaskHandle_t handle;
+    uint32_t     counter;
+};
+static TaskRunTime prevRunTime[MAX_SYSTEM_TASKS];
+static uint8_t     prevRunTimeCount = 0;
+static uint32_t    prevTotalRunTime = 0;
+
+static uint32_t previousCounter(TaskHandle_t h) {
+    for (uint8_t i = 0; i < prevRunTimeCount; i++) {
+        if (prevRunTime[i].handle == h) return prevRunTime[i].counter;
+    }
+    return 0;
+}
+
+static void collectTaskInfo() {
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(taskStatus, MAX_SYSTEM_TASKS, &total);
+    health.taskCount = 0;
+    if (n == 0) return;   // more tasks than slots
+
+    uint32_t window = total - prevTotalRunTime;
+    bool     first  = prevTotalRunTime == 0;
+    uint32_t idleDelta[2] = { 0, 0 };
+    uint32_t pipelineFree = UINT32_MAX;   // tightest of the Core 1 pipeline stages
+    TaskHandle_t idle[2] = { xTaskGetIdleTaskHandleForCPU(0), xTaskGetIdleTaskHandleForCPU(1) };
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t& st = taskStatus[i];
+        uint32_t delta = st.ulRunTimeCounter - previousCounter(st.xHandle);
+
+        for (uint8_t c = 0; c < 2; c++) {
+            if (st.xHandle == idle[c]) idleDelta[c] = delta;
+        }
+
+        if (strncmp(st.pcTaskName, "access_", 7) == 0) {
+            pipelineFree = min(pipelineFree, (uint32_t)(st.usStackHighWaterMark * sizeof(StackType_t)));
+        }
+
+        if (health.taskCount >= 16) continue;
+        TaskInfo& t = health.tasks[health.taskCount++];
+        strncpy(t.name, st.pcTaskName ? st.pcTaskName : "unknown", sizeof(t.name) - 1);
+        t.name[sizeof(t.name) - 1] = '\0';
+        t.core           = st.xCoreID < 2 ? st.xCoreID : 0xFF;   // 0xFF = unpinned
+        t.stackHighWater = st.usStackHighWaterMark * sizeof(StackType_t);
+        t.stackSize      = 0;
+        t.priority       = st.uxCurrentPriority;
+        t.isRunning      = st.eCurrentState == eRunning;
+        t.cpuPercent     = (!first && window) ? (uint8_t)min((uint64_t)delta * 100 / window, (uint64_t)100) : 0;
+    }
+
+    if (pipelineFree != UINT32_MAX) health.core1FreeStackBytes = pipelineFree;
+
+    // Each core has `window` of capacity; whatever its idle task didn't use was load
+    if (!first && window) {
+        health.cpuStatsAvailable = true;
+        health.core0LoadPercent  = 100 - (uint8_t)min((uint64_t)idleDelta[0] * 100 / window, (uint64_t)100);
+        health.core1LoadPercent  = 100 - (uint8_t)min((uint64_t)idleDelta[1] * 100 / window, (uint64_t)100);
+        health.core0IsIdle       = health.core0LoadPercent < 10;
+        health.core1IsIdle       = health.core1LoadPercent < 10;
+    }
+
+    prevRunTimeCount = 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        prevRunTime[prevRunTimeCount].handle  = taskStatus[i].xHandle;
+        prevRunTime[prevRunTimeCount].counter = taskStatus[i].ulRunTimeCounter;
+        prevRunTimeCount++;
+    }
+    prevTotalRunTime = total;
+}
+#else
+// No run-time stats in this FreeRTOS build: current task only
 static void collectTaskInfo() {
     health.taskCount = 0;
     TaskHandle_t cur = xTaskGetCurrentTaskHandle();
@@ -156,35 +222,29 @@ static void collectTaskInfo() {
     t.stackSize      = 0;
     t.priority       = uxTaskPriorityGet(cur);
     t.isRunning      = true;
+    t.cpuPercent     = 0;
 }
+#endif
 
 static void collectStorageInfo() {
-    uint32_t usedSize = 0;
-    File root = LittleFS.open("/");
-    if (root && root.isDirectory()) {
-        File f = root.openNextFile();
-        while (f) {
-            if (!f.isDirectory()) usedSize += f.size();
-            f = root.openNextFile();
-        }
-        root.close();
-    }
+    // Filesystem and NVS counts under mutex to prevent races with Core 1
+    // writes. The used-block count is O(1), unlike walking the directory.
+    ThreadSafe::Guard guard(50);
+    if (!guard.isAcquired()) return;   // keep previous values (stale but safe)
+
+    uint32_t usedSize = LittleFS.usedBytes();
+    health.littlefsUsedBytes = usedSize;
+    health.littlefsFreeBytes = (health.littlefsTotalBytes > usedSize)
+                                   ? health.littlefsTotalBytes - usedSize : 0;
+
+    health.nvsUsedEntries = NVSStore::whitelistCount()
+                          + NVSStore::blacklistCount()
+                          + NVSStore::pendingCount();
+}
 
-    health.littlefsTotalBytes = 1536000;   // 1.5 MB typical partition
-    health.littlefsUsedBytes  = usedSize;
-    health.littlefsFreeBytes  = (health.littlefsTotalBytes > usedSize)
-                                    ? health.littlefsTotalBytes - usedSize : 0;
-
-    // Read NVS counts under mutex to prevent race with Core 1 NVS writes
-    {
-        ThreadSafe::Guard guard(50);
-        if (guard.isAcquired()) {
-            health.nvsUsedEntries = NVSStore::whitelistCount()
-                                  + NVSStore::blacklistCount()
-                                  + NVSStore::pendingCount();
-        }
-        // If mutex not acquired, keep previous value (stale but safe)
-    }
+static void collectStaticStorageInfo() {
+    ThreadSafe::Guard guard(50);
+    health.littlefsTotalBytes = guard.isAcquired() ? LittleFS.totalBytes() : 0;
 }
 
 static void collectWatchdogInfo() {
@@ -204,6 +264,373 @@ static void collectVoltageInfo() {
     health.voltage3v3 = (avg / 4095.0f) * 3.3f * VOLTAGE_DIVIDER_RATIO;
 }
 
+// Cheap subset for the history ring; no filesystem or NVS access
+static void collectSample() {
+    collectSystemHealth();
+    collectWifiHealth();
+    collectRfidHealth();
+    collectVoltageInfo();
+
+    HealthSample s = {};
+    s.epoch                 = health.ntpSynced ? (uint32_t)time(nullptr) : 0;
+    s.uptimeSeconds         = millis() / 1000;
+    s.freeHeapBytes         = health.freeHeapBytes;
+    s.largestFreeBlockKb    = min(health.largestFreeBlockBytes / 1024, (uint32_t)0xFFFF);
+    s.minFreeHeapKb         = min(health.minFreeHeapBytes / 1024, (uint32_t)0xFFFF);
+    s.voltageMv             = (uint16_t)(health.voltage3v3 * 1000.0f + 0.5f);
+    s.rfidReinitCount       = (uint16_t)min(health.rfidReinitCount, (uint32_t)0xFFFF);
+    s.wifiDisconnectCount   = (uint16_t)min(health.wifiDisconnectCount, (uint32_t)0xFFFF);
+    s.wifiRssi              = health.wifiConnected ? health.wifiRssi : 0;
+    s.flags                 = (health.wifiConnected ? HS_WIFI_CONNECTED : 0) |
+                              (health.ntpSynced     ? HS_NTP_SYNCED     : 0) |
+                              (health.rfidHealthy   ? HS_RFID_OK        : 0);
+    HealthHistory::record(s);
+}
+
+// ==================== PAYLOAD ====================
+// Built into one static buffer; a field goes in only when it moved past
+// its deadband relative to `pending`, which starts as the acked snapshot
+// and becomes it once the cloud accepts the push.
+static char         payload[HEALTH_PAYLOAD_BYTES];
+static JsonWriter   out(payload, sizeof(payload));
+static uint16_t     payloadFields = 0;
+static bool         fullPush      = false;
+static DeviceHealth pending;
+
+static void key(const char* name) {
+    payloadFields++;
+    out.key(name);
+}
+
+static void emitTime(uint32_t epoch) {
+    if (epoch < 1700000000) {
+        out.null();
+        return;
+    }
+    char ts[24];
+    LogFormat::formatTimestamp(ts, sizeof(ts), epoch, 0);
+    ts[10] = 'T';
+    out.raw("\"%sZ\"", ts);
+}
+
+static bool moved(uint32_t now, uint32_t was, uint32_t band) {
+    if (fullPush || band == 0) return true;
+    return (now > was ? now - was : was - now) >= band;
+}
+
+// band 0 = always, 1 = on any change
+static void u32Field(const char* name, uint32_t now, uint32_t& was, uint32_t band = 1) {
+    if (!moved(now, was, band)) return;
+    key(name);
+    out.u32(now);
+    was = now;
+}
+
+static void u8Field(const char* name, uint8_t now, uint8_t& was, uint8_t band = 1) {
+    if (!moved(now, was, band)) return;
+    key(name);
+    out.u32(now);
+    was = now;
+}
+
+static void i8Field(const char* name, int8_t now, int8_t& was, uint8_t band = 1) {
+    if (!moved((uint32_t)(now + 128), (uint32_t)(was + 128), band)) return;
+    key(name);
+    out.i32(now);
+    was = now;
+}
+
+static void boolField(const char* name, bool now, bool& was) {
+    if (!fullPush && now == was) return;
+    key(name);
+    out.boolean(now);
+    was = now;
+}
+
+static void textField(const char* name, const char* now, char* was, size_t wasSize) {
+    if (!fullPush && strncmp(now, was, wasSize) == 0) return;
+    key(name);
+    out.string(now);
+    strncpy(was, now, wasSize - 1);
+    was[wasSize - 1] = '\0';
+}
+
+static void timeField(const char* name, uint32_t now, uint32_t& was, uint32_t band = 1) {
+    if (!moved(now, was, band)) return;
+    key(name);
+    emitTime(now);
+    was = now;
+}
+
+static void voltageField(const char* name, float now, float& was) {
+    if (!fullPush && fabsf(now - was) < HEALTH_VOLTAGE_DEADBAND) return;
+    key(name);
+    out.f32(now, 2);
+    was = now;
+}
+
+static bool tasksChanged() {
+    if (fullPush || health.taskCount != pending.taskCount) return true;
+    for (uint8_t i = 0; i < health.taskCount; i++) {
+        const TaskInfo& a = health.tasks[i];
+        const TaskInfo& b = pending.tasks[i];
+        if (strcmp(a.name, b.name) != 0 || a.core != b.core ||
+            a.priority != b.priority || a.isRunning != b.isRunning ||
+            a.stackSize != b.stackSize ||
+            (a.cpuPercent > b.cpuPercent ? a.cpuPercent - b.cpuPercent
+                                         : b.cpuPercent - a.cpuPercent) >= HEALTH_CPU_DEADBAND ||
+            (a.stackHighWater > b.stackHighWater ? a.stackHighWater - b.stackHighWater
+                                                 : b.stackHighWater - a.stackHighWater)
+                >= HEALTH_STACK_DEADBAND) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tasksField() {
+    if (!tasksChanged()) return;
+    key("tasks");
+    out.beginArray();
+    for (uint8_t i = 0; i < health.taskCount; i++) {
+        const TaskInfo& t = health.tasks[i];
+        out.beginObject();
+        out.key("name").string(t.name);
+        out.key("core").i32(t.core == 0xFF ? -1 : t.core);
+        out.key("stack_high_water").u32(t.stackHighWater);
+        out.key("stack_size").u32(t.stackSize);
+        out.key("priority").u32(t.priority);
+        out.key("is_running").boolean(t.isRunning);
+        out.key("cpu_percent").u32(t.cpuPercent);
+        out.endObject();
+    }
+    out.endArray();
+    key("task_count");
+    out.u32(health.taskCount);
+    memcpy(pending.tasks, health.tasks, sizeof(health.tasks));
+    pending.taskCount = health.taskCount;
+}
+
+static void rfidErrorFields() {
+    const char* now = health.lastRfidError;
+    const char* was = pending.lastRfidError;
+    bool same = (now == was) || (now && was && strcmp(now, was) == 0);
+    if (!fullPush && same && health.lastRfidErrorTime == pending.lastRfidErrorTime) return;
+
+    key("last_rfid_error");
+    out.string(now);   // null when there is none
+    key("last_rfid_error_time");
+    emitTime(now ? health.lastRfidErrorTime : 0);
+    pending.lastRfidError     = now;
+    pending.lastRfidErrorTime = health.lastRfidErrorTime;
+}
+
+// loop_profile: {"access":{...},"cloud":{...}} for the current window
+static const char* const PROFILED_LOOP_NAMES[] = { "access", "cloud" };
+
+// heap_tags: {"cloud_http":{"live","peak","rate"},...}, sent with the profile
+static void heapTagsField(const HeapSnapshot& h) {
+    key("heap_tags");
+    out.beginObject();
+    for (uint8_t i = 0; i < (uint8_t)HeapTag::COUNT; i++) {
+        const HeapTagStats& t = h.tags[i];
+        out.key(HeapMonitor::tagName((HeapTag)i)).beginObject();
+        out.key("live").i32(t.liveBytes);
+        out.key("peak").i32(t.peakBytes);
+        out.key("allocs").u32(t.allocs);
+        out.key("rate").u32(t.bytesPerMin);
+        out.endObject();
+    }
+    out.endObject();
+}
+
+// rfid_readers: [{"door","irq","ok","polls","reinits","taps"},...] per
+// reader, sent with the profile on multi-reader devices
+static void readersField() {
+    key("rfid_readers");
+    out.beginArray();
+    for (uint8_t i = 0; i < RFIDManager::readerCount(); i++) {
+        RFIDReaderHealth r = RFIDManager::getReaderHealth(i);
+        out.beginObject();
+        out.key("door").u32(r.door);
+        out.key("irq").boolean(r.irqDriven);
+        out.key("ok").boolean(r.communicationOk);
+        out.key("polls").u32(r.pollCount);
+        out.key("reinits").u32(r.reinitCount);
+        out.key("taps").u32(r.tapCount);
+        out.endObject();
+    }
+    out.endArray();
+}
+
+static void profileField() {
+    key("loop_profile");
+    out.beginObject();
+    for (uint8_t l = 0; l < (uint8_t)ProfiledLoop::COUNT; l++) {
+        LoopProfile p = LoopProfiler::snapshot((ProfiledLoop)l, false);
+        out.key(PROFILED_LOOP_NAMES[l]).beginObject();
+        out.key("n").u32(p.iterations);
+        out.key("avg_us").u32(p.iterations ? p.totalUs / p.iterations : 0);
+        out.key("max_us").u32(p.maxUs);
+        out.key("max_stage").string(p.maxStage);
+        out.key("max_stage_us").u32(p.maxStageUs);
+        out.key("window_ms").u32(p.windowMs);
+        out.key("hist").beginArray();
+        for (uint8_t b = 0; b < LOOP_HIST_BUCKETS; b++) out.u32(p.histogram[b]);
+        out.endArray();
+        out.key("stages").beginArray();
+        for (uint8_t i = 0; i < p.stageCount; i++) {
+            out.beginObject();
+            out.key("name").string(p.stages[i].name);
+            out.key("total_us").u32(p.stages[i].totalUs);
+            out.key("max_us").u32(p.stages[i].maxUs);
+            out.endObject();
+        }
+        out.endArray();
+        out.endObject();
+    }
+    out.endObject();
+}
+
+// Serial warning once per new worst iteration past the stall threshold.
+// Returns true if either loop stalled in the current window.
+static bool checkStalls() {
+    static const uint32_t STALL_US[] = { LOOP_STALL_ACCESS_US, LOOP_STALL_CLOUD_US };
+    bool stalled = false;
+    for (uint8_t l = 0; l < (uint8_t)ProfiledLoop::COUNT; l++) {
+        LoopProfile p = LoopProfiler::snapshot((ProfiledLoop)l, false);
+        if (p.maxUs < STALL_US[l]) continue;
+        stalled = true;
+        if (p.maxUs == stallReportedUs[l]) continue;
+        stallReportedUs[l] = p.maxUs;
+        Serial.printf("[PROFILE] %s loop stall: %lu ms, %lu ms in %s\n",
+                      PROFILED_LOOP_NAMES[l], (unsigned long)(p.maxUs / 1000),
+                      (unsigned long)(p.maxStageUs / 1000),
+                      p.maxStage ? p.maxStage : "?");
+    }
+    return stalled;
+}
+
+// Returns false if the payload didn't fit
+static bool buildPayload(bool full, bool withProfile) {
+    fullPush      = full;
+    pending       = acked;
+    payloadFields = 0;
+
+    out.reset();
+    out.beginObject();
+    key("device_id");
+    out.string(deviceId.c_str());
+
+    // ---- Static: once per boot (and on refresh) ----
+    if (full) {
+        key("firmware_version");
+        out.string(FW_VERSION_STR);
+        u32Field("total_heap_bytes",             health.totalHeapBytes,     pending.totalHeapBytes);
+        u32Field("cpu_freq_mhz",                 health.cpuFreqMhz,         pending.cpuFreqMhz);
+        u32Field("storage_littlefs_total_bytes", health.littlefsTotalBytes, pending.littlefsTotalBytes);
+        key("chip_model");
+        out.u32(health.chipModel);
+        key("chip_revision");
+        out.u32(health.chipRevision);
+        key("chip_cores");
+        out.u32(health.chipCores);
+        boolField("watchdog_enabled",    health.watchdogEnabled,   pending.watchdogEnabled);
+        u32Field("watchdog_timeout_ms",  health.watchdogTimeoutMs, pending.watchdogTimeoutMs);
+
+        char boot[192];
+        if (BootProfile::toJson(boot, sizeof(boot))) {
+            key("boot_timings");   // ms since reset per boot phase
+            out.raw("%s", boot);
+        }
+    }
+
+    // ---- Slow-changing state: on change ----
+    boolField("wifi_connected",        health.wifiConnected,       pending.wifiConnected);
+    boolField("ntp_synced",            health.ntpSynced,           pending.ntpSynced);
+    boolField("rfid_healthy",          health.rfidHealthy,         pending.rfidHealthy);
+    boolField("rfid_communication_ok", health.rfidCommunicationOk, pending.rfidCommunicationOk);
+    boolField("rfid_sam_configured",   health.rfidSamConfigured,   pending.rfidSamConfigured);
+    if (full || health.rfidIC != pending.rfidIC ||
+        health.rfidFirmwareMaj != pending.rfidFirmwareMaj ||
+        health.rfidFirmwareMin != pending.rfidFirmwareMin ||
+        health.rfidFirmwareSupport != pending.rfidFirmwareSupport) {
+        key("rfid_ic");
+        out.u32(health.rfidIC);
+        key("rfid_firmware_major");
+        out.u32(health.rfidFirmwareMaj);
+        key("rfid_firmware_minor");
+        out.u32(health.rfidFirmwareMin);
+        key("rfid_firmware_support");
+        out.u32(health.rfidFirmwareSupport);
+        pending.rfidIC              = health.rfidIC;
+        pending.rfidFirmwareMaj     = health.rfidFirmwareMaj;
+        pending.rfidFirmwareMin     = health.rfidFirmwareMin;
+        pending.rfidFirmwareSupport = health.rfidFirmwareSupport;
+    }
+    boolField("core0_is_idle", health.core0IsIdle, pending.core0IsIdle);
+    textField("core0_current_task", health.core0CurrentTask,
+              pending.core0CurrentTask, sizeof(pending.core0CurrentTask));
+    boolField("core1_is_idle", health.core1IsIdle, pending.core1IsIdle);
+    textField("core1_current_task", health.core1CurrentTask,
+              pending.core1CurrentTask, sizeof(pending.core1CurrentTask));
+    rfidErrorFields();
+    if (withProfile && RFIDManager::readerCount() > 1) readersField();
+    tasksField();
+
+    // ---- CPU: load per core past a deadband, loop profile per window ----
+    if (health.cpuStatsAvailable) {
+        // Idle is derived from the loads: take the sent one before they update
+        uint8_t idleNow = 100 - (health.core0LoadPercent + health.core1LoadPercent) / 2;
+        uint8_t idleWas = 100 - (pending.core0LoadPercent + pending.core1LoadPercent) / 2;
+        u8Field("cpu_core0_load", health.core0LoadPercent, pending.core0LoadPercent, HEALTH_CPU_DEADBAND);
+        u8Field("cpu_core1_load", health.core1LoadPercent, pending.core1LoadPercent, HEALTH_CPU_DEADBAND);
+        if (moved(idleNow, idleWas, HEALTH_CPU_DEADBAND)) {
+            key("cpu_idle_percent");
+            out.u32(idleNow);
+        }
+    }
+    if (withProfile) profileField();
+
+    // ---- Heap: level on change, fragmentation past a deadband ----
+    HeapSnapshot heap = HeapMonitor::snapshot();
+    if (fullPush || (uint8_t)heap.level != pending.heapLevel) {
+        key("heap_level");
+        out.string(HeapMonitor::levelName(heap.level));
+        pending.heapLevel = (uint8_t)heap.level;
+    }
+    if (moved(heap.fragPermille, pending.heapFragPermille, HEALTH_FRAG_DEADBAND)) {
+        key("heap_frag_permille");
+        out.u32(heap.fragPermille);
+        key("heap_frag_trend");
+        out.i32(heap.fragTrendPerHour);
+        pending.heapFragPermille = heap.fragPermille;
+    }
+    if (withProfile) heapTagsField(heap);
+
+    // ---- Counters and gauges: past a deadband ----
+    u32Field("uptime_seconds",              health.uptimeSeconds,         pending.uptimeSeconds, 0);
+    u32Field("free_heap_bytes",             health.freeHeapBytes,         pending.freeHeapBytes,         HEALTH_HEAP_DEADBAND);
+    u32Field("min_free_heap_bytes",         health.minFreeHeapBytes,      pending.minFreeHeapBytes,      HEALTH_HEAP_DEADBAND);
+    u32Field("largest_free_block_bytes",    health.largestFreeBlockBytes, pending.largestFreeBlockBytes, HEALTH_HEAP_DEADBAND);
+    i8Field ("wifi_rssi",                   health.wifiRssi,              pending.wifiRssi,              HEALTH_RSSI_DEADBAND);
+    u32Field("wifi_disconnect_count",       health.wifiDisconnectCount,   pending.wifiDisconnectCount);
+    u32Field("cmd_poll_interval_ms",        health.cmdPollIntervalMs,     pending.cmdPollIntervalMs);
+    u32Field("core0_free_stack_bytes",      health.core0FreeStackBytes,   pending.core0FreeStackBytes,   HEALTH_STACK_DEADBAND);
+    u32Field("core1_free_stack_bytes",      health.core1FreeStackBytes,   pending.core1FreeStackBytes,   HEALTH_STACK_DEADBAND);
+    u32Field("storage_littlefs_used_bytes", health.littlefsUsedBytes,     pending.littlefsUsedBytes,     HEALTH_STORAGE_DEADBAND);
+    u32Field("storage_littlefs_free_bytes", health.littlefsFreeBytes,     pending.littlefsFreeBytes,     HEALTH_STORAGE_DEADBAND);
+    u32Field("storage_nvs_used_entries",    health.nvsUsedEntries,        pending.nvsUsedEntries);
+    u32Field("rfid_reinit_count",           health.rfidReinitCount,       pending.rfidReinitCount);
+    u32Field("rfid_poll_count",             health.rfidPollCount,         pending.rfidPollCount);
+    voltageField("voltage_3v3",             health.voltage3v3,            pending.voltage3v3);
+    timeField("last_successful_read_time",  health.lastSuccessfulReadTime,
+              pending.lastSuccessfulReadTime, HEALTH_READ_TIME_DEADBAND);
+
+    out.endObject();
+    return out.ok();
+}
+
 // ==================== PUBLIC API ====================
 
 void HealthMonitor::init() {
@@ -212,7 +639,12 @@ void HealthMonitor::init() {
 
     bootTimeMs      = millis();
     lastCloudSyncMs = 0;
+    lastFullPushMs  = 0;
+    lastSampleMs    = 0;
     health          = {};
+    acked           = {};
+    haveAcked       = false;
+    pushStats       = {};
 
     health.rfidHealthy  = true;
     health.wifiConnected = false;
@@ -221,8 +653,13 @@ void HealthMonitor::init() {
     // Configure ADC for voltage monitoring
     analogSetPinAttenuation(VOLTAGE_MONITOR_PIN, ADC_11db);
 
+    // Static tier: read once, re-sent only with full pushes
     collectProcessorInfo();
     collectWatchdogInfo();
+    collectStaticStorageInfo();
+    health.totalHeapBytes = ESP.getHeapSize();
+
+    HealthHistory::init(deviceId);
 
     Serial.println("[HEALTH] Monitor initialized for device: " + deviceId);
 }
@@ -239,10 +676,24 @@ void HealthMonitor::collectAll() {
 
 void HealthMonitor::update() {
     uint32_t now = millis();
-    if (now - lastCloudSyncMs >= CLOUD_SYNC_INTERVAL_MS) {
+    if (now - lastSampleMs >= HEALTH_SAMPLE_INTERVAL_MS) {
+        lastSampleMs = now;
+        collectSample();
+    }
+    HealthHistory::update();
+
+    // Heap pressure: pushes slow down at WARN and pause at CRIT
+    HeapLevel heap = HeapMonitor::level();
+    uint32_t interval = heap == HeapLevel::NORMAL ? HEALTH_PUSH_INTERVAL_MS
+                                                  : HEALTH_PUSH_INTERVAL_MS * 4;
+    if (now - lastCloudSyncMs >= interval) {
         lastCloudSyncMs = now;
+        if (heap == HeapLevel::CRIT) {
+            pushStats.shed++;
+            return;
+        }
         collectAll();          // only collect right before pushing
-        pushHealthToSupabase();
+        pushHealthToSupabase(!haveAcked || now - lastFullPushMs >= HEALTH_FULL_REFRESH_MS);
     }
 }
 
@@ -256,123 +707,70 @@ DeviceHealth HealthMonitor::getHealth() {
 }
 
 void HealthMonitor::syncToCloud() {
-    pushHealthToSupabase();
+    pushHealthToSupabase(true);
+}
+
+HealthPushStats HealthMonitor::getPushStats() {
+    return pushStats;
 }
 
 // ==================== SUPABASE PUSH ====================
 
-void HealthMonitor::pushHealthToSupabase() {
+void HealthMonitor::pushHealthToSupabase(bool full) {
+    bool stalled = checkStalls();
+
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("[HEALTH] Cannot sync - WiFi not connected");
         return;
     }
 
-    String json = "{";
-    json += "\"device_id\":\"" + deviceId + "\",";
-    json += "\"firmware_version\":\"" FW_VERSION_STR "\",";
-
-    // ---- System ----
-    json += "\"uptime_seconds\":"          + String(health.uptimeSeconds)         + ",";
-    json += "\"free_heap_bytes\":"         + String(health.freeHeapBytes)         + ",";
-    json += "\"total_heap_bytes\":"        + String(health.totalHeapBytes)        + ",";
-    json += "\"min_free_heap_bytes\":"     + String(health.minFreeHeapBytes)      + ",";
-    json += "\"largest_free_block_bytes\":" + String(health.largestFreeBlockBytes) + ",";
-
-    // ---- WiFi ----
-    json += "\"wifi_connected\":"       + String(health.wifiConnected ? "true" : "false") + ",";
-    json += "\"wifi_rssi\":"            + String(health.wifiRssi)                         + ",";
-    json += "\"ntp_synced\":"           + String(health.ntpSynced ? "true" : "false")     + ",";
-    json += "\"wifi_disconnect_count\":" + String(health.wifiDisconnectCount)              + ",";
-
-    // ---- Processor ----
-    json += "\"cpu_freq_mhz\":"  + String(health.cpuFreqMhz)    + ",";
-    json += "\"chip_model\":"    + String(health.chipModel)      + ",";
-    json += "\"chip_revision\":" + String(health.chipRevision)   + ",";
-    json += "\"chip_cores\":"    + String(health.chipCores)      + ",";
-
-    // ---- Core 0 ----
-    json += "\"core0_is_idle\":"          + String(health.core0IsIdle ? "true" : "false")                    + ",";
-    json += "\"core0_current_task\":\""   + jsonEscape(String(health.core0CurrentTask))                      + "\",";
-    json += "\"core0_free_stack_bytes\":" + String(health.core0FreeStackBytes)                                + ",";
-
-    // ---- Core 1 ----
-    json += "\"core1_is_idle\":"          + String(health.core1IsIdle ? "true" : "false")                    + ",";
-    json += "\"core1_current_task\":\""   + jsonEscape(String(health.core1CurrentTask))                      + "\",";
-    json += "\"core1_free_stack_bytes\":" + String(health.core1FreeStackBytes)                                + ",";
-
-    // ---- Storage ----
-    json += "\"storage_littlefs_total_bytes\":" + String(health.littlefsTotalBytes) + ",";
-    json += "\"storage_littlefs_used_bytes\":"  + String(health.littlefsUsedBytes)  + ",";
-    json += "\"storage_littlefs_free_bytes\":"  + String(health.littlefsFreeBytes)  + ",";
-    json += "\"storage_nvs_used_entries\":"      + String(health.nvsUsedEntries)     + ",";
-
-    // ---- Watchdog ----
-    json += "\"watchdog_enabled\":"    + String(health.watchdogEnabled ? "true" : "false") + ",";
-    json += "\"watchdog_timeout_ms\":" + String(health.watchdogTimeoutMs)                  + ",";
-
-    // ---- Tasks ----
-    json += "\"tasks\":[";
-    for (uint8_t i = 0; i < health.taskCount; i++) {
-        if (i > 0) json += ",";
-        json += "{";
-        json += "\"name\":\""            + jsonEscape(String(health.tasks[i].name)) + "\",";
-        json += "\"core\":"              + String(health.tasks[i].core)              + ",";
-        json += "\"stack_high_water\":"  + String(health.tasks[i].stackHighWater)    + ",";
-        json += "\"stack_size\":"        + String(health.tasks[i].stackSize)         + ",";
-        json += "\"priority\":"          + String(health.tasks[i].priority)          + ",";
-        json += "\"is_running\":"        + String(health.tasks[i].isRunning ? "true" : "false");
-        json += "}";
-    }
-    json += "],";
-    json += "\"task_count\":" + String(health.taskCount) + ",";
-
-    // ---- RFID / PN532 ----
-    json += "\"rfid_healthy\":"          + String(health.rfidHealthy ? "true" : "false")        + ",";
-    json += "\"rfid_communication_ok\":" + String(health.rfidCommunicationOk ? "true" : "false") + ",";
-    json += "\"rfid_sam_configured\":"   + String(health.rfidSamConfigured ? "true" : "false")   + ",";
-    json += "\"rfid_ic\":"               + String(health.rfidIC)                                 + ",";
-    json += "\"rfid_firmware_major\":"   + String(health.rfidFirmwareMaj)                        + ",";
-    json += "\"rfid_firmware_minor\":"   + String(health.rfidFirmwareMin)                        + ",";
-    json += "\"rfid_firmware_support\":" + String(health.rfidFirmwareSupport)                    + ",";
-    json += "\"rfid_reinit_count\":"     + String(health.rfidReinitCount)                        + ",";
-    json += "\"rfid_poll_count\":"       + String(health.rfidPollCount)                          + ",";
-
-    // ---- Voltage ----
-    json += "\"voltage_3v3\":"           + String(health.voltage3v3, 2)                            + ",";
-
-    // ---- RFID timestamps (nullable) ----
-    if (health.lastRfidError.length() > 0) {
-        json += "\"last_rfid_error\":\""      + jsonEscape(health.lastRfidError) + "\",";
-        json += "\"last_rfid_error_time\":\"" + health.lastRfidErrorTime         + "\",";
-    } else {
-        json += "\"last_rfid_error\":null,";
-        json += "\"last_rfid_error_time\":null,";
-    }
+    // Profile window goes up once per interval, or early when a loop stalled
+    uint32_t now = millis();
+    bool withProfile = full || stalled || now - lastProfileMs >= LOOP_PROFILE_INTERVAL_MS;
 
-    if (health.lastSuccessfulReadTime.length() > 0) {
-        json += "\"last_successful_read_time\":\"" + health.lastSuccessfulReadTime + "\"";
-    } else {
-        json += "\"last_successful_read_time\":null";
+    if (!buildPayload(full, withProfile)) {
+        Serial.printf("[HEALTH] Payload exceeds %d bytes, not sent\n", HEALTH_PAYLOAD_BYTES);
+        pushStats.failures++;
+        return;
     }
 
-    json += "}";
-
-    // ---- HTTP POST (upsert) ----
+    // ---- HTTP POST (partial upsert: absent columns keep their value) ----
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
     HTTPClient http;
-    String url = String(SUPABASE_URL) + "/rest/v1/device_health";
-
-    http.begin(url);
+    http.begin(SUPABASE_URL "/rest/v1/device_health");
     http.addHeader("apikey",        SUPABASE_KEY);
-    http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
     http.addHeader("Content-Type",  "application/json");
     http.addHeader("Prefer",        "resolution=merge-duplicates");
 
-    int code = http.POST(json);
+    uint32_t t0 = micros();
+    int code = http.POST((uint8_t*)payload, out.length());
+    Trace::record(TraceEvent::HTTP_HEALTH, t0, code);
+    heap.checkpoint();
     http.end();
 
+    pushStats.lastFields = payloadFields;
+    pushStats.lastBytes  = out.length();
+
     if (code == 200 || code == 201) {
-        Serial.println("[HEALTH] Cloud sync OK");
+        acked     = pending;
+        haveAcked = true;
+        pushStats.pushes++;
+        if (full) {
+            pushStats.fullPushes++;
+            lastFullPushMs = now;
+        }
+        if (withProfile) {
+            for (uint8_t l = 0; l < (uint8_t)ProfiledLoop::COUNT; l++) {
+                LoopProfiler::snapshot((ProfiledLoop)l, true);
+                stallReportedUs[l] = 0;
+            }
+            lastProfileMs = now;
+        }
+        Serial.printf("[HEALTH] Cloud sync OK (%s, %u fields, %u bytes)\n",
+                      full ? "full" : "delta", payloadFields, (unsigned)out.length());
     } else {
+        pushStats.failures++;
         Serial.printf("[HEALTH] Cloud sync FAILED HTTP %d\n", code);
     }
 }
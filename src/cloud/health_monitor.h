@@ -15,10 +15,12 @@ struct TaskInfo {
     uint32_t stackSize;        // bytes (0 if unavailable)
     uint8_t priority;
     bool isRunning;
+    uint8_t cpuPercent;        // share of one core since the last collection
 };
 
 // ==================== DEVICE HEALTH STRUCT ====================
 // Every field here maps 1-to-1 to a JSON key sent to Supabase.
+// Plain data only, so collecting a snapshot never touches the heap.
 
 struct DeviceHealth {
     // ---------- RFID / PN532 ----------
@@ -31,9 +33,9 @@ struct DeviceHealth {
     uint8_t  rfidFirmwareSupport;    // feature bitmask
     uint32_t rfidPollCount;          // total poll() calls
     uint32_t rfidReinitCount;        // full hardware reinits
-    String   lastRfidError;          // last error description
-    String   lastRfidErrorTime;      // ISO timestamp
-    String   lastSuccessfulReadTime; // ISO timestamp
+    const char* lastRfidError;       // static description, nullptr = none
+    uint32_t lastRfidErrorTime;      // epoch, 0 = never
+    uint32_t lastSuccessfulReadTime; // epoch, 0 = never
 
     // ---------- System ----------
     uint32_t uptimeSeconds;
@@ -47,6 +49,7 @@ struct DeviceHealth {
     int8_t   wifiRssi;
     bool     ntpSynced;
     uint32_t wifiDisconnectCount;
+    uint32_t cmdPollIntervalMs;     // CommandProcessor's adaptive base interval
 
     // ---------- Processor ----------
     uint32_t cpuFreqMhz;
@@ -54,6 +57,15 @@ struct DeviceHealth {
     uint8_t  chipRevision;
     uint8_t  chipCores;
 
+    // ---------- CPU (FreeRTOS run-time stats) ----------
+    bool     cpuStatsAvailable;
+    uint8_t  core0LoadPercent;      // time not spent in IDLE0
+    uint8_t  core1LoadPercent;
+
+    // ---------- Heap level (as last pushed; live values in HeapMonitor) ----------
+    uint8_t  heapLevel;             // HeapLevel
+    uint16_t heapFragPermille;
+
     // ---------- Dual-core status ----------
     bool     core0IsIdle;
     char     core0CurrentTask[32];
@@ -85,6 +97,23 @@ struct DeviceHealth {
 // Only init() and update() are called from main.cpp.
 // Everything else is auto-collected from RFIDManager::getHealth()
 // and ESP system APIs each cycle.
+//
+// Pushes are partial upserts in three tiers:
+//   static   - chip, firmware, partition sizes: once per boot
+//   slow     - link/reader state, task names, errors: when they change
+//   gauges   - heap, RSSI, stacks, voltage, counters: when they move
+//              past a deadband (uptime always, as the heartbeat)
+// Changes are taken against the last push the cloud accepted, so a
+// failed push is simply folded into the next one.
+
+struct HealthPushStats {
+    uint32_t pushes;          // accepted
+    uint32_t failures;
+    uint32_t fullPushes;
+    uint32_t shed;            // skipped while the heap was critical
+    uint16_t lastFields;      // fields in the last payload
+    uint16_t lastBytes;       // size of the last payload
+};
 
 class HealthMonitor {
 public:
@@ -97,10 +126,12 @@ public:
     // Snapshot for debug / serial print
     static DeviceHealth getHealth();
 
-    // Force an immediate push to Supabase
+    // Force an immediate full push to Supabase
     static void syncToCloud();
 
+    static HealthPushStats getPushStats();
+
 private:
     static void collectAll();          // gather every metric
-    static void pushHealthToSupabase();
+    static void pushHealthToSupabase(bool full);
 };
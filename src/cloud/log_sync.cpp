@@ -1,220 +1,406 @@
 #include "log_sync.h"
-#include <LittleFS.h>
-#include <FS.h>
-#include <time.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include "wifi_manager.h"
+#include "../config/config.h"
 #include "../storage/log_store.h"
+#include "../storage/log_format.h"
+#include "../core/heap_monitor.h"
+#include "../core/cloud_arena.h"
+#include "../core/json_writer.h"
+#include "../core/trace.h"
 #include "supabase_config.h"
 
 // ========== STATE ==========
-static bool syncing = false;
-static File dir;
-static File currentFile;
+// Trickle sync: small batches read from LogStore's synced cursor, whenever
+// enough has piled up or the oldest record has waited long enough. The
+// cursor only moves after the cloud accepted a batch, so a crash or an
+// outage re-sends at most one batch.
+static String       deviceId;
+static bool         syncing        = false;
+static uint32_t     nextAttemptMs  = 0;
+static uint32_t     backlogSinceMs = 0;   // 0 = nothing waiting
+static LogSyncStats stats          = {};
+
+// Legacy daily file being uploaded; position kept in RAM only
+static String   legacyFile;
+static uint32_t legacySkip = 0;
+static bool     legacyDone = false;
+
+// ========== PAYLOAD ==========
+// A batch goes up column by column to the ingest_access_logs RPC:
+//   {"batch":{"d":"<device>","b":<first epoch>,"u":[uid dictionary],
+//             "t":[seconds since previous row],"k":[uid index],"e":[event code],
+//             "dr":[door]}}
+// Per row that is a few digits instead of a ~130-byte JSON object; the
+// database expands it back into access_logs rows. "dr" is only sent when
+// a row is for a door other than 0.
+struct UploadBatch {
+    uint16_t rows;
+    uint16_t uidCount;
+    uint32_t baseTs;
+    uint32_t ts[LOG_SYNC_BATCH_MAX];
+    uint8_t  uidRef[LOG_SYNC_BATCH_MAX];
+    uint8_t  event[LOG_SYNC_BATCH_MAX];
+    uint8_t  door[LOG_SYNC_BATCH_MAX];
+    bool     multiDoor;
+    char     uids[LOG_SYNC_BATCH_MAX][16];
+};
+
+static UploadBatch batch;
+static bool        rpcAvailable = true;   // false once the RPC is missing (404)
+
+// Codes index this table; the same order lives in ingest_access_logs()
+static const char* const CLOUD_EVENTS[] = { "GRANTED", "DENIED", "PENDING", "REMOTE" };
+
+static int8_t cloudEventCode(LogEvent e) {
+    switch (e) {
+        case LogEvent::ACCESS_GRANTED: return 0;
+        case LogEvent::ACCESS_DENIED:  return 1;
+        case LogEvent::UNKNOWN_CARD:   return 2;
+        case LogEvent::REMOTE_UNLOCK:  return 3;
+        default:                       return -1;
+    }
+}
 
-// Scheduled sync state
-static int lastSyncDay = -1;        // Track which day we last synced
-static bool scheduledSyncDone = false;  // Prevent multiple syncs on same day
+static void resetBatch() {
+    batch.rows      = 0;
+    batch.uidCount  = 0;
+    batch.baseTs    = 0;
+    batch.multiDoor = false;
+}
 
-// Device ID for cloud sync
-static String deviceId;
+// One access_logs row; false for records the cloud doesn't keep
+static bool addRow(const LogEntry& entry) {
+    int8_t code = cloudEventCode(entry.event);
+    if (code < 0 || batch.rows >= LOG_SYNC_BATCH_MAX) return false;
 
-// ========== PRIVATE FUNCTIONS ==========
+    // Skip entries with invalid 1970 timestamps (before NTP sync)
+    if (entry.timestamp < 1700000000) return false;
 
-static bool performCloudSync() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("[AUTO_SYNC] WiFi not connected, skipping sync");
-        return false;
+    uint16_t ref = 0;
+    while (ref < batch.uidCount && strcmp(batch.uids[ref], entry.uid) != 0) ref++;
+    if (ref == batch.uidCount) {
+        strncpy(batch.uids[ref], entry.uid, sizeof(batch.uids[ref]) - 1);
+        batch.uids[ref][sizeof(batch.uids[ref]) - 1] = '\0';
+        batch.uidCount++;
     }
 
-    Serial.println("[AUTO_SYNC] Starting automatic cloud sync...");
-
-    // Build JSON array of all logs
-    String body = "[";
-    uint16_t count = 0;
-    bool first = true;
-
-    LogStore::forEach([&body, &count, &first](const LogEntry& entry) {
-        const char* eventType = nullptr;
-        
-        switch (entry.event) {
-            case LogEvent::ACCESS_GRANTED:
-                eventType = "GRANTED";
-                break;
-            case LogEvent::ACCESS_DENIED:
-                eventType = "DENIED";
-                break;
-            case LogEvent::UNKNOWN_CARD:
-                eventType = "PENDING";
-                break;
-            case LogEvent::REMOTE_UNLOCK:
-                eventType = "REMOTE";
-                break;
-            default:
-                return;
-        }
-
-        if (!first) body += ",";
-        first = false;
-
-        // Convert timestamp to ISO 8601 format
-        String isoTimestamp = String(entry.timestampStr);
-        isoTimestamp.replace(" ", "T");
+    if (batch.rows == 0) batch.baseTs = entry.timestamp;
+    batch.ts[batch.rows]     = entry.timestamp;
+    batch.uidRef[batch.rows] = (uint8_t)ref;
+    batch.event[batch.rows]  = (uint8_t)code;
+    batch.door[batch.rows]   = entry.door;
+    if (entry.door) batch.multiDoor = true;
+    batch.rows++;
+    return true;
+}
 
-        body += "{\"device_id\":\"" + deviceId +
-                "\",\"uid\":\"" + String(entry.uid) +
-                "\",\"event_type\":\"" + String(eventType) +
-                "\",\"logged_at\":\"" + isoTimestamp + "\"}";
-        count++;
-    });
+// Upper bounds for the arena buffers below
+static size_t columnarBytes() {
+    return 96 + deviceId.length() + batch.uidCount * 20 + batch.rows * 24;
+}
 
-    body += "]";
+static size_t rowBytes() {
+    return 8 + batch.rows * (150 + deviceId.length());
+}
 
-    if (count == 0) {
-        Serial.println("[AUTO_SYNC] No logs to sync");
-        return true;  // Success (nothing to do)
+static void buildColumnar(JsonWriter& w) {
+    w.beginObject().key("batch").beginObject();
+    w.key("d").string(deviceId.c_str());
+    w.key("b").u32(batch.baseTs);
+    w.key("u").beginArray();
+    for (uint16_t i = 0; i < batch.uidCount; i++) w.string(batch.uids[i]);
+    w.endArray();
+
+    // Deltas stay small and may go negative after an NTP step back
+    w.key("t").beginArray();
+    uint32_t prev = batch.baseTs;
+    for (uint16_t i = 0; i < batch.rows; i++) {
+        w.i32((int32_t)(batch.ts[i] - prev));
+        prev = batch.ts[i];
     }
+    w.endArray();
+    w.key("k").beginArray();
+    for (uint16_t i = 0; i < batch.rows; i++) w.u32(batch.uidRef[i]);
+    w.endArray();
+    w.key("e").beginArray();
+    for (uint16_t i = 0; i < batch.rows; i++) w.u32(batch.event[i]);
+    w.endArray();
+    if (batch.multiDoor) {
+        w.key("dr").beginArray();
+        for (uint16_t i = 0; i < batch.rows; i++) w.u32(batch.door[i]);
+        w.endArray();
+    }
+    w.endObject().endObject();
+}
 
-    Serial.printf("[AUTO_SYNC] Sending %d logs...\n", count);
+// Plain row objects for a database without ingest_access_logs() yet
+static void buildRows(JsonWriter& w) {
+    char ts[24];
+    w.beginArray();
+    for (uint16_t i = 0; i < batch.rows; i++) {
+        LogFormat::formatTimestamp(ts, sizeof(ts), batch.ts[i], 0);
+        ts[10] = 'T';   // ISO 8601, UTC like the RPC path
+        w.beginObject();
+        w.key("device_id").string(deviceId.c_str());
+        w.key("uid").string(batch.uids[batch.uidRef[i]]);
+        w.key("event_type").string(CLOUD_EVENTS[batch.event[i]]);
+        w.key("logged_at").raw("\"%sZ\"", ts);
+        if (batch.multiDoor) w.key("door_id").u32(batch.door[i]);
+        w.endObject();
+    }
+    w.endArray();
+}
 
+static int postJson(const char* path, const JsonWriter& body) {
+    if (!body.ok()) {
+        Serial.printf("[AUTO_SYNC] Batch body overflowed %u bytes, not sent\n", (unsigned)body.length());
+        return -1;
+    }
     HTTPClient http;
-    String url = String(SUPABASE_URL) + "/rest/v1/access_logs";
+    char url[CLOUD_URL_BYTES];
+    snprintf(url, sizeof(url), SUPABASE_URL "%s", path);
 
     http.begin(url);
     http.addHeader("apikey", SUPABASE_KEY);
-    http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
     http.addHeader("Content-Type", "application/json");
     http.addHeader("Prefer", "return=minimal");
 
-    int code = http.POST(body);
+    uint32_t t0 = micros();
+    int code = http.POST((uint8_t*)body.c_str(), body.length());
+    Trace::record(TraceEvent::HTTP_LOG_SYNC, t0, code);
+    HeapMonitor::checkpoint();   // TLS session still open
     http.end();
+    return code;
+}
 
-    if (code == 201 || code == 200) {
-        Serial.printf("[AUTO_SYNC] Upload OK - %d logs\n", count);
-        
-        // Clear local logs after successful sync
-        LogStore::clearAllLogs();
-        Serial.println("[AUTO_SYNC] Local logs cleared");
-        return true;
-    } else {
-        Serial.printf("[AUTO_SYNC] Upload FAILED HTTP %d\n", code);
+static bool postBatch() {
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
+    int code = 0;
+
+    if (rpcAvailable) {
+        ArenaBuffer body(columnarBytes());
+        JsonWriter w(body.data(), body.size());
+        buildColumnar(w);
+        code = postJson("/rest/v1/rpc/ingest_access_logs", w);
+        if (code == 404) {
+            Serial.println("[AUTO_SYNC] ingest_access_logs() missing, using row upload");
+            rpcAvailable = false;
+        } else {
+            Serial.printf("[AUTO_SYNC] Columnar batch %u bytes\n", (unsigned)w.length());
+        }
+    }
+    if (!rpcAvailable) {
+        ArenaBuffer body(rowBytes());
+        JsonWriter w(body.data(), body.size());
+        buildRows(w);
+        code = postJson("/rest/v1/access_logs", w);
+    }
+    stats.lastHttpCode = code;
+
+    if (code != 201 && code != 200 && code != 204) {
+        Serial.printf("[AUTO_SYNC] Upload FAILED HTTP %d (%d rows)\n", code, batch.rows);
         return false;
     }
-}
 
-static void checkScheduledSync() {
-    // Get current time
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
+    stats.batches++;
+    stats.records += batch.rows;
+    stats.lastSuccessMs = millis();
+    Serial.printf("[AUTO_SYNC] Uploaded %d rows\n", batch.rows);
+    return true;
+}
 
-    // Check if time is valid (year > 2020 means NTP synced)
-    if (timeinfo.tm_year < 120) {  // 120 = year 2020
-        return;  // Time not synced yet
+// ========== BATCHES ==========
+// Each returns rows uploaded (-1 on failure) and sets `more` when another
+// batch is already waiting
+static int uploadSegmentBatch(uint16_t maxRecords, bool& more) {
+    LogCursor from;
+    if (!LogStore::syncedCursor(from)) {
+        more = true;   // store busy: retry after the batch gap
+        return 0;
     }
 
-    int currentDay = timeinfo.tm_yday;  // Day of year (0-365)
-    int currentHour = timeinfo.tm_hour;
-    int currentMin = timeinfo.tm_min;
+    resetBatch();
+    LogQuery all = {};
+    LogQueryResult r = LogStore::query(all, from, maxRecords, [](const LogEntry& e) {
+        addRow(e);
+    });
+    more = r.more;
+    uint16_t rows = batch.rows;
 
-    // Reset sync flag when day changes
-    if (currentDay != lastSyncDay) {
-        scheduledSyncDone = false;
-        lastSyncDay = currentDay;
-        Serial.printf("[AUTO_SYNC] New day detected: %04d-%02d-%02d\n",
-                      timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday);
+    if (rows > 0 && !postBatch()) return -1;
+
+    if (r.next.seq != from.seq || r.next.offset != from.offset) {
+        LogStore::setSyncedCursor(r.next);
     }
+    return rows;
+}
 
-    // Check if it's midnight (00:00 - 00:05 window) and sync not done today
-    if (!scheduledSyncDone && currentHour == 0 && currentMin < 5) {
-        Serial.println("[AUTO_SYNC] Midnight sync triggered!");
-        
-        if (performCloudSync()) {
-            scheduledSyncDone = true;
-            Serial.println("[AUTO_SYNC] Scheduled sync completed successfully");
-        } else {
-            Serial.println("[AUTO_SYNC] Scheduled sync failed, will retry");
-            // Don't set scheduledSyncDone so it will retry in next update cycle
+// Daily files from firmware before segments: uploaded once, then removed
+static int uploadLegacyBatch(uint16_t maxRecords, bool& more) {
+    if (legacyFile.length() == 0) {
+        legacyFile = LogStore::oldestLegacyLog();
+        legacySkip = 0;
+        if (legacyFile.length() == 0) {
+            legacyDone = true;
+            more = false;
+            return 0;
         }
+        Serial.printf("[AUTO_SYNC] Uploading legacy %s\n", legacyFile.c_str());
+    }
+
+    resetBatch();
+    int read = LogStore::readLegacy(legacyFile, legacySkip, maxRecords, [](const LogEntry& e) {
+        addRow(e);
+    });
+    if (read < 0) return -1;
+    uint16_t rows = batch.rows;
+
+    if (rows > 0 && !postBatch()) return -1;
+
+    legacySkip += read;
+    if (read < maxRecords) {
+        LogStore::removeLegacyLog(legacyFile);
+        legacyFile = "";
     }
+    more = true;   // next legacy file, or the segments
+    return rows;
+}
+
+static int uploadBatch(uint16_t maxRecords, bool& more) {
+    if (!legacyDone) {
+        int rows = uploadLegacyBatch(maxRecords, more);
+        if (rows != 0 || !legacyDone) return rows;
+    }
+    return uploadSegmentBatch(maxRecords, more);
+}
+
+// ========== SCHEDULER ==========
+// Smaller batches on a weak link so one POST doesn't sit in retries
+static uint16_t batchSizeForLink() {
+    int32_t rssi = WiFi.RSSI();
+    if (rssi >= LOG_SYNC_RSSI_GOOD) return LOG_SYNC_BATCH_MAX;
+    if (rssi >= LOG_SYNC_RSSI_WEAK) return LOG_SYNC_BATCH_MAX / 2;
+    return LOG_SYNC_BATCH_MAX / 4;
+}
+
+static void onFailure(uint32_t now) {
+    stats.failures++;
+    stats.backoffMs = stats.backoffMs
+        ? min(stats.backoffMs * 2, (uint32_t)LOG_SYNC_BACKOFF_MAX_MS)
+        : (uint32_t)LOG_SYNC_BACKOFF_MIN_MS;
+
+    // Jitter so a fleet coming back from an outage doesn't retry in lockstep
+    nextAttemptMs = now + stats.backoffMs + random(stats.backoffMs / 4 + 1);
+    Serial.printf("[AUTO_SYNC] Backing off %lu ms\n", (unsigned long)stats.backoffMs);
 }
 
 // ========== PUBLIC FUNCTIONS ==========
 
 void LogSync::init() {
-    syncing = false;
-    scheduledSyncDone = false;
-    lastSyncDay = -1;
-    
+    syncing        = false;
+    nextAttemptMs  = 0;
+    backlogSinceMs = 0;
+    legacyDone     = false;
+    legacyFile     = "";
+
     // Get device ID from MAC address
     deviceId = WiFi.macAddress();
     deviceId.replace(":", "");
-    
-    Serial.println("[AUTO_SYNC] Log sync initialized with auto-sync at midnight");
+
+    Serial.println("[AUTO_SYNC] Trickle log sync initialized");
 }
 
-void LogSync::triggerSync() {
-    if (syncing) return;
+void LogSync::update() {
+    uint32_t now = millis();
+    if ((int32_t)(now - nextAttemptMs) < 0) return;
+    nextAttemptMs = now + LOG_SYNC_CHECK_MS;
 
-    Serial.println("[SYNC] Manual log sync started");
+    if (WiFi.status() != WL_CONNECTED || !WiFiManager::isTimeValid()) return;
 
-    dir = LittleFS.open("/");
-    if (!dir || !dir.isDirectory()) {
-        Serial.println("[SYNC] Failed to open FS root");
+    LogStats ls = LogStore::getStats();
+    if (ls.unsyncedBytes == 0 && legacyDone) {
+        backlogSinceMs = 0;
+        return;
+    }
+    if (!backlogSinceMs) backlogSinceMs = now;
+    uint32_t age = now - backlogSinceMs;
+
+    // Enough for a worthwhile batch, or someone has waited long enough
+    bool due = ls.unsyncedBytes >= LOG_SYNC_TRIGGER_BYTES ||
+               age >= LOG_SYNC_MAX_DELAY_MS || !legacyDone;
+    if (!due) return;
+
+    // Stay off the radio while people are at the door, and off the heap
+    // entirely while it is critical: the logs are safe on flash
+    uint16_t batch = HeapMonitor::scaleBatch(batchSizeForLink());
+    bool busy = now - ls.lastAccessMs < LOG_SYNC_QUIET_MS;
+    if (batch == 0 || (busy && age < LOG_SYNC_MAX_DEFER_MS)) {
+        stats.deferrals++;
         return;
     }
 
     syncing = true;
-}
+    bool more = false;
+    int rows = uploadBatch(batch, more);
+    syncing = false;
 
-void LogSync::update() {
-    // Check for scheduled midnight sync
-    static uint32_t lastScheduleCheck = 0;
-    if (millis() - lastScheduleCheck >= 60000) {  // Check every 60 seconds
-        lastScheduleCheck = millis();
-        checkScheduledSync();
+    if (rows < 0) {
+        onFailure(now);
+        return;
     }
+    stats.backoffMs = 0;
+    if (more) nextAttemptMs = now + LOG_SYNC_BATCH_GAP_MS;
+    else backlogSinceMs = 0;
+}
 
-    // Handle manual sync (for serial debugging)
-    if (!syncing) return;
-
-    // If no file currently open, get next file
-    if (!currentFile) {
-        currentFile = dir.openNextFile();
+bool LogSync::syncNow(uint32_t& uploaded, int& httpCode) {
+    uploaded = 0;
+    httpCode = 0;
+    if (WiFi.status() != WL_CONNECTED) return false;
 
-        if (!currentFile) {
-            Serial.println("[SYNC] Log sync completed");
-            syncing = false;
-            dir.close();
-            return;
+    syncing = true;
+    bool ok = true;
+    for (uint16_t i = 0; i < LOG_SYNC_MANUAL_BATCHES; i++) {
+        bool more = false;
+        // Explicit request: still runs under heap pressure, in small batches
+        uint16_t batch = HeapMonitor::level() == HeapLevel::NORMAL
+                             ? LOG_SYNC_BATCH_MAX : LOG_SYNC_BATCH_MAX / 4;
+        int rows = uploadBatch(batch, more);
+        if (rows < 0) {
+            ok = false;
+            httpCode = stats.lastHttpCode;
+            break;
         }
+        uploaded += rows;
+        if (!more) break;
+    }
+    syncing = false;
 
-        if (!String(currentFile.name()).startsWith("/log_")) {
-            currentFile.close();
-            return;
-        }
+    if (ok) stats.backoffMs = 0;
+    return ok;
+}
 
-        Serial.print("[SYNC] Uploading ");
-        Serial.println(currentFile.name());
-    }
+void LogSync::triggerSync() {
+    if (syncing) return;
 
-    // Read file line-by-line
-    while (currentFile.available()) {
-        String line = currentFile.readStringUntil('\n');
-        Serial.print("[CLOUD] ");
-        Serial.println(line);
-        return; // ONE LINE PER UPDATE (NON-BLOCKING)
+    Serial.println("[SYNC] Manual log sync started");
+    uint32_t uploaded;
+    int code;
+    if (syncNow(uploaded, code)) {
+        Serial.printf("[SYNC] Log sync completed, %lu rows\n", (unsigned long)uploaded);
+    } else {
+        Serial.printf("[SYNC] Log sync failed (HTTP %d) after %lu rows\n",
+                      code, (unsigned long)uploaded);
     }
-
-    // File finished
-    currentFile.close();
 }
 
 bool LogSync::isSyncing() {
     return syncing;
 }
 
-void LogSync::triggerAutoSync() {
-    Serial.println("[AUTO_SYNC] Manual trigger of cloud sync");
-    performCloudSync();
+LogSyncStats LogSync::getStats() {
+    return stats;
 }
@@ -1,11 +1,26 @@
 #pragma once
 #include <Arduino.h>
 
+struct LogSyncStats {
+    uint32_t batches;        // successful POSTs
+    uint32_t records;        // rows uploaded
+    uint32_t failures;
+    int      lastHttpCode;
+    uint32_t backoffMs;      // current retry delay (0 = healthy)
+    uint32_t deferrals;      // checks skipped because the door was busy
+    uint32_t lastSuccessMs;  // millis()
+};
+
 class LogSync {
 public:
     static void init();
-    static void triggerSync();     // called by admin command (serial debug)
-    static void update();          // Core 0 loop - handles scheduled sync
+    static void update();          // Core 0 loop - trickle scheduler
+
+    // Drain the backlog now, ignoring load deferral (SYNC_LOGS, serial 'S').
+    // Returns false on the first failed batch.
+    static bool syncNow(uint32_t& uploaded, int& httpCode);
+
+    static void triggerSync();     // serial debug
     static bool isSyncing();
-    static void triggerAutoSync(); // Direct cloud sync (bypass command queue)
+    static LogSyncStats getStats();
 };
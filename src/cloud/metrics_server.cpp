@@ -0,0 +1,95 @@
+#include "metrics_server.h"
+#include <WiFi.h>
+#include <WebServer.h>
+#include "../config/config.h"
+#include "../core/metrics.h"
+#include "../core/heap_monitor.h"
+#include "../core/trace.h"
+
+// ========== METRICS ==========
+// System-wide gauges, refreshed on each scrape rather than on a timer
+static Gauge uptimeGauge("emlock_uptime_seconds", "Seconds since boot");
+static Gauge heapFreeGauge("emlock_heap_free_bytes", "Free heap");
+static Gauge heapBlockGauge("emlock_heap_largest_block_bytes", "Largest allocatable heap block");
+static Gauge heapMinGauge("emlock_heap_min_free_bytes", "Lowest free heap since boot");
+static Gauge heapLevelGauge("emlock_heap_level", "Heap pressure level (0 normal, 1 warn, 2 crit)");
+static Gauge rssiGauge("emlock_wifi_rssi_dbm", "WiFi signal strength");
+static Counter scrapes("emlock_metrics_scrapes_total", "Metrics requests served");
+static Counter rejected("emlock_metrics_rejected_total", "Metrics requests refused (bad token)");
+
+// ========== STATE ==========
+static WebServer server(METRICS_PORT);
+static bool      started = false;
+
+// ========== HANDLERS ==========
+static bool authorized() {
+    if (METRICS_TOKEN[0] == '\0') return true;
+    String expected = String("Bearer ") + METRICS_TOKEN;
+    return server.header("Authorization") == expected;
+}
+
+static void sendChunk(const char* text, size_t len, void*) {
+    server.sendContent(text, len);
+}
+
+static void handleMetrics() {
+    if (!authorized()) {
+        rejected.inc();
+        server.send(401, "text/plain", "unauthorized\n");
+        return;
+    }
+    scrapes.inc();
+
+    uptimeGauge.set(millis() / 1000);
+    heapFreeGauge.set(ESP.getFreeHeap());
+    heapBlockGauge.set(ESP.getMaxAllocHeap());
+    heapMinGauge.set(ESP.getMinFreeHeap());
+    heapLevelGauge.set((int32_t)HeapMonitor::level());
+    rssiGauge.set(WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0);
+
+    // Chunked: the exposition is rendered straight into the socket
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+    Metrics::render(sendChunk, nullptr);
+    server.sendContent("");
+}
+
+static void sendTraceChunk(const uint8_t* data, size_t len, void*) {
+    server.sendContent((const char*)data, len);
+}
+
+// Raw dump for tools/trace_convert
+static void handleTrace() {
+    if (!authorized()) {
+        rejected.inc();
+        server.send(401, "text/plain", "unauthorized\n");
+        return;
+    }
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+    Trace::dump(sendTraceChunk, nullptr);
+    server.sendContent("");
+}
+
+// ========== PUBLIC FUNCTIONS ==========
+void MetricsServer::init() {
+#if METRICS_ENABLED
+    if (started) return;
+
+    static const char* headers[] = { "Authorization" };
+    server.collectHeaders(headers, 1);
+    server.on("/metrics", HTTP_GET, handleMetrics);
+    server.on("/trace", HTTP_GET, handleTrace);
+    server.onNotFound([]() { server.send(404, "text/plain", "not found\n"); });
+    server.begin();
+    started = true;
+
+    Serial.printf("[METRICS] Serving %u metrics on http://%s:%d/metrics\n",
+                  Metrics::count(), WiFi.localIP().toString().c_str(), METRICS_PORT);
+#endif
+}
+
+void MetricsServer::update() {
+    if (!started) return;
+    server.handleClient();
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <Arduino.h>
+
+// ==================== METRICS SERVER ====================
+// Serves the Metrics registry as Prometheus text on
+// http://<device>:METRICS_PORT/metrics so on-prem monitoring can scrape
+// doors directly. Requests are handled from the Core 0 loop, so a scrape
+// never touches the access path on Core 1.
+
+class MetricsServer {
+public:
+    static void init();     // once WiFi is READY
+    static void update();   // Core 0 loop: serve pending requests
+};
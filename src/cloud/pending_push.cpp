@@ -0,0 +1,172 @@
+#include "pending_push.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <time.h>
+#include "wifi_manager.h"
+#include "command_processor.h"
+#include "../config/config.h"
+#include "../core/heap_monitor.h"
+#include "../core/cloud_arena.h"
+#include "../core/stage_queue.h"
+#include "../core/json_writer.h"
+#include "../core/metrics.h"
+#include "../core/trace.h"
+#include "supabase_config.h"
+
+// ========== STATE ==========
+struct PendingCard {
+    char     uid[21];   // as Event::uid
+    uint8_t  door;
+    uint32_t epoch;     // 0 = before NTP sync: the server stamps it
+};
+
+static StageQueue queue("queue=\"pending\"", PENDING_PUSH_QUEUE_LEN, sizeof(PendingCard));
+
+// Loop task only from here down
+static PendingCard batch[PENDING_PUSH_BATCH_MAX];
+static uint8_t     batchCount    = 0;
+static uint32_t    batchSinceMs  = 0;      // first card of the batch arrived
+static uint32_t    nextAttemptMs = 0;
+static bool        rpcAvailable  = true;   // false once the RPC is missing (404)
+static char        deviceId[13]  = "";
+static PendingPushStats stats    = {};
+
+static Counter pushedTotal("emlock_pending_push_cards_total", "New pending cards reported to the cloud");
+static Counter droppedTotal("emlock_pending_push_dropped_total",
+                            "New pending cards not pushed because the batch was full");
+
+// ========== BATCH ==========
+static void addToBatch(const PendingCard& card) {
+    // Removed and tapped again before the push went out: one row
+    for (uint8_t i = 0; i < batchCount; i++) {
+        if (strcmp(batch[i].uid, card.uid) == 0) {
+            batch[i] = card;
+            return;
+        }
+    }
+    if (batchCount >= PENDING_PUSH_BATCH_MAX) {
+        droppedTotal.inc();
+        return;
+    }
+    if (batchCount == 0) batchSinceMs = millis();
+    batch[batchCount++] = card;
+}
+
+// ========== PAYLOAD ==========
+// Columnar, like the log and health uploads:
+//   {"batch":{"d":"<device>","u":[uids],"dr":[door],"t":[epoch, 0 = unknown]}}
+static int postBatch() {
+    HeapMonitor::Scope heap(HeapTag::CLOUD_HTTP);
+
+    ArenaBuffer body(64 + batchCount * 48);
+    JsonWriter w(body.data(), body.size());
+    w.beginObject().key("batch").beginObject();
+    w.key("d").string(deviceId);
+    w.key("u").beginArray();
+    for (uint8_t i = 0; i < batchCount; i++) w.string(batch[i].uid);
+    w.endArray();
+    w.key("dr").beginArray();
+    for (uint8_t i = 0; i < batchCount; i++) w.u32(batch[i].door);
+    w.endArray();
+    w.key("t").beginArray();
+    for (uint8_t i = 0; i < batchCount; i++) w.u32(batch[i].epoch);
+    w.endArray();
+    w.endObject().endObject();
+    if (!w.ok()) {
+        Serial.printf("[PENDING] Push body overflowed %u bytes, not sent\n", (unsigned)w.length());
+        return -1;
+    }
+
+    HTTPClient http;
+    http.begin(SUPABASE_URL "/rest/v1/rpc/report_pending_cards");
+    http.addHeader("apikey", SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
+    http.addHeader("Content-Type", "application/json");
+
+    uint32_t t0 = micros();
+    int code = http.POST((uint8_t*)w.c_str(), w.length());
+    Trace::record(TraceEvent::HTTP_PENDING_PUSH, t0, code);
+    HeapMonitor::checkpoint();   // TLS session still open
+    http.end();
+    return code;
+}
+
+static void onFailure(uint32_t now) {
+    stats.failures++;
+    stats.backoffMs = stats.backoffMs
+        ? min(stats.backoffMs * 2, (uint32_t)PENDING_PUSH_RETRY_MAX_MS)
+        : (uint32_t)PENDING_PUSH_RETRY_MIN_MS;
+    nextAttemptMs = now + stats.backoffMs + random(stats.backoffMs / 4 + 1);
+    Serial.printf("[PENDING] Push failed HTTP %d, retry in %lu ms\n",
+                  stats.lastHttpCode, (unsigned long)stats.backoffMs);
+}
+
+// ========== PUBLIC FUNCTIONS ==========
+
+void PendingPush::init() {
+    queue.init();
+}
+
+bool PendingPush::notify(const char* uid, uint8_t door) {
+    PendingCard card = {};
+    strncpy(card.uid, uid, sizeof(card.uid) - 1);
+    card.door = door;
+    time_t now = time(nullptr);
+    card.epoch = now > 1700000000 ? (uint32_t)now : 0;
+    return queue.send(&card);
+}
+
+void PendingPush::update() {
+    PendingCard card;
+    while (queue.receive(&card, 0)) {
+        if (rpcAvailable) addToBatch(card);
+    }
+    stats.waiting = batchCount;
+    if (batchCount == 0) return;
+
+    // Give a group arriving together the same POST
+    uint32_t now = millis();
+    if (now - batchSinceMs < PENDING_PUSH_COALESCE_MS) return;
+    if ((int32_t)(now - nextAttemptMs) < 0) return;
+    if (WiFiManager::getState() != WiFiState::READY) return;
+    if (HeapMonitor::level() == HeapLevel::CRIT) return;
+
+    if (!deviceId[0]) {
+        uint8_t mac[6];
+        WiFi.macAddress(mac);
+        snprintf(deviceId, sizeof(deviceId), "%02X%02X%02X%02X%02X%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+
+    int code = postBatch();
+    stats.lastHttpCode = code;
+
+    if (code == 404) {
+        Serial.println("[PENDING] report_pending_cards() missing, pushes off (GET_PENDING still works)");
+        rpcAvailable = false;
+        batchCount = 0;
+        stats.waiting = 0;
+        return;
+    }
+    if (code != 200 && code != 204) {
+        onFailure(now);
+        return;
+    }
+
+    Serial.printf("[PENDING] Pushed %u new card(s)\n", batchCount);
+    pushedTotal.inc(batchCount);
+    stats.pushed += batchCount;
+    stats.batches++;
+    stats.backoffMs = 0;
+    batchCount = 0;
+    stats.waiting = 0;
+
+    // An approval usually follows within the minute
+    CommandProcessor::expedite();
+}
+
+PendingPushStats PendingPush::getStats() {
+    PendingPushStats s = stats;
+    s.dropped = droppedTotal.value() + queue.stats().dropped;
+    return s;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+
+// ==================== PENDING PUSH ====================
+// New unknown cards are reported upstream as soon as they are recorded
+// as pending, so an admin can approve them without a GET_PENDING round
+// trip. The decision stage only queues the UID (notify() never blocks or
+// touches the network); update() on the loop task waits
+// PENDING_PUSH_COALESCE_MS for more cards and posts them together to the
+// report_pending_cards RPC (device_pending_reports).
+//
+// Best effort: NVS stays the source of truth. Cards dropped on a full
+// queue or batch are still returned by GET_PENDING.
+
+struct PendingPushStats {
+    uint32_t pushed;         // cards accepted by the cloud
+    uint32_t batches;
+    uint32_t failures;
+    uint32_t dropped;        // queue or batch full
+    int      lastHttpCode;
+    uint32_t backoffMs;      // current retry delay (0 = healthy)
+    uint8_t  waiting;        // cards in the batch
+};
+
+class PendingPush {
+public:
+    static void init();      // before the decision stage runs: creates the queue
+    static void update();    // Core 0 loop
+
+    // Decision stage, on AccessResult::PENDING_NEW
+    static bool notify(const char* uid, uint8_t door);
+
+    static PendingPushStats getStats();
+};
@@ -4,6 +4,8 @@
 #include <ArduinoJson.h>
 #include "../storage/nvs_store.h"
 #include "../storage/log_store.h"
+#include "../config/config.h"
+#include "../core/cloud_arena.h"
 #include "supabase_config.h"
 
 static uint32_t lastSync = 0;
@@ -43,11 +45,13 @@ void UIDSync::update() {
 
     // Fetch UIDs from Supabase
     HTTPClient http;
-    String url = String(SUPABASE_URL) + "/rest/v1/users?device_id=eq." + deviceId + "&select=uid,name,status";
+    char url[CLOUD_URL_BYTES];
+    snprintf(url, sizeof(url), SUPABASE_URL "/rest/v1/users?device_id=eq.%s&select=uid,name,status",
+             deviceId.c_str());
     
     http.begin(url);
     http.addHeader("apikey", SUPABASE_KEY);
-    http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
+    http.addHeader("Authorization", "Bearer " SUPABASE_KEY);
     http.addHeader("Content-Type", "application/json");
     
     int httpCode = http.GET();
@@ -58,12 +62,17 @@ void UIDSync::update() {
         return;
     }
     
-    String payload = http.getString();
+    ArenaBuffer payload(CLOUD_RESPONSE_BYTES);
+    int read = http.writeToStream(&payload);
     http.end();
+    if (read < 0 || payload.overflowed()) {
+        Serial.printf("[UID_SYNC] Response unreadable or over %u bytes\n", (unsigned)payload.capacity());
+        return;
+    }
     
-    // Parse JSON response
-    DynamicJsonDocument doc(4096);
-    DeserializationError err = deserializeJson(doc, payload);
+    // Parse JSON response in place
+    ArenaJsonDocument doc(CLOUD_RESPONSE_BYTES);
+    DeserializationError err = deserializeJson(doc, payload.data(), payload.length());
     
     if (err) {
         Serial.printf("[UID_SYNC] JSON parse error: %s\n", err.c_str());
@@ -77,7 +86,8 @@ void UIDSync::update() {
         return;
     }
     
-    // Reset local UID storage before re-applying
+    // Reset local UID storage before re-applying; only the difference is written
+    NVSStore::beginBatch();
     NVSStore::factoryReset();
     
     for (JsonObject user : users) {
@@ -97,5 +107,6 @@ void UIDSync::update() {
         }
     }
     
+    NVSStore::commitBatch();
     Serial.printf("[UID_SYNC] Synced %d UIDs from Supabase\n", users.size());
 }
@@ -23,7 +23,7 @@ void WiFiManager::init() {
     WiFi.mode(WIFI_STA);
     WiFi.disconnect(true);
     state = WiFiState::CONNECTING;
-    lastAttempt = millis();
+    lastAttempt = millis() - retryDelay;   // first attempt on the next update()
 }
 
 void WiFiManager::update() {
@@ -41,7 +41,9 @@ void WiFiManager::update() {
         }
 
         if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("[WIFI] Connected");
+            Serial.printf("[WIFI] Connected  IP %s  DNS %s\n",
+                          WiFi.localIP().toString().c_str(),
+                          WiFi.dnsIP().toString().c_str());
             state = WiFiState::CONNECTED;
             retryDelay = 5000; // reset backoff
         }
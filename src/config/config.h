@@ -6,6 +6,7 @@
 // ==================== PIN CONFIGURATION ====================
 #define BUZZER_PIN                 32
 #define EXIT_SENSOR_PIN            35
+#define RELAY_PIN                  25
 
 // RFID PN532 (SPI) — same pins formerly used by RC522
 #define PN532_SCK_PIN              18
@@ -21,19 +22,223 @@
 #define VOLTAGE_MONITOR_PIN        34
 #define VOLTAGE_DIVIDER_RATIO      1.0f
 
+// ==================== DOORS ====================
+// One controller can drive several doors. Each door has its own relay
+// and exit sensor (0xFF = none); both lists need DOOR_COUNT entries.
+// Door 0 is the door of a single-door install and the default for
+// commands without a door. Readers are bound to doors below.
+#define DOOR_COUNT                 1
+#define DOOR_RELAY_PINS            { RELAY_PIN }
+#define DOOR_EXIT_PINS             { EXIT_SENSOR_PIN }
+
+// ==================== RFID READERS ====================
+// PN532s sharing the SPI bus above, each with its own chip-select and
+// reset; all lists need RFID_READER_COUNT entries. A reader with its IRQ
+// wired (0xFF = not wired) is armed and collected without blocking;
+// the others are read with a short blocking timeout, one per poll,
+// round-robin. Several readers may open the same door (in/out pair).
+#define RFID_READER_COUNT          1
+#define RFID_READER_SS_PINS        { PN532_SS_PIN }
+#define RFID_READER_RST_PINS       { PN532_RST_PIN }
+#define RFID_READER_IRQ_PINS       { 0xFF }
+#define RFID_READER_DOORS          { 0 }
+#define RFID_READ_TIMEOUT_MS       50     // blocking read, readers without IRQ
+#define RFID_ARM_TIMEOUT_MS        1000   // re-arm an IRQ reader that stayed silent
+
+// ==================== ACCESS PIPELINE ====================
+// Core 1 runs three tasks joined by bounded queues (core/stage_queue.h):
+// reader (SPI, exit sensors) -> decision (NVS lookups, access log) ->
+// actuator (relays, buzzer). The actuator outranks the others so a
+// door opens while the reader is mid-transaction or flash is busy.
+#define PIPELINE_READER_STACK      4096
+#define PIPELINE_READER_PRIO       2
+#define PIPELINE_DECISION_STACK    8192   // NVS + LittleFS appends
+#define PIPELINE_DECISION_PRIO     3
+#define PIPELINE_ACTUATOR_STACK    3072
+#define PIPELINE_ACTUATOR_PRIO     5
+#define PIPELINE_READER_PERIOD_MS  5      // reader pass interval
+#define PIPELINE_TICK_MS           20     // idle wake-up: relay mirror, access log drain
+#define PIPELINE_TAP_QUEUE_LEN     8      // reader -> decision
+#define PIPELINE_EVENT_QUEUE_LEN   10     // decision / exit / remote -> actuator
+#define PIPELINE_JOURNAL_QUEUE_LEN 16     // actuator -> decision (access log records)
+
+// ==================== TAP CACHE ====================
+// Recent unknown / blacklisted UIDs answered from RAM; repeated taps are
+// logged once per burst (access/tap_cache.h)
+#define TAP_CACHE_ENTRIES          16
+#define TAP_BURST_GAP_MS           30000  // a tap this soon after the last is a repeat
+#define TAP_BURST_MAX_MS           300000 // summarise an unbroken burst at least this often
+
+// ==================== NVS ====================
+// NVSStore mirrors the UID lists in RAM and writes flash only for real
+// changes; SYNC_UIDS commits one diff (storage/nvs_store.h)
+#define NVS_UID_CAPACITY           128    // UIDs per list held in RAM (16 B each); more spill to flash lookups
+#define NVS_CMD_CHECKPOINT_MS      30000  // last command id reaches flash this long after the last command
+#define NVS_WEAR_CHECKPOINT_MS     3600000
+#define NVS_UID_PAGE_MAX           64     // UIDs per listPage() / GET_PENDING page (16 B of stack each)
+
 // ==================== HEALTH REPORTING ====================
 #define HEALTH_PRINT_INTERVAL_MS   5000   // Print health every 5s
 
-// Heap warning levels (bytes)
+// Cloud push: every interval sends only what changed since the last
+// accepted push; a full record goes up at boot and every refresh period
+#define HEALTH_PUSH_INTERVAL_MS    15000
+#define HEALTH_FULL_REFRESH_MS     3600000
+#define HEALTH_PAYLOAD_BYTES       5120   // full push with 16 tasks + loop profile
+#define HEALTH_HEAP_DEADBAND       2048   // bytes
+#define HEALTH_STORAGE_DEADBAND    4096   // bytes
+#define HEALTH_STACK_DEADBAND      256    // bytes
+#define HEALTH_RSSI_DEADBAND       4      // dBm
+#define HEALTH_VOLTAGE_DEADBAND    0.05f  // volts
+#define HEALTH_READ_TIME_DEADBAND  60     // seconds
+
+// History: a compact sample every interval into a RAM ring, uploaded in
+// batches; while offline a full ring spills its oldest batch to LittleFS
+#define HEALTH_SAMPLE_INTERVAL_MS  10000
+#define HEALTH_HISTORY_SAMPLES     180    // 30 min of samples, 24 B each
+#define HEALTH_HISTORY_BATCH       60     // samples per upload / spill
+#define HEALTH_HISTORY_UPLOAD_MS   300000 // upload at least this often
+#define HEALTH_HISTORY_SPILL       1      // 0 = RAM ring only
+#define HEALTH_HISTORY_SPILL_BYTES 24576  // ~2.7 h of samples
+
+// CPU and loop profiling, exported with the health push
+#define LOOP_PROFILE_STAGES        8      // named stages per loop
+#define LOOP_PROFILE_INTERVAL_MS   60000  // profile window sent this often
+#define LOOP_STALL_ACCESS_US       50000  // access loop iteration = stall
+#define LOOP_STALL_CLOUD_US        2000000
+#define HEALTH_CPU_DEADBAND        5      // percent
+#define HEALTH_FRAG_DEADBAND       50     // permille
+
+// Heap warning levels (bytes); cloud work sheds load below these
 #define HEAP_WARN_LEVEL            40000
 #define HEAP_CRIT_LEVEL            20000
+#define HEAP_HYSTERESIS            8000   // climb this far above a level to leave it
+#define HEAP_CRIT_BLOCK            8192   // largest free block below this = CRIT
+#define HEAP_CHECK_MS              1000
+#define HEAP_TREND_SAMPLE_MS       60000  // fragmentation trend point
+#define HEAP_TREND_POINTS          16
+
+// Local metrics endpoint for on-prem Prometheus (MetricsServer)
+#define METRICS_ENABLED            1
+#define METRICS_PORT               9100   // GET /metrics
+#define METRICS_TOKEN              ""     // non-empty: require "Authorization: Bearer <token>"
+#define METRICS_HIST_MAX_BOUNDS    10     // histogram buckets, excluding +Inf
+#define METRICS_RENDER_CHUNK       512    // bytes per chunked-transfer write
+
+// Binary timeline trace (Trace), dumped with 'T' on serial or GET /trace
+#define TRACE_ENABLED              1
+#define TRACE_RING_RECORDS         256    // per core, 12 B each
 
 // ==================== LOGGING ====================
 #define LOG_RETENTION_DAYS_LOCAL   30
 #define LOG_RETENTION_DAYS_CLOUD   90
 
+// Write-behind buffer: routine events are group-committed, security
+// events (see LogStore durability table) are flushed immediately
+#define LOG_WRITE_BUFFER_BYTES     1024
+#define LOG_FLUSH_BYTES            768    // flush once this much is buffered
+#define LOG_FLUSH_AGE_MS           5000   // ...or the oldest line is this old
+#define LOG_EARLY_RECORDS          8      // held in RAM until LittleFS is mounted
+
+// Segmented storage: fixed-size files, oldest evicted past the quota
+#define LOG_SEGMENT_BYTES          16384
+#define LOG_QUOTA_PERCENT          60     // of LittleFS capacity
+#define LOG_RETENTION_INTERVAL_MS  3600000UL  // start a retention pass hourly
+#define LOG_RETENTION_STEPS_PER_UPDATE 2      // file ops per LogStore::update()
+
+// Binary record encoding (LogCodec)
+#define LOG_DICT_MAX               128    // UIDs dictionary-coded per segment
+#define LOG_TZ_OFFSET_MINUTES      330    // IST, matches configTime() in WiFiManager
+#define LOG_READ_CHUNK_BYTES       256
+
+// Per-segment query index (sidecar /seg_NNNNNNNN.idx)
+#define LOG_INDEX_STRIDE           64     // records between time checkpoints
+#define LOG_INDEX_CHECKPOINTS      48
+#define LOG_INDEX_BLOOM_BYTES      128    // UID filter, 1024 bits
+#define LOG_QUERY_DEFAULT_LIMIT    20
+#define LOG_QUERY_MAX_LIMIT        50
+#define LOG_QUERY_SCAN_BUDGET      65536  // bytes read per QUERY_LOGS page
+
+// Trickle cloud sync (LogSync): upload small batches as soon as there is
+// a useful amount or the oldest record has waited long enough, but stay
+// out of the way while the door is busy
+#define LOG_SYNC_CHECK_MS          1000
+#define LOG_SYNC_TRIGGER_BYTES     512     // ~100 binary records
+#define LOG_SYNC_MAX_DELAY_MS      60000   // upload anything older than this
+#define LOG_SYNC_QUIET_MS          3000    // no door event for this long
+#define LOG_SYNC_MAX_DEFER_MS      300000  // ...unless the backlog is this old
+#define LOG_SYNC_BATCH_MAX         100     // records per POST on a good link
+#define LOG_SYNC_BATCH_GAP_MS      500     // between batches while draining
+#define LOG_SYNC_RSSI_GOOD         -67     // dBm; below: half batches
+#define LOG_SYNC_RSSI_WEAK         -80     // dBm; below: quarter batches
+#define LOG_SYNC_BACKOFF_MIN_MS    5000
+#define LOG_SYNC_BACKOFF_MAX_MS    600000
+#define LOG_SYNC_MANUAL_BATCHES    20      // SYNC_LOGS drains at most this many
+
+// ==================== COMMAND POLLING ====================
+// CommandProcessor polls fast after activity (a command, a pushed pending
+// card, an admin viewing the device) and doubles the interval while idle.
+// CMD_POLL_IDLE_MAX_MS bounds the latency of an unannounced command.
+#define CMD_POLL_FAST_MS           2000
+#define CMD_POLL_IDLE_MAX_MS       30000
+#define CMD_POLL_ACTIVE_HOLD_MS    60000  // stay fast this long after activity
+#define CMD_POLL_JITTER_PCT        20     // +/- per poll, so a fleet never polls in lockstep
+
+// ==================== PENDING PUSH ====================
+// New unknown cards are pushed to device_pending_reports right away
+// (cloud/pending_push.h); cards arriving together share one POST
+#define PENDING_PUSH_QUEUE_LEN     8      // decision stage -> loop task
+#define PENDING_PUSH_BATCH_MAX     16     // cards per POST; more wait for GET_PENDING
+#define PENDING_PUSH_COALESCE_MS   250    // after the first card of a batch
+#define PENDING_PUSH_RETRY_MIN_MS  2000   // doubles per failure
+#define PENDING_PUSH_RETRY_MAX_MS  60000
+
+// ==================== CLOUD MEMORY ====================
+// Cloud JSON documents, request bodies and responses come from one static
+// arena (core/cloud_arena.h); whatever doesn't fit falls back to the heap
+// and is counted. Budget: a command poll with a QUERY_LOGS result and its
+// ack nested inside is the deepest path (~22 KB at the maximum limit).
+#define CLOUD_ARENA_BYTES          24576
+#define CLOUD_RESPONSE_BYTES       4096   // command poll response (SYNC_UIDS: ~100 UIDs)
+#define CLOUD_CMD_DOC_BYTES        3072   // parsed in place: strings stay in the response
+#define CLOUD_URL_BYTES            192
+
+// ==================== BOOT ====================
+// setup() brings up the access path only; LittleFS, WiFi and cloud
+// services start from loop() (core/boot_profile.h)
+#define BOOT_TARGET_MS             300    // reset -> first card poll
+
 // ==================== SYSTEM LIMITS ====================
 #define MAX_USERS                  10     // Can change later
 
 // ==================== DEBUG ====================
+// 1 = debug build, 0 = production (pio run -e esp32dev_release)
+#ifndef DEBUG_SERIAL
 #define DEBUG_SERIAL               1
+#endif
+
+// Console (Serial) verbosity per module, fixed at compile time: LOGx()
+// statements above a module's level generate no code (core/console_log.h)
+#define CONSOLE_LEVEL_NONE         0
+#define CONSOLE_LEVEL_ERROR        1
+#define CONSOLE_LEVEL_WARN         2
+#define CONSOLE_LEVEL_INFO         3
+#define CONSOLE_LEVEL_DEBUG        4
+
+#if DEBUG_SERIAL
+#define CONSOLE_LEVEL_DEFAULT      CONSOLE_LEVEL_DEBUG
+#else
+#define CONSOLE_LEVEL_DEFAULT      CONSOLE_LEVEL_WARN
+#endif
+
+#define CONSOLE_LEVEL_ACCESS       CONSOLE_LEVEL_DEFAULT   // AccessController, AccessDecision, ExitSensor
+#define CONSOLE_LEVEL_RFID         CONSOLE_LEVEL_DEFAULT
+#define CONSOLE_LEVEL_NVS          CONSOLE_LEVEL_DEFAULT
+#define CONSOLE_LEVEL_LOGSTORE     CONSOLE_LEVEL_DEFAULT
+#define CONSOLE_LEVEL_HARDWARE     CONSOLE_LEVEL_DEFAULT   // relay, buzzer
+#define CONSOLE_LEVEL_CORE         CONSOLE_LEVEL_DEFAULT   // ThreadSafe, HeapMonitor, Trace
+
+// Enabled lines are queued and written by a low-priority task, so the
+// caller never waits on the UART
+#define CONSOLE_LOG_RING_BYTES     4096
+#define CONSOLE_LOG_LINE_BYTES     192    // longer lines are truncated
@@ -0,0 +1,62 @@
+#include "core/boot_profile.h"
+#include <stdio.h>
+#include "config/config.h"
+
+// ========== STATE ==========
+static const char* const PHASE_NAMES[] = {
+    "setup", "hardware", "access_task", "rfid_ready",
+    "first_poll", "logstore", "network", "cloud_ready"
+};
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == (size_t)BootPhase::COUNT,
+              "every BootPhase needs a name");
+
+static uint32_t phaseUs[(uint8_t)BootPhase::COUNT] = {};
+
+// ========== PUBLIC FUNCTIONS ==========
+void BootProfile::mark(BootPhase phase) {
+    uint8_t i = (uint8_t)phase;
+    if (i >= (uint8_t)BootPhase::COUNT || phaseUs[i]) return;
+    uint32_t now = micros();
+    phaseUs[i] = now ? now : 1;
+
+    if (phase == BootPhase::FIRST_POLL) {
+        uint32_t ms = phaseUs[i] / 1000;
+        Serial.printf("[BOOT] First card poll at %lu ms%s\n", (unsigned long)ms,
+                      ms > BOOT_TARGET_MS ? " (over target)" : "");
+    }
+}
+
+bool BootProfile::reached(BootPhase phase) {
+    return atUs(phase) != 0;
+}
+
+uint32_t BootProfile::atUs(BootPhase phase) {
+    uint8_t i = (uint8_t)phase;
+    return i < (uint8_t)BootPhase::COUNT ? phaseUs[i] : 0;
+}
+
+const char* BootProfile::name(BootPhase phase) {
+    uint8_t i = (uint8_t)phase;
+    return i < (uint8_t)BootPhase::COUNT ? PHASE_NAMES[i] : "?";
+}
+
+size_t BootProfile::toJson(char* out, size_t outSize) {
+    if (outSize < 3) return 0;
+    size_t len = 0;
+    out[len++] = '{';
+    bool first = true;
+    for (uint8_t i = 0; i < (uint8_t)BootPhase::COUNT; i++) {
+        if (!phaseUs[i]) continue;
+        int n = snprintf(out + len, outSize - len, "%s\"%s\":%lu.%lu",
+                         first ? "" : ",", PHASE_NAMES[i],
+                         (unsigned long)(phaseUs[i] / 1000),
+                         (unsigned long)(phaseUs[i] % 1000 / 100));
+        if (n < 0 || (size_t)n >= outSize - len) return 0;
+        len += n;
+        first = false;
+    }
+    if (len + 2 > outSize) return 0;
+    out[len++] = '}';
+    out[len]   = '\0';
+    return len;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ========== BOOT PROFILE ==========
+// Time from reset to each boot milestone. setup() starts the access path
+// first (relay, NVS, Core 1 task) and leaves LittleFS, WiFi and cloud
+// services to the first loop() passes, so FIRST_POLL - the reader
+// accepting cards - is the number that matters (target BOOT_TARGET_MS).
+//
+// Times come from micros(), which starts when the app does; the ROM and
+// second-stage bootloader before that are not included.
+
+enum class BootPhase : uint8_t {
+    SETUP,          // setup() entered
+    HARDWARE,       // relay locked, NVS, event queue, buzzer, exit sensor
+    ACCESS_TASK,    // Core 1 pipeline tasks created
+    RFID_READY,     // PN532 configured
+    FIRST_POLL,     // first card poll completed
+    LOGSTORE,       // LittleFS mounted, early records written
+    NETWORK,        // WiFi started, LogSync ready
+    CLOUD_READY,    // command, health and metrics services up
+    COUNT
+};
+
+class BootProfile {
+public:
+    // First call per phase wins; later calls are ignored
+    static void mark(BootPhase phase);
+
+    static bool     reached(BootPhase phase);
+    static uint32_t atUs(BootPhase phase);   // since reset; 0 = not reached
+    static const char* name(BootPhase phase);
+
+    // {"setup":1.2,"hardware":35.0,...} in ms, reached phases only.
+    // Returns bytes written (excluding NUL), 0 if it didn't fit.
+    static size_t toJson(char* out, size_t outSize);
+};
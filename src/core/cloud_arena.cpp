@@ -0,0 +1,167 @@
+#include "core/cloud_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "core/metrics.h"
+#include "core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_CORE
+
+// ========== STATE ==========
+// Blocks are stacked from the bottom: [header][payload][header][payload]...
+struct BlockHeader {
+    uint32_t prev;   // header offset of the block below, NO_BLOCK for the first
+    uint32_t size;   // payload bytes, multiple of ALIGN; RELEASED bit once freed
+};
+
+static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+static const uint32_t RELEASED = 0x80000000;
+static const size_t   ALIGN    = 8;
+
+alignas(8) static uint8_t arena[CLOUD_ARENA_BYTES];
+static uint32_t     top   = 0;          // first free byte
+static uint32_t     last  = NO_BLOCK;   // header offset of the topmost block
+static uint32_t     peak  = 0;
+static TaskHandle_t owner = nullptr;
+
+static Gauge   usedBytes("emlock_cloud_arena_used_bytes", "Cloud arena bytes in use");
+static Gauge   peakBytes("emlock_cloud_arena_peak_bytes", "Cloud arena high-water mark since boot");
+static Counter fallbacks("emlock_cloud_arena_fallbacks_total",
+                         "Cloud buffers served from the heap because the arena was full or off-task");
+
+static inline BlockHeader* header(uint32_t offset) {
+    return (BlockHeader*)(arena + offset);
+}
+
+static inline bool inArena(const void* p) {
+    return (const uint8_t*)p >= arena && (const uint8_t*)p < arena + sizeof(arena);
+}
+
+static inline uint32_t rounded(size_t bytes) {
+    return (uint32_t)((bytes + ALIGN - 1) & ~(ALIGN - 1));
+}
+
+static void noteUse() {
+    usedBytes.set(top);
+    if (top > peak) {
+        peak = top;
+        peakBytes.set(peak);
+    }
+}
+
+static void* heapFallback(size_t bytes) {
+    fallbacks.inc();
+    LOGD("[ARENA] %u bytes from the heap (arena %lu / %u used)\n",
+         (unsigned)bytes, (unsigned long)top, (unsigned)sizeof(arena));
+    return malloc(bytes);
+}
+
+// ========== IMPLEMENTATION ==========
+void CloudArena::init() {
+    owner = xTaskGetCurrentTaskHandle();
+    LOGI("[ARENA] %u bytes reserved for the cloud path\n", (unsigned)sizeof(arena));
+}
+
+void* CloudArena::allocate(size_t bytes) {
+    uint32_t need = sizeof(BlockHeader) + rounded(bytes);
+    if (!owner || xTaskGetCurrentTaskHandle() != owner || top + need > sizeof(arena)) {
+        return heapFallback(bytes);
+    }
+
+    BlockHeader* h = header(top);
+    h->prev = last;
+    h->size = rounded(bytes);
+    last = top;
+    top += need;
+    noteUse();
+    return h + 1;
+}
+
+void CloudArena::release(void* p) {
+    if (!p) return;
+    if (!inArena(p)) {
+        free(p);
+        return;
+    }
+
+    ((BlockHeader*)p - 1)->size |= RELEASED;
+    // Pop every released block off the top, including ones freed earlier
+    // out of order
+    while (last != NO_BLOCK && (header(last)->size & RELEASED)) {
+        top  = last;
+        last = header(last)->prev;
+    }
+    usedBytes.set(top);
+}
+
+void* CloudArena::resize(void* p, size_t bytes) {
+    if (!p) return allocate(bytes);
+    if (!inArena(p)) return realloc(p, bytes);
+
+    BlockHeader* h = (BlockHeader*)p - 1;
+    uint32_t offset = (uint8_t*)h - arena;
+
+    // The top block grows or shrinks in place
+    if (offset == last && offset + sizeof(BlockHeader) + rounded(bytes) <= sizeof(arena)) {
+        h->size = rounded(bytes);
+        top = offset + sizeof(BlockHeader) + h->size;
+        noteUse();
+        return p;
+    }
+
+    void* moved = allocate(bytes);
+    if (!moved) return nullptr;
+    memcpy(moved, p, min((size_t)h->size, bytes));
+    release(p);
+    return moved;
+}
+
+CloudArenaStats CloudArena::stats() {
+    CloudArenaStats s;
+    s.capacity  = sizeof(arena);
+    s.used      = top;
+    s.peak      = peak;
+    s.fallbacks = fallbacks.value();
+    return s;
+}
+
+// ========== BUFFER ==========
+ArenaBuffer::ArenaBuffer(size_t capacity)
+    : buf((char*)CloudArena::allocate(capacity + 1)), cap(buf ? capacity : 0), len(0), overflow(false) {
+    if (buf) buf[0] = '\0';
+}
+
+ArenaBuffer::~ArenaBuffer() {
+    CloudArena::release(buf);
+}
+
+void ArenaBuffer::clear() {
+    len = 0;
+    overflow = false;
+    if (buf) buf[0] = '\0';
+}
+
+void ArenaBuffer::setLength(size_t n) {
+    len = min(n, cap);
+    if (buf) buf[len] = '\0';
+}
+
+size_t ArenaBuffer::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t ArenaBuffer::write(const uint8_t* data, size_t n) {
+    if (!buf) {
+        overflow = n > 0;
+        return 0;
+    }
+    if (len + n > cap) {
+        overflow = true;
+        n = cap - len;
+    }
+    memcpy(buf + len, data, n);
+    len += n;
+    buf[len] = '\0';
+    return n;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/config.h"
+
+// ========== CLOUD ARENA ==========
+// Preallocated memory for the cloud path on the loop task: parsed
+// commands, command results, upload bodies and HTTP responses come out of
+// one static block (CLOUD_ARENA_BYTES) instead of the heap, so hours of
+// command polls and batch uploads can't fragment it.
+//
+// Blocks are released in reverse order of allocation, which C++ scopes
+// give for free; a block released out of order is reclaimed as soon as
+// everything above it is. Requests that don't fit, or come from another
+// task, fall back to the heap and are counted, so a non-zero
+//   emlock_cloud_arena_fallbacks_total
+// means CLOUD_ARENA_BYTES is too small for some path. Use and high-water
+// mark are exported as emlock_cloud_arena_used_bytes / _peak_bytes.
+//
+// HTTPClient and the TLS stack keep their own allocations; HeapMonitor
+// scopes (HeapTag::CLOUD_HTTP) still account for those.
+
+struct CloudArenaStats {
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t peak;        // high-water mark since boot
+    uint32_t fallbacks;   // served from the heap instead
+};
+
+class CloudArena {
+public:
+    static void init();   // binds the arena to the calling task (loop)
+
+    static void* allocate(size_t bytes);   // nullptr only if the heap is out too
+    static void  release(void* p);
+    static void* resize(void* p, size_t bytes);
+
+    static CloudArenaStats stats();
+};
+
+// ArduinoJson allocator over the arena
+struct ArenaJsonAllocator {
+    void* allocate(size_t size)                { return CloudArena::allocate(size); }
+    void  deallocate(void* ptr)                { CloudArena::release(ptr); }
+    void* reallocate(void* ptr, size_t newSize) { return CloudArena::resize(ptr, newSize); }
+};
+
+typedef BasicJsonDocument<ArenaJsonAllocator> ArenaJsonDocument;
+
+// Fixed-capacity text buffer from the arena, always NUL-terminated. It is
+// also the Stream HTTPClient::writeToStream() fills, so a response body
+// lands here without a String (chunked encoding is undone by HTTPClient).
+// Parsing it with deserializeJson(doc, buf.data(), buf.length()) is
+// zero-copy: strings in the document point into the buffer.
+class ArenaBuffer : public Stream {
+public:
+    explicit ArenaBuffer(size_t capacity);
+    ~ArenaBuffer();
+    ArenaBuffer(const ArenaBuffer&) = delete;
+    ArenaBuffer& operator=(const ArenaBuffer&) = delete;
+
+    char*  data()           { return buf; }
+    size_t length() const   { return len; }
+    size_t capacity() const { return cap; }
+    size_t size() const     { return buf ? cap + 1 : 0; }   // for JsonWriter / snprintf
+    bool   overflowed() const { return overflow; }
+    void   setLength(size_t n);   // after writing into data() directly
+    void   clear();
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t n) override;
+    int available() override { return 0; }
+    int read() override      { return -1; }
+    int peek() override      { return -1; }
+
+private:
+    char*  buf;
+    size_t cap;
+    size_t len;
+    bool   overflow;
+};
@@ -0,0 +1,94 @@
+#include "core/console_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// ========== STATE ==========
+static char         ring[CONSOLE_LOG_RING_BYTES];
+static uint16_t     ringHead     = 0;   // next byte written
+static uint16_t     ringUsed     = 0;
+static portMUX_TYPE ringMux      = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTask    = nullptr;
+static uint32_t     droppedLines = 0;   // ring full; reported by the drain task
+
+static const size_t DRAIN_CHUNK = 128;
+
+// ========== DRAIN ==========
+// Copies out a chunk at a time so writers are never held up by the UART
+static void drainLoop(void*) {
+    char     chunk[DRAIN_CHUNK];
+    uint32_t reportedDrops = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        while (true) {
+            size_t n = 0;
+            portENTER_CRITICAL(&ringMux);
+            uint16_t tail = (ringHead + CONSOLE_LOG_RING_BYTES - ringUsed) % CONSOLE_LOG_RING_BYTES;
+            while (n < DRAIN_CHUNK && n < ringUsed) {
+                chunk[n] = ring[(tail + n) % CONSOLE_LOG_RING_BYTES];
+                n++;
+            }
+            ringUsed -= n;
+            uint32_t drops = droppedLines;
+            portEXIT_CRITICAL(&ringMux);
+
+            if (n == 0) {
+                if (drops != reportedDrops) {
+                    Serial.printf("[LOG] %lu console lines dropped (ring full)\n",
+                                  (unsigned long)(drops - reportedDrops));
+                    reportedDrops = drops;
+                }
+                break;
+            }
+            Serial.write((const uint8_t*)chunk, n);   // blocks on the UART, not the caller
+        }
+    }
+}
+
+// ========== PUBLIC FUNCTIONS ==========
+void ConsoleLog::begin() {
+    if (drainTask) return;
+    // Lowest priority above idle; Core 0, away from the access task
+    if (xTaskCreatePinnedToCore(drainLoop, "console_log", 2048, nullptr, 1, &drainTask, 0) != pdPASS) {
+        drainTask = nullptr;
+        Serial.println("[LOG] Console drain task failed, logging synchronously");
+    }
+}
+
+void ConsoleLog::write(const char* fmt, ...) {
+    char line[CONSOLE_LOG_LINE_BYTES];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0) return;
+    if ((size_t)n >= sizeof(line)) {
+        n = sizeof(line) - 1;
+        line[n - 1] = '\n';
+    }
+
+    if (!drainTask) {
+        Serial.write((const uint8_t*)line, n);
+        return;
+    }
+
+    // Whole lines or nothing, so the console never shows a torn line
+    bool queued = false;
+    portENTER_CRITICAL(&ringMux);
+    if (ringUsed + n <= CONSOLE_LOG_RING_BYTES) {
+        for (int i = 0; i < n; i++) {
+            ring[ringHead] = line[i];
+            ringHead = (ringHead + 1) % CONSOLE_LOG_RING_BYTES;
+        }
+        ringUsed += n;
+        queued = true;
+    } else {
+        droppedLines++;
+    }
+    portEXIT_CRITICAL(&ringMux);
+
+    if (queued) xTaskNotifyGive(drainTask);
+}
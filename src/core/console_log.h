@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config/config.h"
+
+// ========== CONSOLE LOG ==========
+// Leveled Serial output. Each .cpp picks its module level once, after
+// its includes:
+//
+//   #define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_NVS
+//
+// and logs with LOGE / LOGW / LOGI / LOGD. The format string carries its
+// own "[TAG] " prefix and trailing newline, as Serial.printf did. The
+// level test is a compile-time constant, so statements above the module
+// level (arguments included) are compiled out.
+//
+// Enabled lines are formatted on the caller's stack and copied into a
+// ring; a low-priority task on Core 0 drains it to the UART. Before
+// begin(), and on the host, lines go straight to Serial.
+
+#define CONSOLE_LOG_AT(level, fmt, ...) \
+    do { if ((level) <= CONSOLE_LOG_LEVEL) ConsoleLog::write(fmt, ##__VA_ARGS__); } while (0)
+
+#define LOGE(fmt, ...) CONSOLE_LOG_AT(CONSOLE_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOGW(fmt, ...) CONSOLE_LOG_AT(CONSOLE_LEVEL_WARN,  fmt, ##__VA_ARGS__)
+#define LOGI(fmt, ...) CONSOLE_LOG_AT(CONSOLE_LEVEL_INFO,  fmt, ##__VA_ARGS__)
+#define LOGD(fmt, ...) CONSOLE_LOG_AT(CONSOLE_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+class ConsoleLog {
+public:
+    static void begin();       // start the drain task (setup)
+    static void write(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+};
@@ -1,19 +1,39 @@
 #include "event_queue.h"
+#include "config/config.h"
+#include "trace.h"
 
-QueueHandle_t EventQueue::queue = nullptr;
+StageQueue EventQueue::queue("queue=\"event\"", PIPELINE_EVENT_QUEUE_LEN, sizeof(Event));
+
+// ========== METRICS ==========
+static const uint32_t WAIT_BOUNDS_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000 };
+
+static Histogram waitSeconds("emlock_pipeline_wait_seconds", "Time an item spent queued before its stage took it",
+                             WAIT_BOUNDS_US, sizeof(WAIT_BOUNDS_US) / sizeof(WAIT_BOUNDS_US[0]),
+                             1000000.0f, "queue=\"event\"");
 
 void EventQueue::init() {
-    if (queue == nullptr) {
-        queue = xQueueCreate(10, sizeof(Event));
-    }
+    queue.init();
 }
 
 bool EventQueue::send(const Event& evt) {
-    if (!queue) return false;
-    return xQueueSend(queue, &evt, 0) == pdTRUE;
+    if (!queue.ready()) return false;
+    uint32_t t0 = micros();
+    Event stamped = evt;
+    stamped.sentUs = t0;
+    bool sent = queue.send(&stamped);
+    Trace::record(TraceEvent::QUEUE_SEND, t0, sent ? (int16_t)evt.type : -1);
+    return sent;
+}
+
+bool EventQueue::receive(Event& evt, TickType_t wait) {
+    if (!queue.ready()) return false;
+    if (!queue.receive(&evt, wait)) return false;
+    // Span covers the time queued, not the (possibly blocking) receive
+    waitSeconds.observe(micros() - evt.sentUs);
+    Trace::record(TraceEvent::QUEUE_RECV, evt.sentUs, (int16_t)evt.type);
+    return true;
 }
 
-bool EventQueue::receive(Event& evt) {
-    if (!queue) return false;
-    return xQueueReceive(queue, &evt, 0) == pdTRUE;
+StageQueueStats EventQueue::stats() {
+    return queue.stats();
 }
@@ -1,15 +1,19 @@
 #pragma once
 
 #include "core/event_types.h"
-#include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
+#include "core/stage_queue.h"
+
+// ========== EVENT QUEUE ==========
+// Decided events for the actuator stage: RFID results from the decision
+// stage, exit requests from the reader stage, remote unlocks from Core 0.
 
 class EventQueue {
 public:
     static void init();
     static bool send(const Event& evt);
-    static bool receive(Event& evt);
+    static bool receive(Event& evt, TickType_t wait = 0);
+    static StageQueueStats stats();
 
 private:
-    static QueueHandle_t queue;
+    static StageQueue queue;
 };
@@ -23,4 +23,8 @@ enum class EventType : uint8_t {
 struct Event {
     EventType type;
     char uid[21];   // empty for non-RFID events
+    uint8_t door;   // index into the DOOR_* tables (config.h)
+    uint8_t reader; // RFID reader that produced a tap
+    uint16_t repeat; // RFID: taps of this card earlier in the burst (TapCache), 0 = first
+    uint32_t sentUs; // micros() when queued, set by EventQueue::send
 };
@@ -0,0 +1,213 @@
+#include "core/heap_monitor.h"
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_CORE
+
+// ========== STATE ==========
+static HeapTagStats tags[(uint8_t)HeapTag::COUNT] = {};
+static uint32_t     prevAllocBytes[(uint8_t)HeapTag::COUNT] = {};
+static portMUX_TYPE heapMux = portMUX_INITIALIZER_UNLOCKED;
+
+static HeapLevel currentLevel  = HeapLevel::NORMAL;
+static uint32_t  levelChanges  = 0;
+static uint32_t  lastCheckMs   = 0;
+static uint32_t  lastTrendMs   = 0;
+static uint32_t  freeBytes     = 0;
+static uint32_t  largestBlock  = 0;
+static uint16_t  fragPermille  = 0;
+
+static uint16_t trend[HEAP_TREND_POINTS];
+static uint8_t  trendHead  = 0;
+static uint8_t  trendCount = 0;
+
+static const char* const TAG_NAMES[]   = { "cloud_http", "json", "logging", "access" };
+static const char* const LEVEL_NAMES[] = { "NORMAL", "WARN", "CRIT" };
+
+// ========== HELPERS ==========
+// Levels are entered at their threshold and left only once the heap has
+// climbed HEAP_HYSTERESIS above it, so a heap hovering at the line
+// doesn't flap
+static HeapLevel classify(uint32_t freeB, uint32_t largest, HeapLevel cur) {
+    bool inCrit = cur == HeapLevel::CRIT;
+    if (freeB < HEAP_CRIT_LEVEL + (inCrit ? HEAP_HYSTERESIS : 0) ||
+        largest < HEAP_CRIT_BLOCK + (inCrit ? HEAP_HYSTERESIS / 2 : 0)) {
+        return HeapLevel::CRIT;
+    }
+    if (freeB < HEAP_WARN_LEVEL + (cur != HeapLevel::NORMAL ? HEAP_HYSTERESIS : 0)) {
+        return HeapLevel::WARN;
+    }
+    return HeapLevel::NORMAL;
+}
+
+// Least-squares slope of the per-minute fragmentation points, per hour
+static int16_t trendPerHour() {
+    if (trendCount < 2) return 0;
+    uint8_t start = (trendHead + HEAP_TREND_POINTS - trendCount) % HEAP_TREND_POINTS;
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < trendCount; i++) {
+        float y = trend[(start + i) % HEAP_TREND_POINTS];
+        sx  += i;
+        sy  += y;
+        sxx += (float)i * i;
+        sxy += i * y;
+    }
+    float n   = trendCount;
+    float den = n * sxx - sx * sx;
+    if (den == 0) return 0;
+    float perPoint = (n * sxy - sx * sy) / den;
+    return (int16_t)(perPoint * (3600000.0f / HEAP_TREND_SAMPLE_MS));
+}
+
+static void charge(HeapTag tag, int32_t bytes) {
+    HeapTagStats& t = tags[(uint8_t)tag];
+    portENTER_CRITICAL(&heapMux);
+    if (bytes > 0) {
+        t.allocs++;
+        t.allocBytes += bytes;
+    }
+    t.liveBytes += bytes;
+    if (t.liveBytes < 0) t.liveBytes = 0;   // scopes can free what predates them
+    if (t.liveBytes > t.peakBytes) t.peakBytes = t.liveBytes;
+    portEXIT_CRITICAL(&heapMux);
+}
+
+// ========== IMPLEMENTATION ==========
+void HeapMonitor::update() {
+    uint32_t now = millis();
+    if (now - lastCheckMs < HEAP_CHECK_MS) return;
+    lastCheckMs = now;
+
+    freeBytes    = ESP.getFreeHeap();
+    largestBlock = ESP.getMaxAllocHeap();
+    fragPermille = freeBytes ? (uint16_t)(1000 - (uint64_t)largestBlock * 1000 / freeBytes) : 0;
+
+    HeapLevel next = classify(freeBytes, largestBlock, currentLevel);
+    if (next != currentLevel) {
+        LOGW("[HEAP] Level %s -> %s (free %lu, largest block %lu)\n",
+             LEVEL_NAMES[(uint8_t)currentLevel], LEVEL_NAMES[(uint8_t)next],
+             (unsigned long)freeBytes, (unsigned long)largestBlock);
+        currentLevel = next;
+        levelChanges++;
+    }
+
+    if (now - lastTrendMs >= HEAP_TREND_SAMPLE_MS) {
+        lastTrendMs = now;
+        trend[trendHead] = fragPermille;
+        trendHead = (trendHead + 1) % HEAP_TREND_POINTS;
+        if (trendCount < HEAP_TREND_POINTS) trendCount++;
+
+        portENTER_CRITICAL(&heapMux);
+        for (uint8_t i = 0; i < (uint8_t)HeapTag::COUNT; i++) {
+            tags[i].bytesPerMin = tags[i].allocBytes - prevAllocBytes[i];
+            prevAllocBytes[i]   = tags[i].allocBytes;
+        }
+        portEXIT_CRITICAL(&heapMux);
+    }
+}
+
+HeapLevel HeapMonitor::level() {
+    return currentLevel;
+}
+
+HeapSnapshot HeapMonitor::snapshot() {
+    HeapSnapshot s;
+    s.level            = currentLevel;
+    s.freeBytes        = freeBytes;
+    s.largestBlock     = largestBlock;
+    s.fragPermille     = fragPermille;
+    s.fragTrendPerHour = trendPerHour();
+    s.levelChanges     = levelChanges;
+    portENTER_CRITICAL(&heapMux);
+    memcpy(s.tags, tags, sizeof(tags));
+    portEXIT_CRITICAL(&heapMux);
+    return s;
+}
+
+const char* HeapMonitor::tagName(HeapTag tag) {
+    return TAG_NAMES[(uint8_t)tag];
+}
+
+const char* HeapMonitor::levelName(HeapLevel level) {
+    return LEVEL_NAMES[(uint8_t)level];
+}
+
+uint16_t HeapMonitor::scaleBatch(uint16_t full) {
+    switch (currentLevel) {
+        case HeapLevel::CRIT: return 0;
+        case HeapLevel::WARN: return full >= 4 ? full / 4 : 1;
+        default:              return full;
+    }
+}
+
+void HeapMonitor::noteAlloc(HeapTag tag, size_t bytes) {
+    charge(tag, (int32_t)bytes);
+}
+
+void HeapMonitor::noteFree(HeapTag tag, size_t bytes) {
+    charge(tag, -(int32_t)bytes);
+}
+
+// ========== SCOPE ==========
+// Outermost open scope of the running task; inner scopes forward to it.
+// Per task, not per core: Core 1's pipeline tasks preempt each other, so
+// a per-core slot would let one task's scope swallow another's.
+static thread_local HeapMonitor::Scope* outerScope = nullptr;
+
+HeapMonitor::Scope::Scope(HeapTag t)
+    : tag(t), freeAtEntry(ESP.getFreeHeap()) {
+    if (!outerScope) outerScope = this;
+}
+
+HeapMonitor::Scope::~Scope() {
+    if (outerScope != this) return;
+    outerScope = nullptr;
+    int32_t retained = (int32_t)freeAtEntry - (int32_t)ESP.getFreeHeap();
+    charge(tag, retained);
+}
+
+void HeapMonitor::checkpoint() {
+    if (outerScope) outerScope->checkpoint();
+}
+
+void HeapMonitor::Scope::checkpoint() {
+    const Scope* o = outerScope ? outerScope : this;
+    int32_t inFlight = (int32_t)o->freeAtEntry - (int32_t)ESP.getFreeHeap();
+    if (inFlight <= 0) return;
+    HeapTagStats& t = tags[(uint8_t)o->tag];
+    portENTER_CRITICAL(&heapMux);
+    if (t.liveBytes + inFlight > t.peakBytes) t.peakBytes = t.liveBytes + inFlight;
+    portEXIT_CRITICAL(&heapMux);
+}
+
+// ========== JSON ALLOCATOR ==========
+// Each block carries its size in front so frees can be charged back
+static const size_t JSON_HEADER = 8;
+
+void* TrackedJsonAllocator::allocate(size_t size) {
+    uint8_t* p = (uint8_t*)malloc(size + JSON_HEADER);
+    if (!p) return nullptr;
+    *(size_t*)p = size;
+    HeapMonitor::noteAlloc(HeapTag::JSON, size);
+    return p + JSON_HEADER;
+}
+
+void TrackedJsonAllocator::deallocate(void* ptr) {
+    if (!ptr) return;
+    uint8_t* p = (uint8_t*)ptr - JSON_HEADER;
+    HeapMonitor::noteFree(HeapTag::JSON, *(size_t*)p);
+    free(p);
+}
+
+void* TrackedJsonAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) return allocate(newSize);
+    uint8_t* p      = (uint8_t*)ptr - JSON_HEADER;
+    size_t   old    = *(size_t*)p;
+    uint8_t* grown  = (uint8_t*)realloc(p, newSize + JSON_HEADER);
+    if (!grown) return nullptr;
+    *(size_t*)grown = newSize;
+    HeapMonitor::noteFree(HeapTag::JSON, old);
+    HeapMonitor::noteAlloc(HeapTag::JSON, newSize);
+    return grown + JSON_HEADER;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/config.h"
+
+// ========== HEAP MONITOR ==========
+// Who holds the heap, and what to do when it runs low.
+//
+// Per-subsystem accounting comes from two sources:
+//   - TrackedJsonDocument: an ArduinoJson allocator that counts exactly
+//   - HeapMonitor::Scope: free-heap difference across a call (and at
+//     checkpoints inside it). Bytes a scope leaves behind accumulate as
+//     live; a steadily growing figure is a leak in that subsystem. Scopes
+//     nest per task and only the outermost one charges, so wrap a whole
+//     unit of work (request + parse), not just the part that allocates.
+//     Free heap is global, so anything another task allocates or frees
+//     meanwhile lands in the delta: scoped figures are approximate.
+//     Only the allocator's are exact.
+//
+// update() classifies the heap as NORMAL / WARN / CRIT against
+// HEAP_WARN_LEVEL / HEAP_CRIT_LEVEL (with hysteresis). Cloud work sheds
+// load on that level: smaller batches at WARN; no health pushes or
+// uploads at CRIT.
+
+enum class HeapTag : uint8_t {
+    CLOUD_HTTP,
+    JSON,
+    LOGGING,
+    ACCESS,
+    COUNT
+};
+
+enum class HeapLevel : uint8_t {
+    NORMAL,
+    WARN,
+    CRIT
+};
+
+struct HeapTagStats {
+    int32_t  liveBytes;       // held now (JSON) / retained by scopes
+    int32_t  peakBytes;       // highest live, including in-flight scopes
+    uint32_t allocs;
+    uint32_t allocBytes;
+    uint32_t bytesPerMin;     // allocation rate over the last minute
+};
+
+struct HeapSnapshot {
+    HeapLevel    level;
+    uint32_t     freeBytes;
+    uint32_t     largestBlock;
+    uint16_t     fragPermille;          // 1 - largest / free
+    int16_t      fragTrendPerHour;      // permille per hour, least squares
+    uint32_t     levelChanges;
+    HeapTagStats tags[(uint8_t)HeapTag::COUNT];
+};
+
+class HeapMonitor {
+public:
+    static void update();                   // Core 0 loop
+
+    static HeapLevel level();
+    static HeapSnapshot snapshot();
+    static const char* tagName(HeapTag tag);
+    static const char* levelName(HeapLevel level);
+
+    // Batch size under the current level: full, a quarter at WARN, 0 at CRIT
+    static uint16_t scaleBatch(uint16_t full);
+
+    static void noteAlloc(HeapTag tag, size_t bytes);
+    static void noteFree(HeapTag tag, size_t bytes);
+
+    // Scope::checkpoint() on the calling task's open scope, if any
+    static void checkpoint();
+
+    class Scope {
+    public:
+        explicit Scope(HeapTag tag);
+        ~Scope();
+        void checkpoint();                  // sample in-flight usage (e.g. TLS open)
+    private:
+        HeapTag  tag;
+        uint32_t freeAtEntry;
+    };
+};
+
+// ArduinoJson allocator that charges HeapTag::JSON
+struct TrackedJsonAllocator {
+    void* allocate(size_t size);
+    void  deallocate(void* ptr);
+    void* reallocate(void* ptr, size_t newSize);
+};
+
+typedef BasicJsonDocument<TrackedJsonAllocator> TrackedJsonDocument;
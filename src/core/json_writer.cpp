@@ -0,0 +1,167 @@
+#include "core/json_writer.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char* buf, size_t size) : buf(buf), size(size) {
+    reset();
+}
+
+void JsonWriter::reset() {
+    len      = 0;
+    overflow = size == 0;
+    depth    = 0;
+    started  = 0;
+    afterKey = false;
+    if (size) buf[0] = '\0';
+}
+
+// ========== OUTPUT ==========
+// Truncates on overflow but always leaves the buffer NUL-terminated
+void JsonWriter::put(const char* s, size_t n) {
+    if (overflow) return;
+    if (len + n >= size) {
+        n = size - 1 - len;
+        overflow = true;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+}
+
+void JsonWriter::put(char c) {
+    put(&c, 1);
+}
+
+// ========== STRUCTURE ==========
+void JsonWriter::value() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (depth == 0) return;
+    uint16_t bit = 1u << depth;
+    if (started & bit) put(',');
+    started |= bit;
+}
+
+void JsonWriter::open(char c) {
+    value();
+    put(c);
+    if (depth + 1 >= MAX_DEPTH) {
+        overflow = true;
+        return;
+    }
+    depth++;
+    uint16_t bit = 1u << depth;
+    started &= ~bit;
+}
+
+void JsonWriter::close(char c) {
+    put(c);
+    if (depth) depth--;
+    afterKey = false;
+}
+
+JsonWriter& JsonWriter::beginObject() { open('{');  return *this; }
+JsonWriter& JsonWriter::endObject()   { close('}'); return *this; }
+JsonWriter& JsonWriter::beginArray()  { open('[');  return *this; }
+JsonWriter& JsonWriter::endArray()    { close(']'); return *this; }
+
+JsonWriter& JsonWriter::key(const char* name) {
+    afterKey = false;
+    value();
+    quoted(name);
+    put(':');
+    afterKey = true;
+    return *this;
+}
+
+// ========== VALUES ==========
+JsonWriter& JsonWriter::string(const char* s) {
+    if (!s) return null();
+    value();
+    quoted(s);
+    return *this;
+}
+
+void JsonWriter::quoted(const char* s) {
+    put('"');
+    const char* run = s;   // unescaped bytes go out in one copy
+    for (; *s; s++) {
+        uint8_t c = (uint8_t)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(run, s - run);
+        char esc[8];
+        switch (c) {
+            case '"':  put("\\\"", 2); break;
+            case '\\': put("\\\\", 2); break;
+            case '\n': put("\\n", 2);  break;
+            case '\r': put("\\r", 2);  break;
+            case '\t': put("\\t", 2);  break;
+            default:
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                put(esc, 6);
+        }
+        run = s + 1;
+    }
+    put(run, s - run);
+    put('"');
+}
+
+size_t JsonWriter::quotedLength(const char* s) {
+    if (!s) return 4;
+    size_t n = 2;
+    for (; *s; s++) {
+        uint8_t c = (uint8_t)*s;
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t') n += 2;
+        else if (c < 0x20) n += 6;
+        else n++;
+    }
+    return n;
+}
+
+JsonWriter& JsonWriter::i32(int32_t v) {
+    return raw("%ld", (long)v);
+}
+
+JsonWriter& JsonWriter::u32(uint32_t v) {
+    return raw("%lu", (unsigned long)v);
+}
+
+// JSON has no NaN / Infinity: "%f" would print them as bare words
+JsonWriter& JsonWriter::f32(float v, uint8_t decimals) {
+    if (!isfinite(v)) return null();
+    return raw("%.*f", decimals, v);
+}
+
+JsonWriter& JsonWriter::boolean(bool v) {
+    value();
+    if (v) put("true", 4);
+    else   put("false", 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    value();
+    put("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(const char* fmt, ...) {
+    value();
+    if (overflow) return *this;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+    if (n < 0) return *this;
+    if ((size_t)n >= size - len) {
+        len = size - 1;
+        overflow = true;
+    } else {
+        len += n;
+    }
+    return *this;
+}
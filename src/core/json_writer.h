@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ========== JSON WRITER ==========
+// Streams JSON into a caller-owned buffer, for request bodies and command
+// results that used to be built by String concatenation. Commas between
+// members and elements are inserted automatically; strings are escaped.
+//
+//   JsonWriter w(buf, sizeof(buf));
+//   w.beginObject().key("status").string("DONE").key("n").u32(3).endObject();
+//   if (!w.ok()) ...   // didn't fit: the text is truncated, still NUL-ended
+//
+// raw() appends pre-formatted JSON as one value, for hot loops that are
+// cheaper as a single printf.
+
+class JsonWriter {
+public:
+    JsonWriter(char* buf, size_t size);   // size includes the terminating NUL
+
+    void reset();
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(const char* name);
+
+    JsonWriter& string(const char* s);    // nullptr -> null
+    JsonWriter& i32(int32_t v);
+    JsonWriter& u32(uint32_t v);
+    JsonWriter& f32(float v, uint8_t decimals);   // NaN / inf -> null
+    JsonWriter& boolean(bool v);
+    JsonWriter& null();
+    JsonWriter& raw(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    const char* c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool   ok() const { return !overflow && depth == 0; }   // complete and untruncated
+    bool   overflowed() const { return overflow; }
+
+    // Bytes string(s) writes, quotes included: sizes a buffer exactly
+    static size_t quotedLength(const char* s);
+
+private:
+    static const uint8_t MAX_DEPTH = 16;
+
+    void value();   // separator before a value
+    void put(char c);
+    void put(const char* s, size_t n);
+    void quoted(const char* s);
+    void open(char c);
+    void close(char c);
+
+    char*    buf;
+    size_t   size;
+    size_t   len;
+    bool     overflow;
+    uint8_t  depth;
+    uint16_t started;    // bit per level: has a member / element
+    bool     afterKey;
+};
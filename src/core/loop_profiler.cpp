@@ -0,0 +1,106 @@
+#include "core/loop_profiler.h"
+#include <Arduino.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// ========== STATE ==========
+struct LoopState {
+    LoopProfile profile;
+    uint32_t    windowStartMs;
+
+    // Current iteration; touched only by the loop's own task
+    uint32_t    iterStartUs;
+    uint32_t    stageStartUs;
+    const char* iterMaxStage;
+    uint32_t    iterMaxStageUs;
+};
+
+static LoopState    loops[(uint8_t)ProfiledLoop::COUNT] = {};
+static portMUX_TYPE profileMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t bucketFor(uint32_t us) {
+    uint8_t b = 0;
+    while (b < LOOP_HIST_BUCKETS - 1 && us >= LOOP_HIST_BOUNDS_US[b]) b++;
+    return b;
+}
+
+// ========== IMPLEMENTATION ==========
+void LoopProfiler::begin(ProfiledLoop loop) {
+    LoopState& s = loops[(uint8_t)loop];
+    uint32_t now = micros();
+    s.iterStartUs    = now;
+    s.stageStartUs   = now;
+    s.iterMaxStage   = nullptr;
+    s.iterMaxStageUs = 0;
+}
+
+void LoopProfiler::mark(ProfiledLoop loop, const char* stage) {
+    LoopState& s = loops[(uint8_t)loop];
+    uint32_t now = micros();
+    uint32_t us  = now - s.stageStartUs;
+    s.stageStartUs = now;
+
+    if (us >= s.iterMaxStageUs) {
+        s.iterMaxStage   = stage;
+        s.iterMaxStageUs = us;
+    }
+
+    portENTER_CRITICAL(&profileMux);
+    LoopProfile& p = s.profile;
+    uint8_t i = 0;
+    while (i < p.stageCount && p.stages[i].name != stage) i++;
+    if (i == p.stageCount && i < LOOP_PROFILE_STAGES) {
+        p.stages[i].name = stage;
+        p.stageCount++;
+    }
+    if (i < p.stageCount) {
+        p.stages[i].totalUs += us;
+        if (us > p.stages[i].maxUs) p.stages[i].maxUs = us;
+    }
+    portEXIT_CRITICAL(&profileMux);
+}
+
+void LoopProfiler::end(ProfiledLoop loop) {
+    LoopState& s = loops[(uint8_t)loop];
+    uint32_t us = micros() - s.iterStartUs;
+
+    portENTER_CRITICAL(&profileMux);
+    LoopProfile& p = s.profile;
+    p.iterations++;
+    p.totalUs += us;
+    p.histogram[bucketFor(us)]++;
+    if (us > p.maxUs) {
+        p.maxUs      = us;
+        p.maxStage   = s.iterMaxStage;
+        p.maxStageUs = s.iterMaxStageUs;
+    }
+    portEXIT_CRITICAL(&profileMux);
+}
+
+LoopProfile LoopProfiler::snapshot(ProfiledLoop loop, bool reset) {
+    LoopState& s = loops[(uint8_t)loop];
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&profileMux);
+    LoopProfile copy = s.profile;
+    if (reset) {
+        // Keep the stage names so their order stays stable across windows
+        LoopProfile& p = s.profile;
+        p.iterations = 0;
+        p.totalUs    = 0;
+        p.maxUs      = 0;
+        p.maxStage   = nullptr;
+        p.maxStageUs = 0;
+        memset(p.histogram, 0, sizeof(p.histogram));
+        for (uint8_t i = 0; i < p.stageCount; i++) {
+            p.stages[i].totalUs = 0;
+            p.stages[i].maxUs   = 0;
+        }
+    }
+    portEXIT_CRITICAL(&profileMux);
+
+    copy.windowMs = now - s.windowStartMs;
+    if (reset) s.windowStartMs = now;
+    return copy;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include "config/config.h"
+
+// ========== LOOP PROFILER ==========
+// Iteration timing for the two long-running loops. Each iteration is cut
+// into named stages by mark(); the profiler keeps a latency histogram of
+// whole iterations, per-stage totals and maxima, and the worst iteration
+// together with the stage that dominated it.
+//
+// Only the working part of an iteration is measured: call end() before
+// the loop's vTaskDelay. Writers and readers may sit on different cores;
+// the shared state is guarded by a spinlock held for a few stores.
+
+enum class ProfiledLoop : uint8_t {
+    ACCESS,    // reader stage of the Core 1 pipeline (access_reader)
+    CLOUD,     // Arduino loop() on Core 0
+    COUNT
+};
+
+// Upper bounds (microseconds) of the histogram buckets; the last bucket
+// is open-ended
+static const uint32_t LOOP_HIST_BOUNDS_US[] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 500000
+};
+static const uint8_t LOOP_HIST_BUCKETS = sizeof(LOOP_HIST_BOUNDS_US) / sizeof(LOOP_HIST_BOUNDS_US[0]) + 1;
+
+struct LoopStageStats {
+    const char* name;          // string literal passed to mark()
+    uint32_t    totalUs;
+    uint32_t    maxUs;
+};
+
+struct LoopProfile {
+    uint32_t       iterations;
+    uint64_t       totalUs;
+    uint32_t       maxUs;                  // worst iteration in the window
+    const char*    maxStage;               // its slowest stage
+    uint32_t       maxStageUs;
+    uint32_t       windowMs;               // time covered by this snapshot
+    uint32_t       histogram[LOOP_HIST_BUCKETS];
+    LoopStageStats stages[LOOP_PROFILE_STAGES];
+    uint8_t        stageCount;
+};
+
+class LoopProfiler {
+public:
+    static void begin(ProfiledLoop loop);
+    static void mark(ProfiledLoop loop, const char* stage);   // closes the stage just run
+    static void end(ProfiledLoop loop);
+
+    // Copy of the current window; reset starts a new one
+    static LoopProfile snapshot(ProfiledLoop loop, bool reset);
+};
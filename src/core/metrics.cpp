@@ -0,0 +1,161 @@
+#include "core/metrics.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+// ========== STATE ==========
+// Constant-initialised, so it is valid before any metric constructor runs
+static Metric*      head        = nullptr;
+static Metric*      tail        = nullptr;
+static uint16_t     metricCount = 0;
+static portMUX_TYPE histMux     = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const TYPE_NAMES[] = { "counter", "gauge", "histogram" };
+
+// ========== REGISTRATION ==========
+// Appended in construction order; static constructors run before setup()
+Metric::Metric(MetricType t, const char* n, const char* h, const char* l)
+    : name(n), help(h), labels(l && l[0] ? l : nullptr), type(t), next(nullptr) {
+    if (tail) tail->next = this;
+    else      head = this;
+    tail = this;
+    metricCount++;
+}
+
+Counter::Counter(const char* n, const char* h, const char* l)
+    : Metric(MetricType::COUNTER, n, h, l), count(0) {}
+
+Gauge::Gauge(const char* n, const char* h, const char* l)
+    : Metric(MetricType::GAUGE, n, h, l), current(0) {}
+
+Histogram::Histogram(const char* n, const char* h,
+                     const uint32_t* b, uint8_t bc, float upb, const char* l)
+    : Metric(MetricType::HISTOGRAM, n, h, l),
+      bounds(b),
+      boundCount(bc > METRICS_HIST_MAX_BOUNDS ? METRICS_HIST_MAX_BOUNDS : bc),
+      unitsPerBase(upb > 0 ? upb : 1.0f),
+      buckets(), sum(0), count(0) {}
+
+void Histogram::observe(uint32_t v) {
+    uint8_t i = 0;
+    while (i < boundCount && v > bounds[i]) i++;
+
+    portENTER_CRITICAL(&histMux);
+    buckets[i]++;
+    sum += v;
+    count++;
+    portEXIT_CRITICAL(&histMux);
+}
+
+// ========== RENDER ==========
+static char        chunk[METRICS_RENDER_CHUNK];
+static size_t      chunkLen = 0;
+static MetricsSink sinkFn   = nullptr;
+static void*       sinkCtx  = nullptr;
+
+static void flushChunk() {
+    if (chunkLen) sinkFn(chunk, chunkLen, sinkCtx);
+    chunkLen = 0;
+}
+
+// One line at a time; a line never straddles two chunks
+static void emit(const char* fmt, ...) {
+    char line[192];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+
+    if (chunkLen + n > sizeof(chunk)) flushChunk();
+    memcpy(chunk + chunkLen, line, n);
+    chunkLen += n;
+}
+
+// "{a="b"}", "{a="b",le="0.5"}", "{le="0.5"}" or ""
+static void labelSet(char* out, size_t size, const char* labels, const char* le) {
+    if (!labels && !le) {
+        out[0] = '\0';
+        return;
+    }
+    snprintf(out, size, "{%s%s%s%s%s}",
+             labels ? labels : "",
+             labels && le ? "," : "",
+             le ? "le=\"" : "", le ? le : "", le ? "\"" : "");
+}
+
+void Metrics::renderSample(const Metric* m) {
+    char set[96];
+
+    switch (m->type) {
+        case MetricType::COUNTER:
+            labelSet(set, sizeof(set), m->labels, nullptr);
+            emit("%s%s %lu\n", m->name, set,
+                 (unsigned long)static_cast<const Counter*>(m)->value());
+            break;
+
+        case MetricType::GAUGE:
+            labelSet(set, sizeof(set), m->labels, nullptr);
+            emit("%s%s %ld\n", m->name, set,
+                 (long)static_cast<const Gauge*>(m)->value());
+            break;
+
+        case MetricType::HISTOGRAM: {
+            const Histogram* h = static_cast<const Histogram*>(m);
+            uint32_t buckets[METRICS_HIST_MAX_BOUNDS + 1];
+            uint64_t sum;
+            uint32_t count;
+            portENTER_CRITICAL(&histMux);
+            memcpy(buckets, h->buckets, sizeof(buckets));
+            sum   = h->sum;
+            count = h->count;
+            portEXIT_CRITICAL(&histMux);
+
+            char le[16];
+            uint32_t cumulative = 0;
+            for (uint8_t i = 0; i < h->boundCount; i++) {
+                cumulative += buckets[i];
+                snprintf(le, sizeof(le), "%g", h->bounds[i] / h->unitsPerBase);
+                labelSet(set, sizeof(set), h->labels, le);
+                emit("%s_bucket%s %lu\n", h->name, set, (unsigned long)cumulative);
+            }
+            labelSet(set, sizeof(set), h->labels, "+Inf");
+            emit("%s_bucket%s %lu\n", h->name, set, (unsigned long)count);
+
+            labelSet(set, sizeof(set), h->labels, nullptr);
+            emit("%s_sum%s %g\n", h->name, set, (double)(sum / h->unitsPerBase));
+            emit("%s_count%s %lu\n", h->name, set, (unsigned long)count);
+            break;
+        }
+    }
+}
+
+bool Metrics::renderedBefore(const Metric* m) {
+    for (const Metric* p = head; p != m; p = p->next) {
+        if (strcmp(p->name, m->name) == 0) return true;
+    }
+    return false;
+}
+
+void Metrics::render(MetricsSink sink, void* ctx) {
+    sinkFn   = sink;
+    sinkCtx  = ctx;
+    chunkLen = 0;
+
+    // A family is every metric with the same name, wherever it registered
+    for (Metric* m = head; m; m = m->next) {
+        if (renderedBefore(m)) continue;
+        emit("# HELP %s %s\n", m->name, m->help);
+        emit("# TYPE %s %s\n", m->name, TYPE_NAMES[(uint8_t)m->type]);
+        for (Metric* s = m; s; s = s->next) {
+            if (s == m || strcmp(s->name, m->name) == 0) renderSample(s);
+        }
+    }
+    flushChunk();
+}
+
+uint16_t Metrics::count() {
+    return metricCount;
+}
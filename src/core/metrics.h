@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config/config.h"
+
+// ========== METRICS REGISTRY ==========
+// Counters, gauges and fixed-bucket histograms for local scraping (see
+// MetricsServer). A metric is a static object in the module it measures;
+// its constructor links it into the registry, so updates never allocate:
+//
+//   static Counter taps("emlock_rfid_taps_total", "Card taps", "result=\"granted\"");
+//   taps.inc();
+//
+// Metrics sharing a name (differing only in labels) form one family and
+// are rendered together. Names, help and labels must be string literals.
+// Counters and gauges are single atomic words and can be updated from
+// either core; histograms take a short spinlock.
+
+enum class MetricType : uint8_t {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+class Metric {
+public:
+    const char* const name;
+    const char* const help;
+    const char* const labels;   // e.g. "result=\"granted\"", or nullptr
+    const MetricType  type;
+
+protected:
+    Metric(MetricType type, const char* name, const char* help, const char* labels);
+
+private:
+    Metric* next;
+    friend class Metrics;
+};
+
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* help, const char* labels = nullptr);
+    void inc(uint32_t n = 1) { __atomic_fetch_add(&count, n, __ATOMIC_RELAXED); }
+    uint32_t value() const   { return __atomic_load_n(&count, __ATOMIC_RELAXED); }
+
+private:
+    uint32_t count;
+};
+
+class Gauge : public Metric {
+public:
+    Gauge(const char* name, const char* help, const char* labels = nullptr);
+    void set(int32_t v)  { __atomic_store_n(&current, v, __ATOMIC_RELAXED); }
+    void add(int32_t d)  { __atomic_fetch_add(&current, d, __ATOMIC_RELAXED); }
+    int32_t value() const { return __atomic_load_n(&current, __ATOMIC_RELAXED); }
+
+private:
+    int32_t current;
+};
+
+// Observations are integers (e.g. microseconds); `unitsPerBase` converts
+// them to the metric's base unit when rendered (1000000 for *_seconds).
+// `bounds` are ascending bucket upper limits, at most
+// METRICS_HIST_MAX_BOUNDS; +Inf is implied.
+class Histogram : public Metric {
+public:
+    Histogram(const char* name, const char* help,
+              const uint32_t* bounds, uint8_t boundCount,
+              float unitsPerBase = 1.0f, const char* labels = nullptr);
+    void observe(uint32_t v);
+
+private:
+    const uint32_t* bounds;
+    uint8_t         boundCount;
+    float           unitsPerBase;
+    uint32_t        buckets[METRICS_HIST_MAX_BOUNDS + 1];   // not cumulative
+    uint64_t        sum;
+    uint32_t        count;
+    friend class Metrics;
+};
+
+// Receives rendered text in chunks of up to METRICS_RENDER_CHUNK bytes
+typedef void (*MetricsSink)(const char* text, size_t len, void* ctx);
+
+class Metrics {
+public:
+    // Prometheus text exposition format (version 0.0.4). One caller at a
+    // time: the chunk buffer is static.
+    static void render(MetricsSink sink, void* ctx);
+    static uint16_t count();
+
+private:
+    static void renderSample(const Metric* m);
+    static bool renderedBefore(const Metric* m);
+};
@@ -0,0 +1,55 @@
+#include "core/stage_queue.h"
+
+StageQueue::StageQueue(const char* labels, uint8_t length, size_t itemSize)
+    : handle(nullptr),
+      length(length),
+      itemSize(itemSize),
+      peak(0),
+      depthGauge("emlock_pipeline_queue_depth", "Items waiting between pipeline stages", labels),
+      peakGauge("emlock_pipeline_queue_peak", "Highest queue depth since boot", labels),
+      sentTotal("emlock_pipeline_queue_sent_total", "Items handed to the next stage", labels),
+      droppedTotal("emlock_pipeline_queue_dropped_total", "Items dropped on a full queue", labels) {}
+
+void StageQueue::init() {
+    if (handle == nullptr) {
+        handle = xQueueCreate(length, itemSize);
+    }
+}
+
+bool StageQueue::send(const void* item) {
+    if (!handle) return false;
+    if (xQueueSend(handle, item, 0) != pdTRUE) {
+        droppedTotal.inc();
+        return false;
+    }
+    sentTotal.inc();
+    noteDepth();
+    return true;
+}
+
+bool StageQueue::receive(void* item, TickType_t wait) {
+    if (!handle) return false;
+    if (xQueueReceive(handle, item, wait) != pdTRUE) return false;
+    noteDepth();
+    return true;
+}
+
+StageQueueStats StageQueue::stats() const {
+    StageQueueStats s = {};
+    s.length  = length;
+    s.depth   = handle ? (uint8_t)uxQueueMessagesWaiting(handle) : 0;
+    s.peak    = peak;
+    s.sent    = sentTotal.value();
+    s.dropped = droppedTotal.value();
+    return s;
+}
+
+// Both ends update the gauge; whichever runs last leaves the true depth
+void StageQueue::noteDepth() {
+    uint8_t depth = (uint8_t)uxQueueMessagesWaiting(handle);
+    depthGauge.set(depth);
+    if (depth > peak) {
+        peak = depth;   // racy max between the two ends: off by one at worst
+        peakGauge.set(depth);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "core/metrics.h"
+
+// ========== STAGE QUEUE ==========
+// Bounded hand-off between two stages of the Core 1 access pipeline
+// (reader -> decision -> actuator, see main.cpp). Senders never block:
+// when the queue is full the item is dropped and counted, so a stalled
+// stage sheds load instead of stalling the one feeding it. Depth, peak
+// depth and drops are exported per queue:
+//
+//   emlock_pipeline_queue_depth{queue="tap"}
+//   emlock_pipeline_queue_peak{queue="tap"}
+//   emlock_pipeline_queue_dropped_total{queue="tap"}
+//
+// Instances are static objects, like the metrics they own; `labels` must
+// be a string literal.
+
+struct StageQueueStats {
+    uint8_t  length;
+    uint8_t  depth;
+    uint8_t  peak;      // highest depth since boot
+    uint32_t sent;
+    uint32_t dropped;   // queue full
+};
+
+class StageQueue {
+public:
+    StageQueue(const char* labels, uint8_t length, size_t itemSize);
+
+    void init();   // creates the FreeRTOS queue; once, before either stage runs
+    bool ready() const { return handle != nullptr; }
+
+    bool send(const void* item);
+    bool receive(void* item, TickType_t wait);   // false on timeout
+
+    StageQueueStats stats() const;
+
+private:
+    void noteDepth();
+
+    QueueHandle_t handle;
+    const uint8_t length;
+    const size_t  itemSize;
+    uint8_t       peak;
+    Gauge         depthGauge;
+    Gauge         peakGauge;
+    Counter       sentTotal;
+    Counter       droppedTotal;
+};
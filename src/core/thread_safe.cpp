@@ -1,5 +1,9 @@
 #include "thread_safe.h"
 #include <Arduino.h>
+#include "trace.h"
+#include "console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_CORE
 
 SemaphoreHandle_t ThreadSafe::mutex = nullptr;
 
@@ -7,21 +11,24 @@ void ThreadSafe::init() {
     if (mutex == nullptr) {
         mutex = xSemaphoreCreateMutex();
         if (mutex != nullptr) {
-            Serial.println("[THREAD] Mutex initialized");
+            LOGI("[THREAD] Mutex initialized\n");
         } else {
-            Serial.println("[THREAD] ERROR: Failed to create mutex!");
+            LOGE("[THREAD] ERROR: Failed to create mutex!\n");
         }
     }
 }
 
 bool ThreadSafe::lock(uint32_t timeoutMs) {
     if (mutex == nullptr) {
-        Serial.println("[THREAD] WARNING: Mutex not initialized, skipping lock");
+        LOGW("[THREAD] WARNING: Mutex not initialized, skipping lock\n");
         return false;
     }
     
     TickType_t ticks = (timeoutMs == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
-    return xSemaphoreTake(mutex, ticks) == pdTRUE;
+    uint32_t t0 = micros();
+    bool acquired = xSemaphoreTake(mutex, ticks) == pdTRUE;
+    Trace::record(TraceEvent::MUTEX_WAIT, t0, acquired);
+    return acquired;
 }
 
 void ThreadSafe::unlock() {
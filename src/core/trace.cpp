@@ -0,0 +1,121 @@
+#include "core/trace.h"
+
+#if TRACE_ENABLED
+
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+static_assert(sizeof(TraceRecord) == 12, "TraceRecord layout is part of the dump format");
+static_assert(sizeof(TraceDumpHeader) == 28, "TraceDumpHeader layout is part of the dump format");
+
+// ========== STATE ==========
+// head counts every reservation ever made; slot = head % TRACE_RING_RECORDS
+struct CoreRing {
+    TraceRecord records[TRACE_RING_RECORDS];
+    uint32_t    head;
+    uint32_t    pausedDrops;
+};
+
+static CoreRing rings[2] = {};
+static bool     paused   = false;
+
+static inline CoreRing& ringForThisCore() {
+    return rings[xPortGetCoreID() ? 1 : 0];
+}
+
+// ========== RECORDING ==========
+void Trace::record(TraceEvent event, uint32_t startUs, int16_t arg) {
+    uint32_t now = micros();
+    CoreRing& r = ringForThisCore();
+    if (__atomic_load_n(&paused, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&r.pausedDrops, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint32_t slot = __atomic_fetch_add(&r.head, 1, __ATOMIC_RELAXED) % TRACE_RING_RECORDS;
+    TraceRecord& rec = r.records[slot];
+    rec.startUs = startUs;
+    rec.durUs   = now - startUs;
+    rec.event   = (uint8_t)event;
+    rec.flags   = 0;
+    rec.arg     = arg;
+}
+
+// ========== DUMP ==========
+size_t Trace::dump(Sink sink, void* ctx) {
+    __atomic_store_n(&paused, true, __ATOMIC_RELEASE);
+    delayMicroseconds(50);   // let a writer already past the check finish its slot
+
+    TraceDumpHeader hdr = {};
+    hdr.magic      = TRACE_MAGIC;
+    hdr.version    = TRACE_VERSION;
+    hdr.recordSize = sizeof(TraceRecord);
+    hdr.dumpUs     = micros();
+    time_t now     = time(nullptr);
+    hdr.dumpEpoch  = now > 1700000000 ? (uint32_t)now : 0;
+
+    uint32_t heads[2];
+    for (uint8_t c = 0; c < 2; c++) {
+        heads[c]       = rings[c].head;
+        hdr.count[c]   = heads[c] < TRACE_RING_RECORDS ? heads[c] : TRACE_RING_RECORDS;
+        hdr.dropped[c] = (heads[c] - hdr.count[c]) + rings[c].pausedDrops;
+    }
+    sink((const uint8_t*)&hdr, sizeof(hdr), ctx);
+    size_t total = sizeof(hdr);
+
+    // Oldest first: the ring may be split at the wrap point
+    for (uint8_t c = 0; c < 2; c++) {
+        uint32_t start = (heads[c] - hdr.count[c]) % TRACE_RING_RECORDS;
+        uint32_t first = min((uint32_t)hdr.count[c], TRACE_RING_RECORDS - start);
+        sink((const uint8_t*)&rings[c].records[start], first * sizeof(TraceRecord), ctx);
+        if (hdr.count[c] > first) {
+            sink((const uint8_t*)&rings[c].records[0], (hdr.count[c] - first) * sizeof(TraceRecord), ctx);
+        }
+        total += hdr.count[c] * sizeof(TraceRecord);
+    }
+
+    __atomic_store_n(&paused, false, __ATOMIC_RELEASE);
+    return total;
+}
+
+// ========== SERIAL ==========
+// 57 input bytes -> one 76-character base64 line
+static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static uint8_t lineIn[57];
+static uint8_t lineLen = 0;
+
+static void flushLine() {
+    if (lineLen == 0) return;
+    char out[77];
+    uint8_t o = 0;
+    for (uint8_t i = 0; i < lineLen; i += 3) {
+        uint32_t v = lineIn[i] << 16;
+        if (i + 1 < lineLen) v |= lineIn[i + 1] << 8;
+        if (i + 2 < lineLen) v |= lineIn[i + 2];
+        out[o++] = B64[(v >> 18) & 63];
+        out[o++] = B64[(v >> 12) & 63];
+        out[o++] = i + 1 < lineLen ? B64[(v >> 6) & 63] : '=';
+        out[o++] = i + 2 < lineLen ? B64[v & 63] : '=';
+    }
+    out[o] = '\0';
+    Serial.println(out);
+    lineLen = 0;
+}
+
+static void serialSink(const uint8_t* data, size_t len, void*) {
+    while (len--) {
+        lineIn[lineLen++] = *data++;
+        if (lineLen == sizeof(lineIn)) flushLine();
+    }
+}
+
+void Trace::dumpSerial() {
+    Serial.println("[TRACE] BEGIN");
+    lineLen = 0;
+    size_t bytes = dump(serialSink, nullptr);
+    flushLine();
+    Serial.printf("[TRACE] END %u bytes\n", (unsigned)bytes);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config/config.h"
+#include "core/trace_format.h"
+
+// ========== TRACE ==========
+// Binary timeline of what each core was doing: SPI transactions, mutex
+// waits, queue operations, HTTP requests and flash writes. Each core has
+// its own ring of TRACE_RING_RECORDS fixed-size records; writers reserve
+// a slot with one atomic add, so recording never blocks and never
+// allocates. A span is written once, when it ends, as (start, duration):
+//
+//   uint32_t t0 = micros();
+//   int code = http.POST(body);
+//   Trace::record(TraceEvent::HTTP_LOG_SYNC, t0, code);
+//
+// so tasks sharing a core cannot leave unmatched begin/end events.
+//
+// dump() streams the rings out in the trace_format.h layout (over serial
+// with the 'T' key, or GET /trace on the metrics server);
+// tools/trace_convert turns that into Chrome trace / Perfetto JSON.
+
+#if TRACE_ENABLED
+
+class Trace {
+public:
+    // Span from startUs (micros()) to now
+    static void record(TraceEvent event, uint32_t startUs, int16_t arg = 0);
+
+    // Header plus both rings. Recording is paused meanwhile; events that
+    // arrive during the dump are counted as dropped.
+    typedef void (*Sink)(const uint8_t* data, size_t len, void* ctx);
+    static size_t dump(Sink sink, void* ctx);
+    static void dumpSerial();   // base64 between [TRACE] BEGIN / END lines
+};
+
+#else
+
+class Trace {
+public:
+    static void record(TraceEvent, uint32_t, int16_t = 0) {}
+    typedef void (*Sink)(const uint8_t* data, size_t len, void* ctx);
+    static size_t dump(Sink, void*) { return 0; }
+    static void dumpSerial() {}
+};
+
+#endif
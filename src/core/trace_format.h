@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// ========== TRACE DUMP FORMAT ==========
+// Shared by the firmware (Trace) and tools/trace_convert. A dump is a
+// TraceDumpHeader followed by core 0's records, oldest first, then core
+// 1's. All fields little-endian (native on both sides).
+
+static const uint32_t TRACE_MAGIC   = 0x31525445;   // "ETR1"
+static const uint16_t TRACE_VERSION = 1;
+
+enum class TraceEvent : uint8_t {
+    SPI_READ,        // PN532 passive target poll; arg = card seen
+    SPI_CHECK,       // PN532 firmware version probe; arg = ok
+    DECISION,        // AccessDecision::evaluate; arg = AccessResult
+    MUTEX_WAIT,      // ThreadSafe::lock; arg = acquired
+    QUEUE_SEND,      // EventQueue::send; arg = EventType, -1 if the queue was full
+    QUEUE_RECV,      // Event from EventQueue::send to the actuator taking it; arg = EventType
+    HTTP_LOG_SYNC,   // HTTP spans: arg = status code (negative = client error)
+    HTTP_HEALTH,
+    HTTP_HISTORY,
+    HTTP_CMD_POLL,
+    HTTP_CMD_ACK,
+    FLASH_LOG,       // LogStore batch write + flush; arg = bytes
+    FLASH_SPILL,     // HealthHistory spill; arg = samples
+    HTTP_PENDING_PUSH,   // PendingPush batch; arg = status code
+    COUNT
+};
+
+// Name and category shown on the timeline, indexed by TraceEvent
+static const char* const TRACE_EVENT_NAMES[][2] = {
+    { "PN532 read",       "spi"   },
+    { "PN532 check",      "spi"   },
+    { "Access decision",  "access"},
+    { "Mutex wait",       "mutex" },
+    { "Queue send",       "queue" },
+    { "Queue receive",    "queue" },
+    { "HTTP log sync",    "http"  },
+    { "HTTP health",      "http"  },
+    { "HTTP history",     "http"  },
+    { "HTTP command poll","http"  },
+    { "HTTP command ack", "http"  },
+    { "Flash log write",  "flash" },
+    { "Flash spill",      "flash" },
+    { "HTTP pending push","http"  },
+};
+
+struct TraceRecord {
+    uint32_t startUs;    // micros() at span start
+    uint32_t durUs;
+    uint8_t  event;      // TraceEvent
+    uint8_t  flags;      // reserved
+    int16_t  arg;
+};
+
+struct TraceDumpHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;     // sizeof(TraceRecord)
+    uint32_t dumpUs;         // micros() when the dump started
+    uint32_t dumpEpoch;      // wall clock at dumpUs, 0 if not synced
+    uint16_t count[2];       // records per core
+    uint32_t dropped[2];     // overwritten or recorded while dumping
+};
@@ -8,6 +8,12 @@
 #include "core/event_types.h"
 #include "core/event_queue.h"
 #include "core/thread_safe.h"
+#include "core/loop_profiler.h"
+#include "core/heap_monitor.h"
+#include "core/cloud_arena.h"
+#include "core/trace.h"
+#include "core/console_log.h"
+#include "core/boot_profile.h"
 
 // ===== ACCESS =====
 #include "access/rfid_manager.h"
@@ -25,125 +31,181 @@
 
 #include "cloud/wifi_manager.h"
 #include "cloud/command_processor.h"
+#include "cloud/pending_push.h"
 #include "cloud/health_monitor.h"
+#include "cloud/metrics_server.h"
 #include <WiFi.h>
 // =====================================================
-// CORE 1 TASK
+// CORE 1 PIPELINE
 // =====================================================
-void core1_access_task(void* param) {
-    Serial.println("[CORE1] Access task starting");
+// Three stages joined by bounded queues (PIPELINE_* in config.h):
+//   reader   - owns the SPI bus and exit sensors; taps -> tap queue
+//   decision - owns credential lookups (NVS) and the access log (LittleFS)
+//   actuator - owns relays and buzzer; highest priority, so it preempts
+//              the other two the moment an event is queued
+// A slow PN532 transaction or flash flush stalls only its own stage.
+
+static void actuator_task(void* param) {
+    Event evt;
+    while (true) {
+        // Blocks until an event; the timeout keeps the relay mirror current
+        if (EventQueue::receive(evt, pdMS_TO_TICKS(PIPELINE_TICK_MS))) {
+            HeapMonitor::Scope heap(HeapTag::ACCESS);
+            AccessController::handleEvent(evt);
+        }
+        AccessController::update();
+    }
+}
 
-    // --- INIT MODULES (ONCE) ---
-    RFIDManager::init(PN532_SS_PIN, PN532_RST_PIN);   // PN532 over SPI
-    AccessController::init();
+static void decision_task(void* param) {
+    while (true) {
+        {
+            HeapMonitor::Scope heap(HeapTag::ACCESS);
+            RFIDManager::decideNext(pdMS_TO_TICKS(PIPELINE_TICK_MS));
+        }
+        {
+            HeapMonitor::Scope heap(HeapTag::LOGGING);
+            AccessController::writeJournal();
+        }
+    }
+}
+
+static void reader_task(void* param) {
+    Serial.println("[CORE1] Reader stage starting");
+
+    RFIDManager::init();   // PN532s over SPI (RFID_READER_* in config.h)
+    BootProfile::mark(BootPhase::RFID_READY);
 
-    Serial.println("[CORE1] Access system initialized");
+    // Nothing to decide before the tap queue exists
+    xTaskCreatePinnedToCore(decision_task, "access_decide", PIPELINE_DECISION_STACK,
+                            nullptr, PIPELINE_DECISION_PRIO, nullptr, 1);
 
-    static bool exitSimLatch = false;
-    static uint32_t exitSimLatchTime = 0;
-    const uint32_t EXIT_SIM_LATCH_MS = 300;
+    Serial.println("[CORE1] Access pipeline running");
 
     while (true) {
+        LoopProfiler::begin(ProfiledLoop::ACCESS);
 
         // Poll exit sensor (physical)
         ExitSensor::poll();
+        LoopProfiler::mark(ProfiledLoop::ACCESS, "ExitSensor::poll");
 
-        // 1️⃣ Poll RFID hardware
+        // Poll RFID hardware; taps go to the decision stage
         RFIDManager::poll();
+        BootProfile::mark(BootPhase::FIRST_POLL);
+        LoopProfiler::mark(ProfiledLoop::ACCESS, "RFIDManager::poll");
 
-        // 2️⃣ Handle unified events
-        Event evt;
-        if (EventQueue::receive(evt)) {
-            AccessController::handleEvent(evt);
-        }
-
-        // 3️⃣ Update access controller (timers / cooldown)
-        AccessController::update();
-
-        // (No keyboard simulation) - physical exit sensor now used
-
-        vTaskDelay(5 / portTICK_PERIOD_MS);
-
-
-
+        LoopProfiler::end(ProfiledLoop::ACCESS);
+        vTaskDelay(PIPELINE_READER_PERIOD_MS / portTICK_PERIOD_MS);
     }
 }
 // =====================================================
 // SETUP
 // =====================================================
+// Only what the door needs: the access task is running before LittleFS,
+// WiFi or the cloud are touched. Those follow in startDeferred().
 void setup() {
+    BootProfile::mark(BootPhase::SETUP);
     Serial.begin(115200);
-    delay(500);
+    ConsoleLog::begin();   // LOGx() output is queued from here on
 
     Serial.println("\n[BOOT] System starting");
     
     // CRITICAL: Initialize thread safety mutex FIRST before any shared resources
     ThreadSafe::init();
     
-    RelayController::init();
+    RelayController::init();   // doors locked before anything else runs
     NVSStore::init();
-    Serial.print("[HEAP] Free heap: ");
-    Serial.println(ESP.getFreeHeap());
     
     // --- INIT SHARED SYSTEMS ---
     EventQueue::init();
+    PendingPush::init();   // decision stage -> cloud hand-off
     BuzzerManager::init();
-    LogStore::init();
-    
-    // Initialize WiFi AFTER shared resources are protected
-    WiFiManager::init();
     
     // Init exit sensor (physical) after event queue
-    ExitSensor::init(EXIT_SENSOR_PIN);
-
-    LogSync::init();
-
-    Serial.print("ESP32 MAC: ");
-    Serial.println(WiFi.macAddress());
+    ExitSensor::init();   // one sensor per door (DOOR_EXIT_PINS)
+    AccessController::init();
+    BootProfile::mark(BootPhase::HARDWARE);
 
+    // --- START CORE 1 PIPELINE ---
+    // Actuator first: exit and remote unlocks work while the readers init
+    xTaskCreatePinnedToCore(actuator_task, "access_actuate", PIPELINE_ACTUATOR_STACK,
+                            nullptr, PIPELINE_ACTUATOR_PRIO, nullptr, 1);
+    xTaskCreatePinnedToCore(reader_task, "access_reader", PIPELINE_READER_STACK,
+                            nullptr, PIPELINE_READER_PRIO, nullptr, 1);
+    BootProfile::mark(BootPhase::ACCESS_TASK);
 
-    Serial.print("[NET] IP: ");
-    Serial.println(WiFi.localIP());
+    Serial.println("[MAIN] Core 1 access pipeline created");
+}
 
-    Serial.print("[NET] DNS: ");
-    Serial.println(WiFi.dnsIP());
-    
-    
+// =====================================================
+// DEFERRED BOOT (first loop pass)
+// =====================================================
+// LittleFS mount and segment resume can take tens of ms and WiFi.mode()
+// hundreds; the access task is already polling by now. Records logged
+// meanwhile are held by LogStore and written once it is mounted.
+static void startDeferred() {
+    {
+        HeapMonitor::Scope heap(HeapTag::LOGGING);
+        LogStore::init();
+    }
+    BootProfile::mark(BootPhase::LOGSTORE);
 
-  
-    delay(500);
+    CloudArena::init();   // cloud buffers come from here, on this task only
+    WiFiManager::init();
+    LogSync::init();
+    BootProfile::mark(BootPhase::NETWORK);
 
-    
+    Serial.print("[HEAP] Free heap: ");
+    Serial.println(ESP.getFreeHeap());
+    Serial.print("ESP32 MAC: ");
+    Serial.println(WiFi.macAddress());
+}
 
-    // --- START CORE 1 TASK ---
-    xTaskCreatePinnedToCore(
-        core1_access_task,
-        "core1_access",
-        8192,
-        nullptr,
-        2,
-        nullptr,
-        1   // CORE 1
-    );
+void loop() {
+    static bool deferredDone = false;
+    if (!deferredDone) {
+        startDeferred();
+        deferredDone = true;
+    }
 
-    Serial.println("[MAIN] Core 1 access task created");
+    LoopProfiler::begin(ProfiledLoop::CLOUD);
 
-}
+    // Heap level first: the cloud services below shed load on it
+    HeapMonitor::update();
 
-void loop() {
     WiFiManager::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "WiFiManager::update");
     static bool cloudInitDone = false;
 
     if (!cloudInitDone && WiFiManager::getState() == WiFiState::READY) {
         CommandProcessor::init();
         HealthMonitor::init();
+        MetricsServer::init();
         cloudInitDone = true;
+        BootProfile::mark(BootPhase::CLOUD_READY);
+        LoopProfiler::mark(ProfiledLoop::CLOUD, "cloud init");
     }
     
+    // Age-based flush of buffered log lines
+    {
+        HeapMonitor::Scope heap(HeapTag::LOGGING);
+        LogStore::update();
+    }
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "LogStore::update");
+
+    NVSStore::update();   // lazy last-command / wear checkpoints
+
     // Update cloud services
     LogSync::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "LogSync::update");
+    PendingPush::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "PendingPush::update");
     CommandProcessor::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "CommandProcessor::update");
     HealthMonitor::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "HealthMonitor::update");
+    MetricsServer::update();
+    LoopProfiler::mark(ProfiledLoop::CLOUD, "MetricsServer::update");
 
 
     static uint32_t lastPrint = 0;
@@ -156,6 +218,9 @@ if (Serial.available()) {
     if (c == 'S' || c == 's') {
         LogSync::triggerSync();
     }
+    if (c == 'T' || c == 't') {
+        Trace::dumpSerial();
+    }
     if (c == 'C' || c == 'c') {
         Serial.println("[CMD] Clearing ALL logs from LittleFS...");
         LogStore::clearAllLogs();
@@ -167,7 +232,7 @@ if (WiFiManager::getState() == WiFiState::READY) {
     // Safe to use cloud services
 }
 
-
+    LoopProfiler::end(ProfiledLoop::CLOUD);
 
     vTaskDelay(100 / portTICK_PERIOD_MS);
 }
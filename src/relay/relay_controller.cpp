@@ -1,38 +1,185 @@
 #include "relay_controller.h"
 #include <Arduino.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "access/doors.h"
+#include "core/metrics.h"
+#include "core/console_log.h"
 
-// ================= CONFIG =================
-static const uint8_t RELAY_PIN = 25;
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_HARDWARE
 
+// ================= CONFIG =================
 // Change this if your relay is active HIGH
 static const uint8_t RELAY_ACTIVE_LEVEL = HIGH;
 static const uint8_t RELAY_INACTIVE_LEVEL = LOW;
 
 // ================= STATE =================
-static bool relayInitialized = false;
+// Written from the access task and the esp_timer task; relayMux keeps each
+// door's GPIO level and bookkeeping consistent
+struct DoorRelay {
+    esp_timer_handle_t lockTimer;
+    bool               open;
+    int64_t            openedAtUs;
+    int64_t            deadlineUs;   // 0 = no deadline (manual unlock)
+    uint32_t           lockedAtMs;
+    RelayStats         stats;
+};
+
+static bool         relayInitialized = false;
+static DoorRelay    relays[DOOR_COUNT] = {};
+static portMUX_TYPE relayMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ================= METRICS =================
+static const uint32_t ERROR_BOUNDS_US[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 50000 };
+
+static Counter   opensTotal("emlock_relay_opens_total", "Timed relay openings");
+static Counter   extendsTotal("emlock_relay_extends_total", "Open windows extended by a further unlock");
+static Histogram openErrorSeconds("emlock_relay_open_error_seconds",
+                                  "Actual minus commanded door-open time",
+                                  ERROR_BOUNDS_US, sizeof(ERROR_BOUNDS_US) / sizeof(ERROR_BOUNDS_US[0]),
+                                  1000000.0f);
+static Gauge     lastOpenMsGauge("emlock_relay_last_open_ms", "Measured duration of the last door opening");
+
+// ================= PRIVATE =================
+
+// Caller holds relayMux
+static void closeLocked(uint8_t door) {
+    DoorRelay& r = relays[door];
+    digitalWrite(Doors::RELAY_PINS[door], RELAY_INACTIVE_LEVEL);
+    r.open       = false;
+    r.deadlineUs = 0;
+    r.lockedAtMs = millis();
+    if (r.lockedAtMs == 0) r.lockedAtMs = 1;
+}
+
+// esp_timer task: runs at its own high priority, independent of Core 1
+static void onLockDeadline(void* arg) {
+    uint8_t    door = (uint8_t)(uintptr_t)arg;
+    DoorRelay& r    = relays[door];
+    int64_t    now  = esp_timer_get_time();
+    bool       expired;
+    int64_t    actualUs = 0, errorUs = 0;
+
+    portENTER_CRITICAL(&relayMux);
+    // An extend that raced this expiry has already re-armed the timer
+    expired = r.open && r.deadlineUs != 0 && now >= r.deadlineUs;
+    if (expired) {
+        actualUs = now - r.openedAtUs;
+        errorUs  = now - r.deadlineUs;
+        r.stats.lastCommandedMs = (uint32_t)((r.deadlineUs - r.openedAtUs) / 1000);
+        r.stats.lastActualUs    = (uint32_t)actualUs;
+        r.stats.lastErrorUs     = (int32_t)errorUs;
+        if (errorUs > r.stats.maxErrorUs) r.stats.maxErrorUs = (int32_t)errorUs;
+        closeLocked(door);
+    }
+    portEXIT_CRITICAL(&relayMux);
+
+    if (expired) {
+        openErrorSeconds.observe((uint32_t)errorUs);
+        lastOpenMsGauge.set((int32_t)(actualUs / 1000));
+    }
+}
 
 // ================= PUBLIC =================
 
 void RelayController::init() {
-    pinMode(RELAY_PIN, OUTPUT);
+    for (uint8_t d = 0; d < DOOR_COUNT; d++) {
+        pinMode(Doors::RELAY_PINS[d], OUTPUT);
+
+        // FAIL-SAFE: lock door immediately on boot
+        digitalWrite(Doors::RELAY_PINS[d], RELAY_INACTIVE_LEVEL);
 
-    // FAIL-SAFE: lock door immediately on boot
-    digitalWrite(RELAY_PIN, RELAY_INACTIVE_LEVEL);
+        esp_timer_create_args_t args = {};
+        args.callback        = onLockDeadline;
+        args.arg             = (void*)(uintptr_t)d;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name            = "relay_lock";
+        if (esp_timer_create(&args, &relays[d].lockTimer) != ESP_OK) {
+            relays[d].lockTimer = nullptr;
+            LOGE("[RELAY] Door %u lock timer unavailable, timed opens disabled\n", d);
+        }
+    }
 
     relayInitialized = true;
-    Serial.println("[RELAY] LOCK (boot default)");
+    LOGI("[RELAY] LOCK (boot default), %u door(s)\n", DOOR_COUNT);
 }
 
-void RelayController::unlock() {
-    if (!relayInitialized) return;
+void RelayController::openFor(uint8_t door, uint32_t ms) {
+    // Never leave a door open without a way to close it
+    if (!relayInitialized || !Doors::valid(door) || !relays[door].lockTimer) return;
 
-    digitalWrite(RELAY_PIN, RELAY_ACTIVE_LEVEL);
-    Serial.println("[RELAY] UNLOCK");
+    DoorRelay& r        = relays[door];
+    int64_t    now      = esp_timer_get_time();
+    int64_t    deadline = now + (int64_t)ms * 1000;
+    bool       extended;
+
+    portENTER_CRITICAL(&relayMux);
+    extended = r.open;
+    if (!r.open) {
+        digitalWrite(Doors::RELAY_PINS[door], RELAY_ACTIVE_LEVEL);
+        r.open       = true;
+        r.openedAtUs = now;
+        r.stats.opens++;
+    } else {
+        r.stats.extends++;
+    }
+    if (deadline > r.deadlineUs) r.deadlineUs = deadline;
+    deadline = r.deadlineUs;
+    portEXIT_CRITICAL(&relayMux);
+
+    esp_timer_stop(r.lockTimer);   // ESP_ERR_INVALID_STATE when idle is fine
+    esp_timer_start_once(r.lockTimer, (uint64_t)(deadline - now));
+
+    if (extended) {
+        extendsTotal.inc();
+        LOGD("[RELAY] Door %u open window extended to %lu ms\n", door,
+             (unsigned long)((deadline - r.openedAtUs) / 1000));
+    } else {
+        opensTotal.inc();
+        LOGD("[RELAY] Door %u UNLOCK for %lu ms\n", door, (unsigned long)ms);
+    }
+}
+
+void RelayController::unlock(uint8_t door) {
+    if (!relayInitialized || !Doors::valid(door)) return;
+
+    DoorRelay& r = relays[door];
+    if (r.lockTimer) esp_timer_stop(r.lockTimer);
+    portENTER_CRITICAL(&relayMux);
+    digitalWrite(Doors::RELAY_PINS[door], RELAY_ACTIVE_LEVEL);
+    if (!r.open) r.openedAtUs = esp_timer_get_time();
+    r.open       = true;
+    r.deadlineUs = 0;
+    portEXIT_CRITICAL(&relayMux);
+    LOGD("[RELAY] Door %u UNLOCK\n", door);
 }
 
-void RelayController::lock() {
-    if (!relayInitialized) return;
+// Cancels a timed window early; not counted in the timing error
+void RelayController::lock(uint8_t door) {
+    if (!relayInitialized || !Doors::valid(door)) return;
+
+    if (relays[door].lockTimer) esp_timer_stop(relays[door].lockTimer);
+    portENTER_CRITICAL(&relayMux);
+    closeLocked(door);
+    portEXIT_CRITICAL(&relayMux);
+    LOGD("[RELAY] Door %u LOCK\n", door);
+}
+
+bool RelayController::isOpen(uint8_t door) {
+    if (!Doors::valid(door)) return false;
+    return __atomic_load_n(&relays[door].open, __ATOMIC_ACQUIRE);
+}
+
+uint32_t RelayController::lastLockMs(uint8_t door) {
+    if (!Doors::valid(door)) return 0;
+    return __atomic_load_n(&relays[door].lockedAtMs, __ATOMIC_ACQUIRE);
+}
 
-    digitalWrite(RELAY_PIN, RELAY_INACTIVE_LEVEL);
-    Serial.println("[RELAY] LOCK");
+RelayStats RelayController::getStats(uint8_t door) {
+    RelayStats s = {};
+    if (!Doors::valid(door)) return s;
+    portENTER_CRITICAL(&relayMux);
+    s = relays[door].stats;
+    portEXIT_CRITICAL(&relayMux);
+    return s;
 }
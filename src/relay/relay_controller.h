@@ -1,12 +1,35 @@
 #pragma once
 #include <stdint.h>
 
+// ================= RELAY CONTROLLER =================
+// One relay per door (DOOR_RELAY_PINS). openFor() energises a door's
+// relay and arms that door's one-shot esp_timer for the lock deadline, so
+// the door re-locks on time whatever the access task is blocked on
+// (PN532 read, buzzer tone, mutex wait). Calling it while open extends
+// the window; lock() cancels it. Commanded vs actual open time is
+// measured at the GPIO writes and exported as metrics.
+
+struct RelayStats {
+    uint32_t opens;
+    uint32_t extends;
+    uint32_t lastCommandedMs;   // total window of the last completed open
+    uint32_t lastActualUs;      // GPIO unlock -> GPIO lock
+    int32_t  lastErrorUs;       // actual - commanded
+    int32_t  maxErrorUs;        // since boot
+};
+
 class RelayController {
 public:
-    static void init();
-    static void unlock();
-    static void lock();
+    static void init();         // every door, locked
+
+    // Unlock now and lock after `ms`; if already open, the window is
+    // extended to end `ms` from now (never shortened)
+    static void openFor(uint8_t door, uint32_t ms);
+
+    static void unlock(uint8_t door);   // no deadline: stays open until lock()
+    static void lock(uint8_t door);     // lock now, cancelling any deadline
 
-private:
-    static void setRelay(bool unlock);
+    static bool     isOpen(uint8_t door);
+    static uint32_t lastLockMs(uint8_t door);   // millis() of the last lock, 0 = never
+    static RelayStats getStats(uint8_t door);
 };
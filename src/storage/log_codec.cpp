@@ -0,0 +1,233 @@
+#include "log_codec.h"
+#include <string.h>
+#include "log_format.h"
+
+// ========== CONSTANTS ==========
+static const uint8_t MAGIC[4] = { 'L', 'S', 'B', '1' };
+
+static const uint8_t EVENT_MASK   = 0x0F;
+static const uint8_t UID_SHIFT    = 4;
+static const uint8_t UID_NONE     = 0;
+static const uint8_t UID_REF      = 1;
+static const uint8_t UID_NEW      = 2;
+static const uint8_t UID_LITERAL  = 3;
+static const uint8_t INFO_FLAG    = 0x40;
+static const uint8_t DOOR_FLAG    = 0x80;
+static const uint8_t INFO_LITERAL = 0xFF;
+
+// Info strings the firmware actually logs. Append only: the index is
+// stored on flash. Entry 0 is unused so a zero byte never means "ok".
+static const char* const INFO_TABLE[] = {
+    "",
+    "ok", "blacklist", "pending", "invalid UID", "boot", "disconnect",
+    "supabase", "cloud", "get_pending", "wl_failed", "bl_failed", "unknown_cmd",
+};
+static const uint8_t INFO_TABLE_SIZE = sizeof(INFO_TABLE) / sizeof(INFO_TABLE[0]);
+
+// ========== HELPERS ==========
+static size_t putVarint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// 0 if the varint runs past len, -1 if it is longer than 5 bytes
+static int getVarint(const uint8_t* in, size_t len, uint32_t& v) {
+    v = 0;
+    for (size_t i = 0; i < 5; i++) {
+        if (i >= len) return 0;
+        v |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) return (int)i + 1;
+    }
+    return -1;
+}
+
+static size_t putLiteral(uint8_t* out, const char* s, size_t maxLen) {
+    size_t n = strnlen(s, maxLen);
+    out[0] = (uint8_t)n;
+    memcpy(out + 1, s, n);
+    return n + 1;
+}
+
+static int getLiteral(const uint8_t* in, size_t len, char* out, size_t outSize) {
+    if (len < 1) return 0;
+    size_t n = in[0];
+    if (n >= outSize) return -1;
+    if (len < n + 1) return 0;
+    memcpy(out, in + 1, n);
+    out[n] = '\0';
+    return (int)n + 1;
+}
+
+static bool isNone(const char* uid) {
+    return !uid || !uid[0] || !strcmp(uid, "-");
+}
+
+// ========== HEADER ==========
+size_t LogCodec::writeHeader(uint8_t* out, int16_t tzMinutes) {
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    out[4] = (uint8_t)(tzMinutes & 0xFF);
+    out[5] = (uint8_t)((uint16_t)tzMinutes >> 8);
+    out[6] = 0;
+    out[7] = 0;
+    return HEADER_BYTES;
+}
+
+bool LogCodec::readHeader(const uint8_t* in, size_t len, int16_t& tzMinutes) {
+    if (len < HEADER_BYTES || memcmp(in, MAGIC, sizeof(MAGIC)) != 0) return false;
+    tzMinutes = (int16_t)(in[4] | (in[5] << 8));
+    return true;
+}
+
+// ========== DICTIONARY ==========
+int LogCodec::Dictionary::find(const char* uid) const {
+    for (uint16_t i = 0; i < count; i++) {
+        if (!strncmp(uids[i], uid, sizeof(uids[i]) - 1)) return i;
+    }
+    return -1;
+}
+
+bool LogCodec::Dictionary::add(const char* uid) {
+    if (find(uid) >= 0) return true;
+    if (count >= LOG_DICT_MAX) return false;
+    strncpy(uids[count], uid, sizeof(uids[count]) - 1);
+    uids[count][sizeof(uids[count]) - 1] = '\0';
+    count++;
+    return true;
+}
+
+// ========== ENCODER ==========
+void LogCodec::Encoder::reset() {
+    dict.reset();
+    prevTs = 0;
+}
+
+size_t LogCodec::Encoder::encode(uint8_t* out, uint32_t timestamp, LogEvent evt,
+                                 const char* uid, const char* info, uint8_t door) {
+    size_t n = 1;
+    uint8_t hdr = (uint8_t)evt & EVENT_MASK;
+
+    int32_t dt = (int32_t)(timestamp - prevTs);
+    n += putVarint(out + n, ((uint32_t)dt << 1) ^ (uint32_t)(dt >> 31));
+    prevTs = timestamp;
+
+    if (isNone(uid)) {
+        hdr |= UID_NONE << UID_SHIFT;
+    } else {
+        int ref = dict.find(uid);
+        if (ref >= 0) {
+            hdr |= UID_REF << UID_SHIFT;
+            n += putVarint(out + n, (uint32_t)ref);
+        } else {
+            hdr |= (dict.add(uid) ? UID_NEW : UID_LITERAL) << UID_SHIFT;
+            n += putLiteral(out + n, uid, 15);
+        }
+    }
+
+    if (info && info[0]) {
+        hdr |= INFO_FLAG;
+        uint8_t code = 0;
+        for (uint8_t i = 1; i < INFO_TABLE_SIZE; i++) {
+            if (!strcmp(info, INFO_TABLE[i])) {
+                code = i;
+                break;
+            }
+        }
+        if (code) {
+            out[n++] = code;
+        } else {
+            out[n++] = INFO_LITERAL;
+            n += putLiteral(out + n, info, 31);
+        }
+    }
+
+    // Door 0 costs nothing, so single-door segments are unchanged
+    if (door) {
+        hdr |= DOOR_FLAG;
+        out[n++] = door;
+    }
+
+    out[0] = hdr;
+    return n;
+}
+
+// ========== DECODER ==========
+void LogCodec::Decoder::reset(int16_t tz) {
+    dict.reset();
+    prevTs       = 0;
+    tzMinutes    = tz;
+    absoluteNext = false;
+    resumeTs     = 0;
+}
+
+void LogCodec::Decoder::resumeAt(uint32_t timestamp) {
+    absoluteNext = true;
+    resumeTs     = timestamp;
+}
+
+int LogCodec::Decoder::decode(const uint8_t* in, size_t len, LogEntry& out) {
+    if (len < 1) return 0;
+
+    uint8_t hdr = in[0];
+    uint8_t evt = hdr & EVENT_MASK;
+    if (evt > (uint8_t)LogEvent::COMMAND_ERROR) return -1;
+
+    size_t n = 1;
+    uint32_t zz;
+    int r = getVarint(in + n, len - n, zz);
+    if (r <= 0) return r;
+    n += r;
+    int32_t dt = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+
+    LogEntry e = {};
+    e.event = (LogEvent)evt;
+
+    uint8_t uidMode = (hdr >> UID_SHIFT) & 0x03;
+    if (uidMode == UID_NONE) {
+        strcpy(e.uid, "-");
+    } else if (uidMode == UID_REF) {
+        uint32_t ref;
+        r = getVarint(in + n, len - n, ref);
+        if (r <= 0) return r;
+        if (ref >= dict.count) return -1;
+        n += r;
+        strncpy(e.uid, dict.uids[ref], sizeof(e.uid) - 1);
+    } else {
+        r = getLiteral(in + n, len - n, e.uid, sizeof(e.uid));
+        if (r <= 0) return r;
+        n += r;
+    }
+
+    if (hdr & INFO_FLAG) {
+        if (n >= len) return 0;
+        uint8_t code = in[n++];
+        if (code == INFO_LITERAL) {
+            r = getLiteral(in + n, len - n, e.info, sizeof(e.info));
+            if (r <= 0) return r;
+            n += r;
+        } else if (code > 0 && code < INFO_TABLE_SIZE) {
+            strncpy(e.info, INFO_TABLE[code], sizeof(e.info) - 1);
+        } else {
+            return -1;
+        }
+    }
+
+    if (hdr & DOOR_FLAG) {
+        if (n >= len) return 0;
+        e.door = in[n++];
+    }
+
+    // Only commit state once the whole record was available
+    if (uidMode == UID_NEW) dict.add(e.uid);
+    e.timestamp = absoluteNext ? resumeTs : prevTs + dt;
+    absoluteNext = false;
+    prevTs = e.timestamp;
+    LogFormat::formatTimestamp(e.timestampStr, sizeof(e.timestampStr), e.timestamp, tzMinutes);
+
+    out = e;
+    return (int)n;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "log_store.h"
+#include "../config/config.h"
+
+// ================= BINARY LOG ENCODING =================
+// A segment is an 8-byte header ("LSB1", zone offset in minutes, 2 spare)
+// followed by records:
+//   [hdr] [dt] [uid] [info] [door]
+//   hdr  bits 0-3  LogEvent
+//        bits 4-5  uid: 0 = "-", 1 = dictionary index (varint),
+//                  2 = literal, appended to the dictionary, 3 = literal only
+//        bit  6    an info byte follows: table entry, or 0xFF + literal
+//        bit  7    a door byte follows (absent = door 0)
+//   dt   zigzag varint, seconds since the previous record (first: since 0)
+//   literals are a length byte + chars
+// The dictionary is rebuilt while decoding, so a segment streams from its
+// header with no other state. A typical grant takes 4-5 bytes (~55 as text).
+// Kept free of LittleFS so the host-side replay tool can share it.
+
+namespace LogCodec {
+    const size_t HEADER_BYTES     = 8;
+    const size_t MAX_RECORD_BYTES = 1 + 5 + 1 + 15 + 2 + 31 + 1;
+
+    size_t writeHeader(uint8_t* out, int16_t tzMinutes);
+    bool   readHeader(const uint8_t* in, size_t len, int16_t& tzMinutes);
+
+    struct Dictionary {
+        char     uids[LOG_DICT_MAX][16];
+        uint16_t count;
+
+        void reset() { count = 0; }
+        int  find(const char* uid) const;
+        bool add(const char* uid);   // no-op if present, false when full
+    };
+
+    class Encoder {
+    public:
+        Dictionary dict;
+        uint32_t   prevTs;
+
+        void reset();   // start of a new segment
+
+        // Append one record to out (>= MAX_RECORD_BYTES); returns its length
+        size_t encode(uint8_t* out, uint32_t timestamp, LogEvent evt,
+                      const char* uid, const char* info, uint8_t door = 0);
+    };
+
+    class Decoder {
+    public:
+        Dictionary dict;     // may be preloaded with a sealed segment's final dictionary
+        uint32_t   prevTs;
+        int16_t    tzMinutes;
+
+        void reset(int16_t tz = LOG_TZ_OFFSET_MINUTES);
+
+        // Next record sits at an index checkpoint holding this timestamp
+        void resumeAt(uint32_t timestamp);
+
+        // >0 bytes consumed, 0 = record continues past len, <0 = corrupt
+        int decode(const uint8_t* in, size_t len, LogEntry& out);
+
+    private:
+        bool     absoluteNext;
+        uint32_t resumeTs;
+    };
+}
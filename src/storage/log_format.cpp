@@ -0,0 +1,147 @@
+#include "log_format.h"
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+// ========== EVENT NAMES ==========
+const char* LogFormat::eventToStr(LogEvent e) {
+    switch (e) {
+        case LogEvent::ACCESS_GRANTED:  return "ACCESS_GRANTED";
+        case LogEvent::ACCESS_DENIED:   return "ACCESS_DENIED";
+        case LogEvent::UNKNOWN_CARD:    return "UNKNOWN_CARD";
+        case LogEvent::RFID_INVALID:    return "RFID_INVALID";
+        case LogEvent::EXIT_UNLOCK:     return "EXIT_UNLOCK";
+        case LogEvent::REMOTE_UNLOCK:   return "REMOTE_UNLOCK";
+        case LogEvent::SYSTEM_BOOT:     return "SYSTEM_BOOT";
+        case LogEvent::WIFI_LOST:       return "WIFI_LOST";
+        case LogEvent::COMMAND_ERROR:   return "COMMAND_ERROR";
+        case LogEvent::UID_WHITELISTED: return "UID_WHITELISTED";
+        case LogEvent::UID_BLACKLISTED: return "UID_BLACKLISTED";
+        case LogEvent::UID_REMOVED:     return "UID_REMOVED";
+        case LogEvent::UID_SYNC:        return "UID_SYNC";
+        default:                        return "UNKNOWN";
+    }
+}
+
+bool LogFormat::strToEvent(const char* s, LogEvent& out) {
+    // Old firmware wrote RFID_* names for the access events
+    if (!strcmp(s, "ACCESS_GRANTED") || !strcmp(s, "RFID_GRANTED")) { out = LogEvent::ACCESS_GRANTED; return true; }
+    if (!strcmp(s, "ACCESS_DENIED")  || !strcmp(s, "RFID_DENIED"))  { out = LogEvent::ACCESS_DENIED;  return true; }
+    if (!strcmp(s, "UNKNOWN_CARD")   || !strcmp(s, "RFID_PENDING")) { out = LogEvent::UNKNOWN_CARD;   return true; }
+
+    for (uint8_t i = (uint8_t)LogEvent::RFID_INVALID; i <= (uint8_t)LogEvent::COMMAND_ERROR; i++) {
+        if (!strcmp(s, eventToStr((LogEvent)i))) {
+            out = (LogEvent)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ========== TIMESTAMPS ==========
+// Days since 1970-01-01 for a proleptic Gregorian date (no timegm on newlib)
+static int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Inverse of daysFromCivil
+static void civilFromDays(int32_t z, int& y, int& m, int& d) {
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    y = (int)yoe + era * 400 + (m <= 2);
+}
+
+void LogFormat::formatTimestamp(char* out, size_t outSize, uint32_t epoch, int16_t tzMinutes) {
+    int64_t local = (int64_t)epoch + tzMinutes * 60;
+    if (local < 0) local = 0;
+
+    int y, mo, d;
+    civilFromDays((int32_t)(local / 86400), y, mo, d);
+    uint32_t sec = (uint32_t)(local % 86400);
+
+    uint16_t tz = tzMinutes < 0 ? -tzMinutes : tzMinutes;
+    snprintf(out, outSize, "%04d-%02d-%02d %02d:%02d:%02d%c%02u:%02u",
+             y, mo, d, (int)(sec / 3600), (int)(sec / 60 % 60), (int)(sec % 60),
+             tzMinutes < 0 ? '-' : '+', (unsigned)(tz / 60), (unsigned)(tz % 60));
+}
+
+uint32_t LogFormat::parseTimestamp(const char* s) {
+    int y, mo, d, h, mi, sec;
+    if (sscanf(s, "%4d-%2d-%2d%*c%2d:%2d:%2d", &y, &mo, &d, &h, &mi, &sec) != 6) return 0;
+    if (y < 1970 || mo < 1 || mo > 12 || d < 1 || d > 31) return 0;
+
+    int64_t epoch = (int64_t)daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec;
+
+    // Optional "+HH:MM" / "-HH:MM" zone suffix right after the seconds
+    const char* tz = s + 19;
+    if (strlen(s) >= 25 && (tz[0] == '+' || tz[0] == '-')) {
+        int oh = 0, om = 0;
+        if (sscanf(tz + 1, "%2d:%2d", &oh, &om) == 2) {
+            int32_t off = oh * 3600 + om * 60;
+            epoch -= (tz[0] == '+') ? off : -off;
+        }
+    }
+    return epoch > 0 ? (uint32_t)epoch : 0;
+}
+
+// ========== LINE FORMAT ==========
+size_t LogFormat::formatLine(char* out, size_t outSize, const char* timestamp,
+                             LogEvent evt, const char* uid, const char* info) {
+    int n = snprintf(out, outSize, "%s | %s | %s | %s\n",
+                     timestamp, eventToStr(evt), uid, info);
+    if (n < 0) return 0;
+    if ((size_t)n >= outSize) {
+        // Truncated: keep the line terminator so the file stays parseable
+        n = outSize - 1;
+        out[n - 1] = '\n';
+    }
+    return (size_t)n;
+}
+
+// ========== LINE PARSER ==========
+static char* trimInPlace(char* s) {
+    while (*s && isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+bool LogFormat::parseLine(const char* line, LogEntry& out) {
+    char buf[128];
+    strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char* p = trimInPlace(buf);
+    if (strlen(p) < 10) return false;
+
+    // Split into exactly four fields; info may itself be empty
+    char* fields[4];
+    for (uint8_t i = 0; i < 3; i++) {
+        char* pipe = strchr(p, '|');
+        if (!pipe) return false;
+        *pipe = '\0';
+        fields[i] = trimInPlace(p);
+        p = pipe + 1;
+    }
+    fields[3] = trimInPlace(p);
+
+    out = {};
+    if (!strToEvent(fields[1], out.event)) return false;
+
+    strncpy(out.timestampStr, fields[0], sizeof(out.timestampStr) - 1);
+    strncpy(out.uid, fields[2], sizeof(out.uid) - 1);
+    strncpy(out.info, fields[3], sizeof(out.info) - 1);
+    out.timestamp = parseTimestamp(out.timestampStr);
+    return true;
+}
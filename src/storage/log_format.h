@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "log_store.h"
+
+// ================= LOG LINE FORMAT =================
+// One text line per event, as written to /log_YYYYMMDD.txt and to the
+// first segments (new segments use LogCodec):
+//   "2026-01-20 20:45:03+05:30 | ACCESS_GRANTED | A1B2C3D4 | ok"
+// Kept free of LittleFS so the host-side replay tool can share it.
+
+namespace LogFormat {
+    const char* eventToStr(LogEvent e);
+
+    // Accepts both current (ACCESS_*) and legacy (RFID_*) names
+    bool strToEvent(const char* s, LogEvent& out);
+
+    // "YYYY-MM-DD HH:MM:SS[+HH:MM]" -> UTC epoch seconds (0 on failure)
+    uint32_t parseTimestamp(const char* s);
+
+    // UTC epoch -> "YYYY-MM-DD HH:MM:SS+HH:MM" in the given zone
+    void formatTimestamp(char* out, size_t outSize, uint32_t epoch, int16_t tzMinutes);
+
+    // Write one '\n'-terminated line into out; returns its length
+    size_t formatLine(char* out, size_t outSize, const char* timestamp,
+                      LogEvent evt, const char* uid, const char* info);
+
+    // Parse one line; returns false for blank / malformed / unknown events
+    bool parseLine(const char* line, LogEntry& out);
+}
@@ -0,0 +1,77 @@
+#include "log_index.h"
+#include <string.h>
+
+// ========== UID HASHING ==========
+// FNV-1a, with the second probe derived from the first (Kirsch-Mitzenmacher)
+static const uint8_t  BLOOM_PROBES = 3;
+static const uint32_t BLOOM_BITS   = LOG_INDEX_BLOOM_BYTES * 8;
+
+static uint32_t fnv1a(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool indexable(const char* uid) {
+    return uid && uid[0] && strcmp(uid, "-") != 0;
+}
+
+// ========== IMPLEMENTATION ==========
+void SegmentIndex::reset() {
+    memset(this, 0, sizeof(*this));
+    magic = MAGIC;
+}
+
+void SegmentIndex::add(uint32_t timestamp, const char* uid, uint32_t offset) {
+    if (recordCount == 0 || timestamp < minTs) minTs = timestamp;
+    if (timestamp > maxTs) maxTs = timestamp;
+
+    if (recordCount % LOG_INDEX_STRIDE == 0 && checkpointCount < LOG_INDEX_CHECKPOINTS) {
+        checkpoints[checkpointCount].timestamp = timestamp;
+        checkpoints[checkpointCount].offset    = offset;
+        checkpointCount++;
+    }
+    if (recordCount < 0xFFFF) recordCount++;
+
+    if (!indexable(uid)) return;
+    uint32_t h1 = fnv1a(uid);
+    uint32_t h2 = (h1 >> 16) | (h1 << 16);
+    for (uint8_t i = 0; i < BLOOM_PROBES; i++) {
+        uint32_t bit = (h1 + i * h2) % BLOOM_BITS;
+        uidBloom[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+    }
+}
+
+bool SegmentIndex::mayContainUid(const char* uid) const {
+    if (!indexable(uid)) return true;
+    uint32_t h1 = fnv1a(uid);
+    uint32_t h2 = (h1 >> 16) | (h1 << 16);
+    for (uint8_t i = 0; i < BLOOM_PROBES; i++) {
+        uint32_t bit = (h1 + i * h2) % BLOOM_BITS;
+        if (!(uidBloom[bit >> 3] & (1u << (bit & 7)))) return false;
+    }
+    return true;
+}
+
+bool SegmentIndex::overlaps(uint32_t from, uint32_t to) const {
+    if (recordCount == 0) return false;
+    return maxTs >= from && minTs <= to;
+}
+
+uint32_t SegmentIndex::seekOffset(uint32_t from) const {
+    uint8_t i = 0;
+    while (i + 1 < checkpointCount && checkpoints[i + 1].timestamp < from) i++;
+    if (i > 0) i--;
+    return checkpointCount ? checkpoints[i].offset : 0;
+}
+
+const SegmentIndex::Checkpoint* SegmentIndex::checkpointAtOrBefore(uint32_t offset) const {
+    const Checkpoint* best = nullptr;
+    for (uint8_t i = 0; i < checkpointCount && checkpoints[i].offset <= offset; i++) {
+        best = &checkpoints[i];
+    }
+    return best;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/config.h"
+
+// ================= SEGMENT INDEX =================
+// Small summary of one log segment so queries can skip or seek instead of
+// scanning every line:
+//   - time range of the records it holds
+//   - a checkpoint (timestamp, file offset) every LOG_INDEX_STRIDE records
+//   - a Bloom filter of the card UIDs it mentions
+// Sealed segments keep theirs in /seg_NNNNNNNN.idx; the active segment's
+// lives in RAM. Kept free of LittleFS like LogFormat.
+
+struct SegmentIndex {
+    struct Checkpoint {
+        uint32_t timestamp;
+        uint32_t offset;
+    };
+
+    uint32_t   magic;
+    uint32_t   minTs;
+    uint32_t   maxTs;
+    uint16_t   recordCount;
+    uint8_t    checkpointCount;
+    uint8_t    reserved;
+    Checkpoint checkpoints[LOG_INDEX_CHECKPOINTS];
+    uint8_t    uidBloom[LOG_INDEX_BLOOM_BYTES];
+
+    static const uint32_t MAGIC = 0x4C534931;   // "LSI1"
+
+    void reset();
+    bool valid() const { return magic == MAGIC; }
+
+    // Record at byte `offset` of the segment; uid "-" is not indexed
+    void add(uint32_t timestamp, const char* uid, uint32_t offset);
+
+    // false = definitely absent, true = worth scanning
+    bool mayContainUid(const char* uid) const;
+    bool overlaps(uint32_t from, uint32_t to) const;
+
+    // Where a scan for records at or after `from` can safely start.
+    // Backs off one checkpoint so small NTP corrections can't hide a record.
+    uint32_t seekOffset(uint32_t from) const;
+
+    // Last checkpoint at or before a record offset (nullptr if none)
+    const Checkpoint* checkpointAtOrBefore(uint32_t offset) const;
+};
@@ -2,262 +2,1020 @@
 #include <LittleFS.h>
 #include <time.h>
 #include "../core/thread_safe.h"
+#include "log_codec.h"
+#include "log_format.h"
+#include "log_index.h"
+#include "../config/config.h"
+#include "../core/metrics.h"
+#include "../core/trace.h"
+#include "../core/console_log.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_LOGSTORE
 
 // ========== CONFIG ==========
-static const uint32_t MAX_DAYS_LOCAL = 30;
+static const uint32_t MAX_DAYS_LOCAL = LOG_RETENTION_DAYS_LOCAL;
+static const char*    META_PATH      = "/seg.meta";
+static const uint32_t META_MAGIC     = 0x4C534731;   // "LSG1"
+
+// ========== SEGMENT STATE ==========
+// Logs are appended to fixed-size segments /seg_NNNNNNNN.log numbered
+// firstSeq..activeSeq (oldest..newest). Only the active one is written.
+// New segments are LogCodec binary; text segments from older firmware are
+// still read (the header tells them apart) until they age out.
+// Segment numbers never go backwards, so a position (seq, offset) stays
+// meaningful across evictions and reboots.
+struct SegmentMeta {
+    uint32_t magic;
+    uint32_t firstSeq;
+    uint32_t activeSeq;
+    uint32_t evictionCount;
+    uint32_t syncedSeq;      // LogSync upload position (older meta files: 0)
+    uint32_t syncedOffset;
+};
+
+static uint32_t firstSeq    = 1;
+static uint32_t activeSeq   = 1;
+static uint32_t activeSize  = 0;     // bytes already on flash in the active segment
+static uint32_t legacyBytes = 0;     // log_YYYYMMDD.txt files, measured by retention
+static uint32_t quotaBytes  = 0;
+static LogCursor synced     = {};   // everything before this is in the cloud
+
+// ========== WRITE-BEHIND STATE ==========
+// The active segment stays open and records are batched in RAM, so a burst
+// of grants costs one LittleFS append + metadata commit instead of one per
+// record. Guarded by ThreadSafe like every other LittleFS access.
+static File     activeFile;
+static uint8_t  writeBuf[LOG_WRITE_BUFFER_BYTES];
+static size_t   writeLen       = 0;
+static uint32_t oldestBuffered = 0;   // millis() of first unflushed record
+static uint32_t lastAccessMs   = 0;   // millis() of the latest door event
+static LogStats stats          = {};
+
+// Encoder state and index of the active segment, maintained as records
+// are buffered and rebuilt from flash at boot. An index that lost records
+// (dropped batch) is not trusted and the segment is rolled.
+static LogCodec::Encoder activeEncoder;
+static SegmentIndex      activeIndex;
+static bool              activeIndexComplete = true;
+
+// ========== BOOT STATE ==========
+// init() runs from the first loop() pass, after the access task is up.
+// Until then records wait here with their original timestamps.
+struct EarlyRecord {
+    uint32_t timestamp;
+    LogEvent evt;
+    char     uid[21];
+    char     info[24];
+    uint8_t  door;
+};
+static bool        ready = false;   // LittleFS mounted, segment resumed
+static EarlyRecord early[LOG_EARLY_RECORDS];
+static uint8_t     earlyCount = 0;
+
+// Only one segment is read at a time (always under ThreadSafe), so the
+// decoder and its dictionary are shared instead of living on the stack
+static LogCodec::Decoder readDecoder;
+
+// Per-event durability (indexed by LogEvent value)
+static LogDurability durability[] = {
+    LogDurability::GROUP,       // ACCESS_GRANTED
+    LogDurability::IMMEDIATE,   // ACCESS_DENIED
+    LogDurability::IMMEDIATE,   // UNKNOWN_CARD
+    LogDurability::IMMEDIATE,   // RFID_INVALID
+    LogDurability::GROUP,       // EXIT_UNLOCK
+    LogDurability::IMMEDIATE,   // REMOTE_UNLOCK
+    LogDurability::IMMEDIATE,   // SYSTEM_BOOT
+    LogDurability::GROUP,       // WIFI_LOST
+    LogDurability::IMMEDIATE,   // UID_WHITELISTED
+    LogDurability::IMMEDIATE,   // UID_BLACKLISTED
+    LogDurability::IMMEDIATE,   // UID_REMOVED
+    LogDurability::GROUP,       // UID_SYNC
+    LogDurability::GROUP,       // COMMAND_ERROR
+};
+static const uint8_t DURABILITY_COUNT = sizeof(durability) / sizeof(durability[0]);
+
+// ========== RETENTION STATE ==========
+// Runs a few file operations per LogStore::update() call once the clock
+// is valid, so neither boot nor the access path ever waits on a scan.
+enum class RetentionPhase : uint8_t { IDLE, SEGMENTS, LEGACY };
+
+static RetentionPhase retentionPhase = RetentionPhase::IDLE;
+static File           retentionDir;
+static uint32_t       retentionLegacyBytes = 0;
+static uint32_t       nextRetentionMs      = 0;
+
+// ========== METRICS ==========
+static const uint32_t FLUSH_BOUNDS_US[] = { 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000 };
+
+static Counter   recordsTotal("emlock_log_records_total", "Records appended to LogStore");
+static Counter   flushesTotal("emlock_log_flushes_total", "Write-behind batches committed to flash");
+static Counter   flushBytesTotal("emlock_log_flush_bytes_total", "Bytes committed to flash");
+static Counter   droppedTotal("emlock_log_dropped_total", "Records or batches lost before reaching flash");
+static Counter   evictionsTotal("emlock_log_evictions_total", "Segments or legacy files removed for quota");
+static Histogram flushSeconds("emlock_log_flush_seconds", "Write + flush of one batch",
+                              FLUSH_BOUNDS_US, sizeof(FLUSH_BOUNDS_US) / sizeof(FLUSH_BOUNDS_US[0]),
+                              1000000.0f);
 
 // ========== HELPERS ==========
-static const char* logEventToStr(LogEvent e) {
-    switch (e) {
-        case LogEvent::ACCESS_GRANTED:  return "ACCESS_GRANTED";
-        case LogEvent::ACCESS_DENIED:   return "ACCESS_DENIED";
-        case LogEvent::UNKNOWN_CARD:    return "UNKNOWN_CARD";
-        case LogEvent::RFID_INVALID:    return "RFID_INVALID";
-        case LogEvent::EXIT_UNLOCK:     return "EXIT_UNLOCK";
-        case LogEvent::REMOTE_UNLOCK:   return "REMOTE_UNLOCK";
-        case LogEvent::SYSTEM_BOOT:     return "SYSTEM_BOOT";
-        case LogEvent::WIFI_LOST:       return "WIFI_LOST";
-        case LogEvent::COMMAND_ERROR:   return "COMMAND_ERROR";
-        case LogEvent::UID_WHITELISTED: return "UID_WHITELISTED";
-        case LogEvent::UID_BLACKLISTED: return "UID_BLACKLISTED";
-        case LogEvent::UID_REMOVED:     return "UID_REMOVED";
-        case LogEvent::UID_SYNC:        return "UID_SYNC";
-        default:                        return "UNKNOWN";
-    }
-}
-
-static String currentDate() {
-    time_t now = time(nullptr);
-    struct tm t;
-    localtime_r(&now, &t);
-
-    char buf[9];
-    snprintf(buf, sizeof(buf), "%04d%02d%02d",
-             t.tm_year + 1900,
-             t.tm_mon + 1,
-             t.tm_mday);
-    return String(buf);
-}
-
-static String currentTimestamp() {
-    time_t now = time(nullptr);
-    struct tm t;
-    localtime_r(&now, &t);
-
-    // Include IST timezone offset (+05:30) in the timestamp
-    char buf[30];
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d+05:30",
-             t.tm_year + 1900,
-             t.tm_mon + 1,
-             t.tm_mday,
-             t.tm_hour,
-             t.tm_min,
-             t.tm_sec);
-    return String(buf);
+// Same sanity bound WiFiManager uses for NTP (~2023+)
+static bool clockValid() {
+    return time(nullptr) > 1700000000;
+}
+
+static void segmentPath(uint32_t seq, char* out, size_t outSize) {
+    snprintf(out, outSize, "/seg_%08lu.log", (unsigned long)seq);
+}
+
+static void indexPath(uint32_t seq, char* out, size_t outSize) {
+    snprintf(out, outSize, "/seg_%08lu.idx", (unsigned long)seq);
+}
+
+// LittleFS may report names with or without the leading slash
+static bool isLegacyLog(const char* name) {
+    if (name[0] == '/') name++;
+    return strncmp(name, "log_", 4) == 0;
+}
+
+static uint32_t usedBytes() {
+    return (activeSeq - firstSeq) * LOG_SEGMENT_BYTES + activeSize + legacyBytes;
+}
+
+// Segment bytes after the synced cursor (sealed segments counted as full)
+static uint32_t unsyncedBytes() {
+    uint32_t end = (activeSeq - firstSeq) * LOG_SEGMENT_BYTES + activeSize + writeLen;
+    if (synced.seq < firstSeq) return end;
+    if (synced.seq > activeSeq) return 0;
+    uint32_t done = (synced.seq - firstSeq) * LOG_SEGMENT_BYTES + synced.offset;
+    return end > done ? end - done : 0;
+}
+
+// ---- Caller must hold ThreadSafe ----
+static void saveMetaLocked() {
+    SegmentMeta m = { META_MAGIC, firstSeq, activeSeq, stats.evictionCount,
+                      synced.seq, synced.offset };
+    File f = LittleFS.open(META_PATH, FILE_WRITE);
+    if (!f) {
+        LOGE("[LOG] Failed to write segment meta\n");
+        return;
+    }
+    f.write((const uint8_t*)&m, sizeof(m));
+    f.close();
+}
+
+static void loadMetaLocked() {
+    SegmentMeta m = {};
+    if (LittleFS.exists(META_PATH)) {
+        File f = LittleFS.open(META_PATH, FILE_READ);
+        if (f) {
+            f.read((uint8_t*)&m, sizeof(m));
+            f.close();
+        }
+    }
+
+    if (m.magic == META_MAGIC && m.firstSeq >= 1 && m.firstSeq <= m.activeSeq) {
+        firstSeq            = m.firstSeq;
+        activeSeq           = m.activeSeq;
+        stats.evictionCount = m.evictionCount;
+        synced              = { m.syncedSeq, m.syncedOffset };
+    } else {
+        firstSeq = activeSeq = 1;
+        synced   = {};
+    }
+
+    char path[24];
+    segmentPath(activeSeq, path, sizeof(path));
+    activeSize = 0;
+    if (LittleFS.exists(path)) {
+        File f = LittleFS.open(path, FILE_READ);
+        if (f) {
+            activeSize = f.size();
+            f.close();
+        }
+    }
+}
+
+// Sidecar = SegmentIndex, then (binary segments) the segment's final UID
+// dictionary, so a reader can start decoding at any checkpoint
+static bool loadIndexLocked(uint32_t seq, SegmentIndex& out, LogCodec::Dictionary* dict) {
+    char path[24];
+    indexPath(seq, path, sizeof(path));
+    if (!LittleFS.exists(path)) return false;
+
+    File f = LittleFS.open(path, FILE_READ);
+    if (!f) return false;
+    bool ok = f.read((uint8_t*)&out, sizeof(out)) == sizeof(out) && out.valid();
+
+    if (ok && dict) {
+        uint16_t count = 0;
+        size_t n = f.read((uint8_t*)&count, sizeof(count));
+        if (n == 0) {
+            dict->count = 0;   // text segment: no dictionary
+        } else if (n == sizeof(count) && count <= LOG_DICT_MAX &&
+                   f.read((uint8_t*)dict->uids, count * sizeof(dict->uids[0])) ==
+                       count * sizeof(dict->uids[0])) {
+            dict->count = count;
+        } else {
+            ok = false;
+        }
+    }
+    f.close();
+    return ok;
+}
+
+static void saveIndexLocked(uint32_t seq, const SegmentIndex& idx,
+                            const LogCodec::Dictionary& dict) {
+    char path[24];
+    indexPath(seq, path, sizeof(path));
+    File f = LittleFS.open(path, FILE_WRITE);
+    if (!f) {
+        LOGE("[LOG] Failed to write index %s\n", path);
+        return;
+    }
+    f.write((const uint8_t*)&idx, sizeof(idx));
+    f.write((const uint8_t*)&dict.count, sizeof(dict.count));
+    f.write((const uint8_t*)dict.uids, dict.count * sizeof(dict.uids[0]));
+    f.close();
+}
+
+static void removeSegmentLocked(uint32_t seq) {
+    char path[24];
+    segmentPath(seq, path, sizeof(path));
+    LittleFS.remove(path);
+    indexPath(seq, path, sizeof(path));
+    if (LittleFS.exists(path)) LittleFS.remove(path);
+}
+
+// Drop the oldest sealed segment; the active one is never evicted
+static bool evictOldestLocked() {
+    if (firstSeq >= activeSeq) return false;
+
+    removeSegmentLocked(firstSeq);
+    LOGW("[LOG] Quota reached, evicted segment %lu\n", (unsigned long)firstSeq);
+    if (synced.seq <= firstSeq) stats.unsyncedEvictions++;
+    firstSeq++;
+    stats.evictionCount++;
+    evictionsTotal.inc();
+    saveMetaLocked();
+    return true;
+}
+
+static void resetActiveStateLocked() {
+    activeSize = 0;
+    activeEncoder.reset();
+    activeIndex.reset();
+    activeIndexComplete = true;
+}
+
+// An index that lost records is not written; the first query touching
+// that segment rebuilds it from the data instead
+static void sealActiveLocked() {
+    if (activeFile) activeFile.close();
+    if (activeIndexComplete && activeIndex.recordCount > 0) {
+        saveIndexLocked(activeSeq, activeIndex, activeEncoder.dict);
+    }
+    activeSeq++;
+    resetActiveStateLocked();
+    saveMetaLocked();
+}
+
+// Next record starts a fresh segment, and with it fresh encoder state
+static void rollActiveLocked() {
+    if (activeSize > 0) sealActiveLocked();
+    else resetActiveStateLocked();
+}
+
+// Buffered records never reached flash. The encoder's dictionary and
+// time base already include them, so the caller must roll.
+static void dropBatchLocked() {
+    stats.droppedCount++;
+    droppedTotal.inc();
+    writeLen = 0;
+    activeIndexComplete = false;
+}
+
+// On failure the batch is dropped and the segment rolled here, so callers
+// never drop it again
+static bool flushLocked() {
+    if (writeLen == 0) return true;
+
+    while (usedBytes() + writeLen > quotaBytes && evictOldestLocked()) {}
+
+    if (!activeFile) {
+        char path[24];
+        segmentPath(activeSeq, path, sizeof(path));
+        activeFile = LittleFS.open(path, FILE_APPEND);
+        if (!activeFile) {
+            LOGE("[LOG] Failed to open log segment\n");
+            dropBatchLocked();
+            rollActiveLocked();
+            return false;
+        }
+    }
+
+    uint32_t t0 = micros();
+    size_t written = activeFile.write(writeBuf, writeLen);
+    activeFile.flush();   // commit data + metadata to flash
+    flushSeconds.observe(micros() - t0);
+    Trace::record(TraceEvent::FLASH_LOG, t0, (int16_t)written);
+
+    activeSize += written;
+    stats.flushCount++;
+    stats.bytesWritten += written;
+    flushesTotal.inc();
+    flushBytesTotal.inc(written);
+
+    if (written != writeLen) {
+        // A torn record would poison everything appended after it
+        LOGE("[LOG] Short write %u/%u bytes\n", (unsigned)written, (unsigned)writeLen);
+        dropBatchLocked();
+        rollActiveLocked();
+        return false;
+    }
+    writeLen = 0;
+    return true;
+}
+
+// ========== SEGMENT READER ==========
+// Streams records out of one segment, text (older firmware) or binary,
+// through a small chunk buffer. Uses the shared readDecoder: the caller
+// resets it, may preload the dictionary, then opens.
+struct SegmentReader {
+    File     file;
+    bool     binary;
+    bool     corrupt;        // binary stream ended in an undecodable record
+    uint8_t  buf[LOG_READ_CHUNK_BYTES];
+    size_t   len;
+    size_t   pos;
+    uint32_t bufOffset;      // file offset of buf[0]
+
+    uint32_t offset() const { return bufOffset + pos; }
+};
+
+static bool fillReader(SegmentReader& r) {
+    size_t rest = r.len - r.pos;
+    memmove(r.buf, r.buf + r.pos, rest);
+    r.bufOffset += r.pos;
+    r.len = rest;
+    r.pos = 0;
+
+    int n = r.file.read(r.buf + r.len, sizeof(r.buf) - r.len);
+    if (n <= 0) return false;
+    r.len += n;
+    return true;
+}
+
+static bool openReaderLocked(const char* path, SegmentReader& r) {
+    r.file = LittleFS.open(path, FILE_READ);
+    if (!r.file) return false;
+
+    r.len = r.pos = 0;
+    r.bufOffset = 0;
+    r.corrupt = false;
+    fillReader(r);
+
+    int16_t tz;
+    r.binary = LogCodec::readHeader(r.buf, r.len, tz);
+    if (r.binary) {
+        readDecoder.tzMinutes = tz;
+        r.pos = LogCodec::HEADER_BYTES;
+    }
+    return true;
+}
+
+static bool openSegmentLocked(uint32_t seq, SegmentReader& r) {
+    char path[24];
+    segmentPath(seq, path, sizeof(path));
+    return openReaderLocked(path, r);
+}
+
+// Jump to a record boundary; binary streams need that record's timestamp
+static void seekReaderLocked(SegmentReader& r, uint32_t offset, uint32_t timestamp) {
+    if (offset <= r.offset()) return;
+    r.file.seek(offset);
+    r.bufOffset = offset;
+    r.len = r.pos = 0;
+    if (r.binary) readDecoder.resumeAt(timestamp);
+}
+
+// `at` receives the record's offset in the segment
+static bool nextRecordLocked(SegmentReader& r, LogEntry& e, uint32_t& at) {
+    while (!r.corrupt) {
+        at = r.offset();
+        if (r.binary) {
+            int n = readDecoder.decode(r.buf + r.pos, r.len - r.pos, e);
+            if (n > 0) {
+                r.pos += n;
+                return true;
+            }
+            if (n < 0) r.corrupt = true;
+            else if (!fillReader(r)) return false;
+            continue;
+        }
+
+        uint8_t* nl = (uint8_t*)memchr(r.buf + r.pos, '\n', r.len - r.pos);
+        if (!nl) {
+            if (r.pos == 0 && r.len == sizeof(r.buf)) r.pos = r.len;   // overlong line
+            else if (!fillReader(r)) return false;
+            continue;
+        }
+        *nl = '\0';
+        const char* line = (const char*)r.buf + r.pos;
+        r.pos = nl - r.buf + 1;
+        if (LogFormat::parseLine(line, e)) return true;
+    }
+    return false;
+}
+
+// Rebuild the encoder and index of the active segment so appends continue
+// it. A text segment (older firmware) or a torn tail is sealed instead.
+static void resumeActiveLocked() {
+    uint32_t size = activeSize;
+    resetActiveStateLocked();
+    if (size == 0) return;
+
+    char path[24];
+    segmentPath(activeSeq, path, sizeof(path));
+
+    readDecoder.reset();
+    SegmentReader r;
+    bool clean = false;
+    if (openReaderLocked(path, r)) {
+        if (r.binary) {
+            LogEntry e;
+            uint32_t at;
+            while (nextRecordLocked(r, e, at)) activeIndex.add(e.timestamp, e.uid, at);
+            clean = !r.corrupt && r.offset() == size;
+        }
+        r.file.close();
+    }
+
+    if (clean) {
+        activeEncoder.dict   = readDecoder.dict;
+        activeEncoder.prevTs = readDecoder.prevTs;
+        activeSize = size;
+        return;
+    }
+
+    LOGW("[LOG] Sealing %s, not appendable\n", path);
+    activeIndexComplete = false;
+    activeSize = size;
+    sealActiveLocked();
+}
+
+// ========== RETENTION ==========
+// Age of a sealed segment: its first record's timestamp. A segment begun
+// before NTP sync falls back to its newest indexed record, then to the
+// file's mtime, so one early segment can't hold back every later one.
+// 0 if none of them is a real date.
+static uint32_t segmentStartTimeLocked(uint32_t seq) {
+    readDecoder.reset();
+    SegmentReader r;
+    if (!openSegmentLocked(seq, r)) return 0;
+
+    LogEntry entry;
+    uint32_t at;
+    bool found = nextRecordLocked(r, entry, at);
+    uint32_t mtime = (uint32_t)r.file.getLastWrite();
+    r.file.close();
+    if (found && entry.timestamp > 1700000000) return entry.timestamp;
+
+    SegmentIndex idx;
+    if (loadIndexLocked(seq, idx, nullptr) && idx.maxTs > 1700000000) return idx.maxTs;
+    return mtime > 1700000000 ? mtime : 0;
+}
+
+// Date encoded in a legacy "log_YYYYMMDD.txt" name (0 for 1970 / garbage)
+static uint32_t legacyFileTime(const String& path) {
+    String d = path.substring(path.indexOf('_') + 1);
+    if (d.length() < 8) return 0;
+    char ts[20];
+    snprintf(ts, sizeof(ts), "%.4s-%.2s-%.2s 00:00:00",
+             d.c_str(), d.c_str() + 4, d.c_str() + 6);
+    uint32_t t = LogFormat::parseTimestamp(ts);
+    return t > 1700000000 ? t : 0;
+}
+
+// One bounded unit of work; returns false when the pass is finished
+static bool retentionStepLocked() {
+    uint32_t now = time(nullptr);
+
+    switch (retentionPhase) {
+
+    case RetentionPhase::SEGMENTS: {
+        // Segments are in time order: expire from the oldest until one is
+        // young enough. One LogSync hasn't finished uploading is kept; only
+        // the quota evicts it (and counts it in unsyncedEvictions).
+        if (firstSeq < activeSeq && synced.seq > firstSeq) {
+            uint32_t start = segmentStartTimeLocked(firstSeq);
+            if (start && now - start > MAX_DAYS_LOCAL * 86400UL) {
+                removeSegmentLocked(firstSeq);
+                firstSeq++;
+                stats.expiredCount++;
+                saveMetaLocked();
+                return true;
+            }
+        }
+        retentionDir = LittleFS.open("/");
+        retentionLegacyBytes = 0;
+        retentionPhase = RetentionPhase::LEGACY;
+        return (bool)retentionDir;
+    }
+
+    case RetentionPhase::LEGACY: {
+        // Old daily files: one directory entry per step
+        File f = retentionDir.openNextFile();
+        if (!f) {
+            retentionDir.close();
+            legacyBytes = retentionLegacyBytes;
+            return false;
+        }
+
+        String name = f.name();
+        if (!isLegacyLog(name.c_str())) return true;
+
+        String path = name.startsWith("/") ? name : "/" + name;
+        uint32_t fileTime = legacyFileTime(path);
+        uint32_t size = f.size();
+        f.close();
+
+        // 1970 files were written before NTP sync; the rest age out normally,
+        // and all of them go first when the quota is tight
+        bool expired   = !fileTime || now - fileTime > MAX_DAYS_LOCAL * 86400UL;
+        bool overQuota = usedBytes() > quotaBytes;
+        if (expired || overQuota) {
+            LOGI("[LOG] Removing legacy log %s (%s)\n",
+                 path.c_str(), expired ? "expired" : "quota");
+            LittleFS.remove(path);
+            if (expired) {
+                stats.expiredCount++;
+            } else {
+                stats.evictionCount++;
+                evictionsTotal.inc();
+            }
+            legacyBytes = legacyBytes > size ? legacyBytes - size : 0;
+        } else {
+            retentionLegacyBytes += size;
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+// ========== LEGACY DAILY FILES ==========
+// log_YYYYMMDD.txt from firmware before segments; read and uploaded by
+// LogSync, aged out by retention, never written.
+static void legacyPath(const String& name, String& out) {
+    out = name.startsWith("/") ? name : "/" + name;
+}
+
+static int clearLegacyLocked() {
+    int fileCount = 0;
+
+    // Legacy files: collect in batches (can't delete while iterating)
+    // and repeat until a pass finds none
+    while (true) {
+        String filesToDelete[32];
+        int batch = 0;
+
+        File root = LittleFS.open("/");
+        if (!root) {
+            LOGE("[LOG] Failed to open root for clearing\n");
+            break;
+        }
+        File file = root.openNextFile();
+        while (file && batch < 32) {
+            String name = String(file.name());
+            if (isLegacyLog(name.c_str())) {
+                legacyPath(name, filesToDelete[batch++]);
+            }
+            file.close();
+            file = root.openNextFile();
+        }
+        root.close();
+
+        if (batch == 0) break;
+
+        int removed = 0;
+        for (int i = 0; i < batch; i++) {
+            if (LittleFS.remove(filesToDelete[i])) {
+                LOGD("[LOG] Deleted: %s\n", filesToDelete[i].c_str());
+                removed++;
+            } else {
+                LOGE("[LOG] Failed to delete: %s\n", filesToDelete[i].c_str());
+            }
+        }
+        fileCount += removed;
+        if (removed == 0) break;   // avoid spinning on an undeletable file
+    }
+    return fileCount;
+}
+
+// ========== APPEND ==========
+static void appendLocked(uint32_t now, LogEvent evt, const char* uid, const char* info,
+                         uint8_t door) {
+    const size_t worst = LogCodec::HEADER_BYTES + LogCodec::MAX_RECORD_BYTES;
+
+    // Roll to a new segment at a record boundary rather than grow past the
+    // fixed size, so every buffered record's offset is known up front
+    if (activeSize + writeLen + worst > LOG_SEGMENT_BYTES) {
+        if (flushLocked()) rollActiveLocked();   // a failed flush has rolled already
+    }
+
+    // Flash unavailable: flushLocked() discards the stale batch rather than overrun
+    if (writeLen + worst > sizeof(writeBuf)) flushLocked();
+
+    if (writeLen == 0) oldestBuffered = millis();
+    if (evt <= LogEvent::REMOTE_UNLOCK) lastAccessMs = millis();
+    if (activeSize + writeLen == 0) {
+        writeLen += LogCodec::writeHeader(writeBuf, LOG_TZ_OFFSET_MINUTES);
+    }
+    uint32_t at = activeSize + writeLen;
+    writeLen += activeEncoder.encode(writeBuf + writeLen, now, evt, uid, info, door);
+    activeIndex.add(now, uid, at);
+    stats.recordCount++;
+    recordsTotal.inc();
+
+    bool durable = (uint8_t)evt < DURABILITY_COUNT &&
+                   durability[(uint8_t)evt] == LogDurability::IMMEDIATE;
+    if (durable || writeLen >= LOG_FLUSH_BYTES) {
+        flushLocked();
+    }
+}
+
+static void stashEarlyLocked(uint32_t now, LogEvent evt, const char* uid, const char* info,
+                             uint8_t door) {
+    if (earlyCount >= LOG_EARLY_RECORDS) {
+        stats.droppedCount++;
+        droppedTotal.inc();
+        return;
+    }
+    EarlyRecord& r = early[earlyCount++];
+    memset(&r, 0, sizeof(r));
+    r.timestamp = now;
+    r.evt       = evt;
+    r.door      = door;
+    strncpy(r.uid,  uid  ? uid  : "-", sizeof(r.uid) - 1);
+    strncpy(r.info, info ? info : "",  sizeof(r.info) - 1);
 }
 
 // ========== IMPLEMENTATION ==========
 void LogStore::init() {
     if (!LittleFS.begin(true)) {
-        Serial.println("[LOG] LittleFS mount failed");
+        LOGE("[LOG] LittleFS mount failed\n");
         return;
     }
 
-    cleanupOldLogs();
-    log(LogEvent::SYSTEM_BOOT, "-", "boot");
+    quotaBytes = LittleFS.totalBytes() / 100 * LOG_QUOTA_PERCENT;
+
+    uint8_t replayed;
+    {
+        // Core 1 may already be logging (into early[]): wait it out rather
+        // than race it, boot is not time critical
+        ThreadSafe::Guard guard(portMAX_DELAY);
+        if (!guard.isAcquired()) {
+            LOGE("[LOG] Mutex unavailable, log store not started\n");
+            return;
+        }
+        loadMetaLocked();
+        resumeActiveLocked();   // at most one segment read, no directory scan
+        ready = true;
+
+        // Retention is deferred to update() once NTP has set the clock
+        appendLocked(time(nullptr), LogEvent::SYSTEM_BOOT, "-", "boot", 0);
+        for (uint8_t i = 0; i < earlyCount; i++) {
+            const EarlyRecord& r = early[i];
+            appendLocked(r.timestamp, r.evt, r.uid, r.info, r.door);
+        }
+        replayed   = earlyCount;
+        earlyCount = 0;
+    }
+    LOGI("[LOG] Segments %lu..%lu, quota %lu bytes, %u early records\n",
+         (unsigned long)firstSeq, (unsigned long)activeSeq,
+         (unsigned long)quotaBytes, replayed);
 }
 
-void LogStore::log(LogEvent evt, const char* uid, const char* info) {
+void LogStore::log(LogEvent evt, const char* uid, const char* info, uint8_t door) {
     // CRITICAL: Lock mutex to prevent crash when Core 1 (RFID) and Core 0 (WiFi) access LittleFS simultaneously
     ThreadSafe::Guard guard(200);  // 200ms timeout
     if (!guard.isAcquired()) {
-        Serial.println("[LOG] Failed to acquire mutex, skipping log");
+        LOGW("[LOG] Failed to acquire mutex, skipping log\n");
+        stats.droppedCount++;
+        droppedTotal.inc();
         return;
     }
-    
-    String filename = "/log_" + currentDate() + ".txt";
 
-    File f = LittleFS.open(filename, FILE_APPEND);
-    if (!f) {
-        Serial.println("[LOG] Failed to open log file");
+    if (!ready) {
+        stashEarlyLocked(time(nullptr), evt, uid, info, door);
         return;
     }
+    appendLocked(time(nullptr), evt, uid, info, door);
+}
 
-    f.printf("%s | %s | %s | %s\n",
-             currentTimestamp().c_str(),
-             logEventToStr(evt),
-             uid,
-             info);
+void LogStore::update() {
+    if (!ready) return;
+    uint32_t now = millis();
 
-    f.close();
-}
+    // Age-based group commit. writeLen / oldestBuffered belong to the
+    // writer on Core 1: read them under the lock. Short timeout: Core 1
+    // may be mid-decision, retry next loop
+    {
+        ThreadSafe::Guard guard(20);
+        if (guard.isAcquired() && writeLen > 0 && now - oldestBuffered >= LOG_FLUSH_AGE_MS) {
+            flushLocked();
+        }
+    }
 
-void LogStore::cleanupOldLogs() {
-    File root = LittleFS.open("/");
-    if (!root) return;
-
-    time_t now = time(nullptr);
-
-    File f = root.openNextFile();
-    while (f) {
-        String name = f.name(); // /log_YYYYMMDD.txt or log_YYYYMMDD.txt
-        
-        // Handle both with and without leading slash
-        String logPrefix = name.startsWith("/") ? "/log_" : "log_";
-        
-        if (name.startsWith(logPrefix)) {
-            String date = name.substring(logPrefix.length(), logPrefix.length() + 8);
-            
-            // Delete 1970 logs (created before NTP sync)
-            if (date.startsWith("1970")) {
-                Serial.printf("[LOG] Deleting invalid 1970 log: %s\n", name.c_str());
-                f.close();
-                LittleFS.remove(name.startsWith("/") ? name : "/" + name);
-                f = root.openNextFile();
-                continue;
-            }
-            
-            struct tm t = {};
-            strptime(date.c_str(), "%Y%m%d", &t);
-            time_t fileTime = mktime(&t);
-
-            double days = difftime(now, fileTime) / 86400.0;
-            if (days > MAX_DAYS_LOCAL) {
-                f.close();
-                LittleFS.remove(name.startsWith("/") ? name : "/" + name);
-                f = root.openNextFile();
-                continue;
-            }
+    // Incremental retention, only once day math means something
+    if (retentionPhase == RetentionPhase::IDLE) {
+        if (!clockValid() || (int32_t)(now - nextRetentionMs) < 0) return;
+        retentionPhase = RetentionPhase::SEGMENTS;
+    }
+
+    ThreadSafe::Guard guard(20);
+    if (!guard.isAcquired()) return;
+
+    for (uint8_t i = 0; i < LOG_RETENTION_STEPS_PER_UPDATE; i++) {
+        if (!retentionStepLocked()) {
+            retentionPhase  = RetentionPhase::IDLE;
+            nextRetentionMs = now + LOG_RETENTION_INTERVAL_MS;
+            break;
         }
-        f = root.openNextFile();
     }
 }
 
-void LogStore::forEach(std::function<void(const LogEntry&)> callback) {
-    // Lock mutex to prevent crash during file iteration
-    ThreadSafe::Guard guard(500);  // 500ms timeout for longer operation
+void LogStore::flush() {
+    if (!ready) return;
+    ThreadSafe::Guard guard(200);
     if (!guard.isAcquired()) {
-        Serial.println("[LOG] Failed to acquire mutex for forEach");
-        return;
-    }
-    
-    File root = LittleFS.open("/");
-    if (!root) {
-        Serial.println("[LOG] Failed to open root");
+        LOGW("[LOG] Failed to acquire mutex for flush\n");
         return;
     }
+    flushLocked();
+}
 
-    Serial.println("[LOG] Scanning log files...");
+void LogStore::setDurability(LogEvent evt, LogDurability d) {
+    if ((uint8_t)evt < DURABILITY_COUNT) durability[(uint8_t)evt] = d;
+}
 
-    File file = root.openNextFile();
-    while (file) {
-        String name = String(file.name());
-        Serial.printf("[LOG] Found file: %s\n", name.c_str());
-        
-        // Check for log files (name is "log_YYYYMMDD.txt" without leading slash)
-        if (name.startsWith("log_") || name.startsWith("/log_")) {
-            Serial.printf("[LOG] Processing: %s\n", name.c_str());
-            
-            // Read each line from log file
-            while (file.available()) {
-                String line = file.readStringUntil('\n');
-                line.trim();
-                
-                if (line.length() < 10) continue;
-
-                // Parse: "2026-01-20 20:45:03 | ACCESS_GRANTED | A1B2C3D4 | info"
-                int pipe1 = line.indexOf('|');
-                int pipe2 = line.indexOf('|', pipe1 + 1);
-                int pipe3 = line.indexOf('|', pipe2 + 1);
-
-                if (pipe1 < 0 || pipe2 < 0 || pipe3 < 0) continue;
-
-                String timestamp = line.substring(0, pipe1);
-                String eventStr = line.substring(pipe1 + 1, pipe2);
-                String uid = line.substring(pipe2 + 1, pipe3);
-                String info = line.substring(pipe3 + 1);
-
-                timestamp.trim();
-                eventStr.trim();
-                uid.trim();
-                info.trim();
-
-                LogEntry entry = {};
-                entry.timestamp = 0;
-                
-                // Store the timestamp string for syncing
-                strncpy(entry.timestampStr, timestamp.c_str(), sizeof(entry.timestampStr) - 1);
-                entry.timestampStr[sizeof(entry.timestampStr) - 1] = '\0';
-                
-                // Map event string to enum (support both old and new names)
-                if (eventStr == "ACCESS_GRANTED" || eventStr == "RFID_GRANTED") 
-                    entry.event = LogEvent::ACCESS_GRANTED;
-                else if (eventStr == "ACCESS_DENIED" || eventStr == "RFID_DENIED") 
-                    entry.event = LogEvent::ACCESS_DENIED;
-                else if (eventStr == "UNKNOWN_CARD" || eventStr == "RFID_PENDING") 
-                    entry.event = LogEvent::UNKNOWN_CARD;
-                else if (eventStr == "REMOTE_UNLOCK") 
-                    entry.event = LogEvent::REMOTE_UNLOCK;
-                else 
-                    continue; // Skip non-access events
-
-                strncpy(entry.uid, uid.c_str(), sizeof(entry.uid) - 1);
-                strncpy(entry.info, info.c_str(), sizeof(entry.info) - 1);
+LogStats LogStore::getStats() {
+    LogStats s = stats;
+    s.bufferedBytes = writeLen;
+    s.segmentCount  = activeSeq - firstSeq + 1;
+    s.storedBytes   = usedBytes();
+    s.quotaBytes    = quotaBytes;
+    s.unsyncedBytes = unsyncedBytes();
+    s.lastAccessMs  = lastAccessMs;
+    return s;
+}
 
+// ========== QUERY ==========
+static bool queryMatches(const LogQuery& q, uint32_t to, const LogEntry& e) {
+    if (e.timestamp < q.from || e.timestamp > to) return false;
+    if (q.events && !(q.events & logEventBit(e.event))) return false;
+    return !q.uid || !q.uid[0] || strcmp(e.uid, q.uid) == 0;
+}
+
+LogQueryResult LogStore::query(const LogQuery& q, LogCursor start, uint16_t limit,
+                               std::function<void(const LogEntry&)> callback) {
+    LogQueryResult r = {};
+    uint32_t to = q.to ? q.to : 0xFFFFFFFFUL;
+    uint32_t seq = start.seq;
+    uint32_t offset = start.offset;
+
+    // One segment per lock hold, so the access path on Core 1 never waits
+    // behind a long query
+    while (true) {
+        ThreadSafe::Guard guard(200);
+        if (!guard.isAcquired()) {
+            LOGW("[LOG] Failed to acquire mutex for query\n");
+            r.more = true;
+            break;
+        }
+
+        if (seq < firstSeq) {   // evicted / never existed: start at the oldest
+            seq = firstSeq;
+            offset = 0;
+        }
+        if (seq > activeSeq) break;
+
+        bool active = (seq == activeSeq);
+        if (active) flushLocked();
+
+        // Index + final dictionary: the active segment's live in RAM
+        readDecoder.reset();
+        SegmentIndex stored;
+        const SegmentIndex* idx = nullptr;
+        if (active) {
+            if (activeIndexComplete) {
+                idx = &activeIndex;
+                readDecoder.dict = activeEncoder.dict;
+            }
+        } else if (loadIndexLocked(seq, stored, &readDecoder.dict)) {
+            idx = &stored;
+        } else {
+            readDecoder.dict.reset();
+        }
+
+        if (idx) {
+            if (!idx->overlaps(q.from, to) || (q.uid && !idx->mayContainUid(q.uid))) {
+                r.segmentsSkipped++;
+                if (active) {
+                    offset = max(offset, activeSize);
+                    break;
+                }
+                seq++;
+                offset = 0;
+                continue;
+            }
+            if (q.from) offset = max(offset, idx->seekOffset(q.from));
+        }
+
+        SegmentReader reader;
+        if (!openSegmentLocked(seq, reader)) {
+            seq++;
+            offset = 0;
+            continue;
+        }
+        r.segmentsScanned++;
+
+        // Text records can be entered anywhere; binary ones from the nearest
+        // checkpoint, decoding forward to the wanted offset. Without an index
+        // a binary segment is decoded from its header.
+        if (!reader.binary) {
+            seekReaderLocked(reader, offset, 0);
+        } else if (idx) {
+            const SegmentIndex::Checkpoint* cp = idx->checkpointAtOrBefore(offset);
+            if (cp) seekReaderLocked(reader, cp->offset, cp->timestamp);
+        }
+
+        // A full pass over an unindexed segment leaves an index behind
+        bool building = !idx && (reader.binary || offset == 0);
+        SegmentIndex built;
+        if (building) built.reset();
+
+        bool stop = false;
+        LogEntry entry;
+        uint32_t at;
+        uint32_t readStart = reader.offset();
+        while (nextRecordLocked(reader, entry, at)) {
+            if (building) built.add(entry.timestamp, entry.uid, at);
+            if (at < offset) continue;
+
+            if (queryMatches(q, to, entry)) {
+                if (r.matched >= limit) {
+                    offset = at;
+                    stop = true;
+                    break;
+                }
                 callback(entry);
+                r.matched++;
+            }
+
+            if (r.bytesRead + (reader.offset() - readStart) >= LOG_QUERY_SCAN_BUDGET) {
+                offset = reader.offset();
+                stop = true;
+                break;
             }
         }
-        file = root.openNextFile();
+        r.bytesRead += reader.offset() - readStart;
+        reader.file.close();
+
+        if (building && !stop && !reader.corrupt && !active) {
+            saveIndexLocked(seq, built, readDecoder.dict);
+        }
+
+        if (stop) {
+            r.more = true;
+            break;
+        }
+        if (active) {
+            // Stay on the active segment: later records are appended here
+            offset = max(offset, reader.offset());
+            break;
+        }
+        seq++;
+        offset = 0;
     }
-    Serial.println("[LOG] Done scanning");
+
+    r.next = { seq, offset };
+    return r;
 }
 
 void LogStore::clearAllLogs() {
     // Lock mutex to prevent crash during file deletion
     ThreadSafe::Guard guard(500);  // 500ms timeout
     if (!guard.isAcquired()) {
-        Serial.println("[LOG] Failed to acquire mutex for clearAllLogs");
+        LOGW("[LOG] Failed to acquire mutex for clearAllLogs\n");
         return;
     }
-    
-    File root = LittleFS.open("/");
-    if (!root) {
-        Serial.println("[LOG] Failed to open root for clearing");
+
+    LOGI("[LOG] Clearing all log files...\n");
+
+    // Drop buffered records and the open handle, then every segment
+    writeLen = 0;
+    if (activeFile) activeFile.close();
+
+    int fileCount = 0;
+    for (uint32_t seq = firstSeq; seq <= activeSeq; seq++) {
+        removeSegmentLocked(seq);
+        fileCount++;
+    }
+    firstSeq = activeSeq = activeSeq + 1;
+    resetActiveStateLocked();
+    saveMetaLocked();
+
+    // Abort any retention pass holding the directory open
+    if (retentionDir) retentionDir.close();
+    retentionPhase = RetentionPhase::IDLE;
+
+    fileCount += clearLegacyLocked();
+    legacyBytes = 0;
+
+    LOGI("[LOG] Cleared %d log files\n", fileCount);
+}
+
+// ========== SYNC SUPPORT ==========
+bool LogStore::syncedCursor(LogCursor& out) {
+    ThreadSafe::Guard guard(200);
+    if (!guard.isAcquired()) {
+        LOGW("[LOG] Failed to acquire mutex for sync cursor\n");
+        return false;
+    }
+    out = synced;
+    return true;
+}
+
+void LogStore::setSyncedCursor(LogCursor c) {
+    ThreadSafe::Guard guard(200);
+    if (!guard.isAcquired()) {
+        LOGW("[LOG] Failed to acquire mutex for sync cursor\n");
         return;
     }
+    synced = c;
+    saveMetaLocked();
+}
 
-    Serial.println("[LOG] Clearing all log files...");
-    
-    // Collect files to delete first (can't delete while iterating)
-    String filesToDelete[32];
-    int fileCount = 0;
+String LogStore::oldestLegacyLog() {
+    ThreadSafe::Guard guard(200);
+    if (!guard.isAcquired()) return String();
+
+    String oldest;
+    File root = LittleFS.open("/");
+    if (!root) return oldest;
 
     File file = root.openNextFile();
-    while (file && fileCount < 32) {
-        String name = String(file.name());
-        
-        // Check for log files
-        if (name.startsWith("log_") || name.startsWith("/log_")) {
-            // Store full path
-            if (name.startsWith("/")) {
-                filesToDelete[fileCount++] = name;
-            } else {
-                filesToDelete[fileCount++] = "/" + name;
-            }
-        }
+    while (file) {
+        String name = file.name();
         file.close();
+        if (isLegacyLog(name.c_str())) {
+            String path;
+            legacyPath(name, path);
+            if (oldest.length() == 0 || strcmp(path.c_str(), oldest.c_str()) < 0) oldest = path;
+        }
         file = root.openNextFile();
     }
     root.close();
+    return oldest;
+}
 
-    // Now delete all collected files
-    for (int i = 0; i < fileCount; i++) {
-        if (LittleFS.remove(filesToDelete[i])) {
-            Serial.printf("[LOG] Deleted: %s\n", filesToDelete[i].c_str());
-        } else {
-            Serial.printf("[LOG] Failed to delete: %s\n", filesToDelete[i].c_str());
-        }
+int LogStore::readLegacy(const String& path, uint32_t skip, uint16_t maxRecords,
+                         std::function<void(const LogEntry&)> callback) {
+    ThreadSafe::Guard guard(500);
+    if (!guard.isAcquired()) {
+        LOGW("[LOG] Failed to acquire mutex for readLegacy\n");
+        return -1;
     }
 
-    Serial.printf("[LOG] Cleared %d log files\n", fileCount);
+    readDecoder.reset();
+    SegmentReader r;
+    if (!openReaderLocked(path.c_str(), r)) return -1;
+
+    int count = 0;
+    uint32_t index = 0;
+    LogEntry entry;
+    uint32_t at;
+    while (count < maxRecords && nextRecordLocked(r, entry, at)) {
+        if (index++ < skip) continue;
+        callback(entry);
+        count++;
+    }
+    r.file.close();
+    return count;
+}
+
+void LogStore::removeLegacyLog(const String& path) {
+    ThreadSafe::Guard guard(200);
+    if (!guard.isAcquired()) return;
+
+    File f = LittleFS.open(path, FILE_READ);
+    uint32_t size = f ? f.size() : 0;
+    if (f) f.close();
+
+    if (LittleFS.remove(path)) {
+        legacyBytes = legacyBytes > size ? legacyBytes - size : 0;
+        LOGI("[LOG] Removed synced legacy log %s\n", path.c_str());
+    }
 }
@@ -24,17 +24,95 @@ struct LogEntry {
     char uid[16];
     char info[32];
     char timestampStr[30];  // Original timestamp string with timezone for syncing
+    uint8_t door;           // 0 for single-door installs and text records
+};
+
+// How quickly a record must reach flash
+enum class LogDurability : uint8_t {
+    GROUP,      // buffered, flushed on size / age / demand
+    IMMEDIATE   // flushed before log() returns
+};
+
+struct LogStats {
+    uint32_t recordCount;    // lines accepted by log()
+    uint32_t flushCount;     // physical appends to LittleFS
+    uint32_t bytesWritten;
+    uint32_t droppedCount;   // mutex timeouts
+    uint32_t bufferedBytes;  // currently waiting in RAM
+
+    // Segmented storage
+    uint32_t segmentCount;   // including the active segment
+    uint32_t storedBytes;    // segments + legacy daily files
+    uint32_t quotaBytes;     // share of LittleFS allowed for logs
+    uint32_t evictionCount;  // segments dropped to stay under quota (persisted)
+    uint32_t expiredCount;   // files removed by day-based retention
+
+    // Cloud sync
+    uint32_t unsyncedBytes;      // after the synced cursor
+    uint32_t unsyncedEvictions;  // segments evicted before they were uploaded
+    uint32_t lastAccessMs;       // millis() of the latest door event
+};
+
+// Position in the segment log; seq 0 = from the oldest segment
+struct LogCursor {
+    uint32_t seq;
+    uint32_t offset;
+};
+
+struct LogQuery {
+    const char* uid;     // nullptr / "" = any card
+    uint32_t    from;    // epoch seconds, inclusive (0 = unbounded)
+    uint32_t    to;      // epoch seconds, inclusive (0 = unbounded)
+    uint16_t    events;  // logEventBit() mask (0 = every event type)
+};
+
+inline uint16_t logEventBit(LogEvent e) { return (uint16_t)(1u << (uint8_t)e); }
+
+struct LogQueryResult {
+    uint16_t  matched;
+    uint16_t  segmentsScanned;
+    uint16_t  segmentsSkipped;   // ruled out by their index alone
+    uint32_t  bytesRead;
+    bool      more;              // call again with `next` for the next page
+    LogCursor next;
 };
 
 class LogStore {
 public:
+    // Mounts LittleFS. Records logged before this (the access task starts
+    // first) are held in RAM and written here, behind SYSTEM_BOOT.
     static void init();
 
     static void log(LogEvent evt,
                     const char* uid = "-",
-                    const char* info = "");
+                    const char* info = "",
+                    uint8_t door = 0);
+
+    static void update();           // Core 0 loop - age-based flush + incremental retention
+    static void flush();            // force buffered lines to flash
+
+    static void setDurability(LogEvent evt, LogDurability d);
+    static LogStats getStats();
+
+    // Indexed lookup over all segments, oldest first. Returns at most
+    // `limit` matches; legacy daily files are not indexed. Each segment is
+    // read under its own lock hold and nothing is held between calls, so
+    // a full walk is a loop over pages: `next` is a plain position that
+    // can be stored (LogSync persists one) and resumed from later.
+    static LogQueryResult query(const LogQuery& q, LogCursor start, uint16_t limit,
+                                std::function<void(const LogEntry&)> callback);
+    static void clearAllLogs();     // Delete all log files (serial debug)
+
+    // Upload position for LogSync, persisted with the segment metadata.
+    // Feed it to query() with an empty LogQuery to read what comes next.
+    // syncedCursor() returns false if the store was busy.
+    static bool syncedCursor(LogCursor& out);
+    static void setSyncedCursor(LogCursor c);
 
-    static void forEach(std::function<void(const LogEntry&)> callback);
-    static void cleanupOldLogs();   // >30 days
-    static void clearAllLogs();     // Delete all log files after successful sync
+    // Legacy daily files, uploaded oldest first then removed
+    static String oldestLegacyLog();     // "" when none are left
+    // Records [skip, skip + maxRecords) of one file; -1 if it can't be read
+    static int readLegacy(const String& path, uint32_t skip, uint16_t maxRecords,
+                          std::function<void(const LogEntry&)> callback);
+    static void removeLegacyLog(const String& path);
 };
@@ -2,14 +2,35 @@
 #include <nvs.h>
 #include <functional>
 #include <ctype.h>
+#include "../config/config.h"
+#include "../core/metrics.h"
+#include "../core/console_log.h"
+#include "../core/thread_safe.h"
+
+#define CONSOLE_LOG_LEVEL CONSOLE_LEVEL_NVS
 
 // Namespaces
-static const char* NS_WL = "wl";
-static const char* NS_BL = "bl";
-static const char* NS_PD = "pd";
+static const char* NS_WL  = "wl";
+static const char* NS_BL  = "bl";
+static const char* NS_PD  = "pd";
+static const char* NS_SYS = "sys";
 
 static const uint8_t MAX_UIDS = 50;
 
+static const char* LEGACY_COUNT_KEY = "__count";
+static const char* KEY_LAST_CMD     = "last_cmd";
+static const char* KEY_WEAR         = "wear_ent";
+
+// NVS geometry: 4 KB pages of 126 usable 32-byte entries
+static const uint16_t ENTRIES_PER_PAGE = 126;
+static const uint8_t  ENTRY_BYTES      = 32;
+
+static uint32_t stateGeneration = 0;   // read from the decision task without the mutex
+
+static void bumpGeneration() {
+    __atomic_fetch_add(&stateGeneration, 1, __ATOMIC_RELEASE);
+}
+
 // ================= UID NORMALISATION =================
 // NVS keys are case-sensitive.  RFID reader emits uppercase
 // (%02X) but UIDs arriving from Supabase may be lowercase or
@@ -29,41 +50,343 @@ static void normalizeUID(const char* uid, char* out, size_t outSize) {
     out[j] = '\0';
 }
 
-Preferences NVSStore::wl;
-Preferences NVSStore::bl;
-Preferences NVSStore::pd;
+// ================= RAM MIRROR =================
+// One set per UID namespace, loaded at init and kept in step with flash
+// (or ahead of it, inside a batch). A list that outgrows the set is
+// "spilled": the keys that did not fit live only in flash, lookups fall
+// back to prefs.isKey() and its writes are never deferred, so a commit
+// never has to tell an unloaded key from a stale one.
+enum List : uint8_t { WL = 0, BL, PD, LIST_COUNT };
+
+struct UidSet {
+    char    keys[NVS_UID_CAPACITY][16];
+    uint8_t count;
+    bool    spilled;
+
+    int find(const char* key) const {
+        for (uint8_t i = 0; i < count; i++) {
+            if (strcmp(keys[i], key) == 0) return i;
+        }
+        return -1;
+    }
+    bool add(const char* key) {
+        if (find(key) >= 0) return true;
+        if (count >= NVS_UID_CAPACITY) return false;
+        strncpy(keys[count], key, sizeof(keys[0]) - 1);
+        keys[count][sizeof(keys[0]) - 1] = '\0';
+        count++;
+        return true;
+    }
+    bool remove(const char* key) {
+        int i = find(key);
+        if (i < 0) return false;
+        if (i != count - 1) memcpy(keys[i], keys[count - 1], sizeof(keys[0]));
+        count--;
+        return true;
+    }
+};
+
+static Preferences prefs[LIST_COUNT];
+static Preferences sys;
+static UidSet      mirror[LIST_COUNT];
+static const char* const LIST_NS[LIST_COUNT] = { NS_WL, NS_BL, NS_PD };
+
+static bool batching = false;
 
+static bool contains(List l, const char* norm) {
+    return mirror[l].find(norm) >= 0 || (mirror[l].spilled && prefs[l].isKey(norm));
+}
 
-// ================= COUNT HELPERS =================
-static uint8_t getCount(Preferences& p) {
-    return p.getUChar("__count", 0);
+// Writes to a spilled list go straight to flash, batch or not
+static bool deferred(List l) {
+    return batching && !mirror[l].spilled;
 }
 
-static void setCount(Preferences& p, uint8_t v) {
-    p.putUChar("__count", v);
+// ================= WRITE ACCOUNTING =================
+static char     lastCmd[48]      = "";
+static bool     lastCmdDirty     = false;
+static uint32_t lastCmdChangedMs = 0;
+
+static NVSWriteStats wstats = {};
+static uint32_t      wearCheckpointed = 0;   // lifetimeEntries last written
+static uint32_t      lastWearCheckMs  = 0;
+
+static const uint32_t WRITES_PER_OP_BOUNDS[] = { 0, 1, 2, 3, 4, 8, 16, 64 };
+
+static Counter   opsTotal("emlock_nvs_ops_total", "Logical NVSStore mutations (a batch counts once)");
+static Counter   putsTotal("emlock_nvs_writes_total", "Physical NVS writes", "kind=\"put\"");
+static Counter   erasesTotal("emlock_nvs_writes_total", "Physical NVS writes", "kind=\"erase\"");
+static Counter   coalescedTotal("emlock_nvs_coalesced_writes_total", "NVS writes avoided by batching and lazy checkpoints");
+static Histogram writesPerOp("emlock_nvs_writes_per_op", "Physical NVS writes per logical operation",
+                             WRITES_PER_OP_BOUNDS, sizeof(WRITES_PER_OP_BOUNDS) / sizeof(WRITES_PER_OP_BOUNDS[0]));
+static Gauge     lifetimeEntriesGauge("emlock_nvs_lifetime_entries", "NVS entries written since first boot (estimate)");
+static Gauge     sectorErasesGauge("emlock_nvs_sector_erases_estimate", "Estimated erase cycles per NVS sector");
+
+// NVS appends entries page by page and erases a page once its live
+// entries are moved out, so every page is erased about once per
+// ENTRIES_PER_PAGE * pages entries written
+static void publishWear() {
+    lifetimeEntriesGauge.set((int32_t)wstats.lifetimeEntries);
+    if (wstats.pages) {
+        wstats.sectorErasesEstimate = wstats.lifetimeEntries / ((uint32_t)ENTRIES_PER_PAGE * wstats.pages);
+        sectorErasesGauge.set((int32_t)wstats.sectorErasesEstimate);
+    }
 }
 
-static void incCount(Preferences& p) {
-    setCount(p, getCount(p) + 1);
+static void notePut(uint16_t entries) {
+    wstats.physicalWrites++;
+    wstats.entriesWritten  += entries;
+    wstats.lifetimeEntries += entries;
+    putsTotal.inc();
+    publishWear();
 }
 
-static void decCount(Preferences& p) {
-    uint8_t c = getCount(p);
-    if (c > 0) setCount(p, c - 1);
+static void noteErase(uint16_t n = 1) {
+    wstats.physicalWrites += n;
+    erasesTotal.inc(n);
 }
 
-// ================= INIT =================
-static const char* NS_SYS = "sys";
-Preferences NVSStore::sys;
+static void noteCoalesced(uint32_t n = 1) {
+    wstats.coalescedWrites += n;
+    coalescedTotal.inc(n);
+}
+
+// One logical operation; writes made inside a batch are charged to the commit
+struct OpScope {
+    uint32_t before;
+    OpScope() : before(wstats.physicalWrites) {}
+    ~OpScope() {
+        if (batching) return;
+        wstats.logicalOps++;
+        opsTotal.inc();
+        writesPerOp.observe(wstats.physicalWrites - before);
+    }
+};
+
+// A string entry: one header entry plus the data span
+static uint16_t stringEntries(const char* s) {
+    return 1 + (strlen(s) + 1 + ENTRY_BYTES - 1) / ENTRY_BYTES;
+}
+
+// ================= FLASH OPERATIONS =================
+static bool putKey(List l, const char* key) {
+    if (prefs[l].putUChar(key, 1) == 0) {
+        LOGE("[NVS] ERROR: putUChar FAILED for %s key %s (NVS full?)\n", LIST_NS[l], key);
+        return false;
+    }
+    notePut(1);
+    return true;
+}
+
+static void eraseKey(List l, const char* key) {
+    prefs[l].remove(key);
+    noteErase();
+}
+
+static void loadList(List l) {
+    UidSet& set = mirror[l];
+    set.count   = 0;
+    set.spilled = false;
+    bool legacyCount = false;
+
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, LIST_NS[l], NVS_TYPE_ANY);
+    while (it != NULL) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        if (strcmp(info.key, LEGACY_COUNT_KEY) == 0) {
+            legacyCount = true;
+        } else if (!set.add(info.key) && !set.spilled) {
+            LOGW("[NVS] %s holds more than %u UIDs, the rest are looked up in flash\n",
+                 LIST_NS[l], NVS_UID_CAPACITY);
+            set.spilled = true;
+        }
+        it = nvs_entry_next(it);
+    }
+    nvs_release_iterator(it);
+
+    // Counts are derived from the mirror now; drop the stale counter once
+    if (legacyCount) {
+        prefs[l].remove(LEGACY_COUNT_KEY);
+        noteErase();
+    }
+}
+
+// Erases the flash keys of list `l` the mirror no longer has. The
+// iterator must be released before erasing, so stale keys go in chunks,
+// re-walking the namespace until none is left. Returns the entries found
+// (what clearing the list unbatched would have cost).
+static uint32_t eraseStale(List l) {
+    uint32_t found = 0;
+    char stale[16][16];
+    bool more;
+    bool first = true;
+    do {
+        uint8_t staleCount = 0;
+        more = false;
+
+        nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, LIST_NS[l], NVS_TYPE_ANY);
+        while (it != NULL) {
+            nvs_entry_info_t info;
+            nvs_entry_info(it, &info);
+            if (first) found++;
+            if (mirror[l].find(info.key) < 0) {
+                if (staleCount < 16) {
+                    strncpy(stale[staleCount], info.key, sizeof(stale[0]) - 1);
+                    stale[staleCount][sizeof(stale[0]) - 1] = '\0';
+                    staleCount++;
+                } else {
+                    more = true;
+                }
+            }
+            it = nvs_entry_next(it);
+        }
+        nvs_release_iterator(it);
+
+        for (uint8_t i = 0; i < staleCount; i++) eraseKey(l, stale[i]);
+        first = false;
+    } while (more);
+    return found;
+}
+
+// Writes the mirror of every non-spilled list to flash: erases first, so
+// a UID moving between lists never sits in two. Returns what the same
+// calls would have written unbatched (clear + re-add).
+static uint32_t flushMirror() {
+    uint32_t naive = 0;
+    for (uint8_t l = 0; l < LIST_COUNT; l++) {
+        if (!mirror[l].spilled) naive += eraseStale((List)l);
+    }
+    for (uint8_t l = 0; l < LIST_COUNT; l++) {
+        if (mirror[l].spilled) continue;
+        naive += mirror[l].count;
+        for (uint8_t i = 0; i < mirror[l].count; i++) {
+            if (!prefs[l].isKey(mirror[l].keys[i])) putKey((List)l, mirror[l].keys[i]);
+        }
+    }
+    return naive;
+}
+
+// Drops `norm` from list `l`, in flash too unless the write is deferred
+static bool removeFrom(List l, const char* norm) {
+    bool inMirror = mirror[l].remove(norm);
+    if (deferred(l)) return inMirror;
+    if (inMirror || (mirror[l].spilled && prefs[l].isKey(norm))) {
+        eraseKey(l, norm);
+        return true;
+    }
+    return false;
+}
+
+// Moves `key` into list `target` (flash unless batching, mirror always)
+static bool addExclusive(List target, const char* uid, bool bypassLimit) {
+    char norm[16];
+    normalizeUID(uid, norm, sizeof(norm));
+
+    if (!bypassLimit && mirror[target].count >= MAX_UIDS && !contains(target, norm)) {
+        LOGW("[NVS] Capacity reached (%d/%d), cannot add %s\n",
+             mirror[target].count, MAX_UIDS, norm);
+        return false;
+    }
+
+    bumpGeneration();
+
+    // Remove from other namespaces silently
+    for (uint8_t l = 0; l < LIST_COUNT; l++) {
+        if (l != target) removeFrom((List)l, norm);
+    }
+
+    // Add to target if not present
+    if (contains(target, norm)) return true;
+    if (!mirror[target].add(norm)) {
+        // Only a bypass-limit sync gets here: keep the rest in flash alone.
+        // Deferred changes to this list are flushed first, from then on
+        // it is written through.
+        if (!mirror[target].spilled) {
+            LOGW("[NVS] %s over %u UIDs, the rest are looked up in flash\n",
+                 LIST_NS[target], NVS_UID_CAPACITY);
+            if (batching) flushMirror();
+            mirror[target].spilled = true;
+        }
+        for (uint8_t l = 0; l < LIST_COUNT; l++) {
+            if (l != target && prefs[l].isKey(norm)) eraseKey((List)l, norm);   // removal still deferred
+        }
+        return putKey(target, norm);
+    }
+    if (!deferred(target) && !putKey(target, norm)) {
+        mirror[target].remove(norm);
+        return false;
+    }
+    LOGD("[NVS] Stored key=%s count=%d\n", norm, mirror[target].count);
+    return true;
+}
 
+static void clearList(List l) {
+    bumpGeneration();
+    uint8_t n = mirror[l].count;
+    mirror[l].count = 0;
+    if (deferred(l)) return;
+    if (mirror[l].spilled) {
+        // Flash holds keys the mirror never had: clear it now
+        mirror[l].spilled = false;
+        prefs[l].clear();
+        noteErase(n);
+        return;
+    }
+    if (n == 0) {
+        noteCoalesced();   // nothing stored, nothing to erase
+        return;
+    }
+    prefs[l].clear();
+    noteErase(n);
+}
+
+// ================= INIT =================
 
 void NVSStore::init() {
-    wl.begin(NS_WL, false);
-    bl.begin(NS_BL, false);
-    pd.begin(NS_PD, false);
+    for (uint8_t l = 0; l < LIST_COUNT; l++) {
+        prefs[l].begin(LIST_NS[l], false);
+        loadList((List)l);
+    }
     sys.begin(NS_SYS, false);
 
-    Serial.println("[NVS] Store initialized");
+    String cmd = sys.getString(KEY_LAST_CMD, "");
+    strncpy(lastCmd, cmd.c_str(), sizeof(lastCmd) - 1);
+    wstats.lifetimeEntries = sys.getUInt(KEY_WEAR, 0);
+    wearCheckpointed       = wstats.lifetimeEntries;
+
+    nvs_stats_t st;
+    if (nvs_get_stats(NVS_DEFAULT_PART_NAME, &st) == ESP_OK) {
+        wstats.pages = st.total_entries / ENTRIES_PER_PAGE;
+    }
+    publishWear();
+
+    LOGI("[NVS] Store initialized: WL=%u BL=%u PD=%u, %u pages, ~%lu erases/sector\n",
+         mirror[WL].count, mirror[BL].count, mirror[PD].count, wstats.pages,
+         (unsigned long)wstats.sectorErasesEstimate);
+}
+
+void NVSStore::update() {
+    // Core 1 updates wstats from addToPending(); short timeout, retry next loop
+    ThreadSafe::Guard guard(20);
+    if (!guard.isAcquired()) return;
+
+    uint32_t now = millis();
+    bool cmdDue  = lastCmdDirty && now - lastCmdChangedMs >= NVS_CMD_CHECKPOINT_MS;
+    bool wearDue = wstats.lifetimeEntries != wearCheckpointed &&
+                   now - lastWearCheckMs >= NVS_WEAR_CHECKPOINT_MS;
+    if (!cmdDue && !wearDue) return;
+
+    if (cmdDue) {
+        sys.putString(KEY_LAST_CMD, lastCmd);
+        notePut(stringEntries(lastCmd));
+        lastCmdDirty = false;
+    }
+    if (wearDue) {
+        lastWearCheckMs = now;
+        notePut(1);   // counts itself
+        sys.putUInt(KEY_WEAR, wstats.lifetimeEntries);
+        wearCheckpointed = wstats.lifetimeEntries;
+    }
 }
 
 
@@ -73,200 +396,240 @@ void NVSStore::init() {
 bool NVSStore::isWhitelisted(const char* uid) {
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
-    bool found = wl.isKey(norm);
-    Serial.printf("[NVS] isWhitelisted(%s) norm=%s -> %s\n", uid, norm, found ? "YES" : "NO");
+    bool found = contains(WL, norm);
+    LOGD("[NVS] isWhitelisted(%s) norm=%s -> %s\n", uid, norm, found ? "YES" : "NO");
     return found;
 }
 
 bool NVSStore::isBlacklisted(const char* uid) {
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
-    return bl.isKey(norm);
+    return contains(BL, norm);
 }
 
 bool NVSStore::isPending(const char* uid) {
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
-    return pd.isKey(norm);
+    return contains(PD, norm);
 }
 
 UIDState NVSStore::getState(const char* uid) {
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
-    if (wl.isKey(norm)) return UIDState::WHITELIST;
-    if (bl.isKey(norm)) return UIDState::BLACKLIST;
-    if (pd.isKey(norm)) return UIDState::PENDING;
+    if (contains(WL, norm)) return UIDState::WHITELIST;
+    if (contains(BL, norm)) return UIDState::BLACKLIST;
+    if (contains(PD, norm)) return UIDState::PENDING;
     return UIDState::NONE;
 }
 
 // ================= MUTATIONS =================
 
-bool NVSStore::addExclusive(Preferences& target, const char* uid, bool bypassLimit) {
-    char norm[16];
-    normalizeUID(uid, norm, sizeof(norm));
-
-    if (!bypassLimit && getCount(target) >= MAX_UIDS) {
-        Serial.printf("[NVS] Capacity reached (%d/%d), cannot add %s\n",
-                      getCount(target), MAX_UIDS, norm);
-        return false;
-    }
-
-    // Remove from other namespaces silently
-    if (&target != &wl && wl.isKey(norm)) {
-        wl.remove(norm);
-        decCount(wl);
-    }
-    if (&target != &bl && bl.isKey(norm)) {
-        bl.remove(norm);
-        decCount(bl);
-    }
-    if (&target != &pd && pd.isKey(norm)) {
-        pd.remove(norm);
-        decCount(pd);
-    }
-
-    // Add to target if not present
-    if (!target.isKey(norm)) {
-        size_t written = target.putUChar(norm, 1);
-        if (written == 0) {
-            Serial.printf("[NVS] ERROR: putUChar FAILED for key %s (NVS full?)\n", norm);
-            return false;
-        }
-        incCount(target);
-        Serial.printf("[NVS] Stored key=%s count=%d\n", norm, getCount(target));
-    }
-
-    return true;
-}
-
 bool NVSStore::addToWhitelist(const char* uid, bool bypassLimit) {
-    return addExclusive(wl, uid, bypassLimit);
+    OpScope op;
+    return addExclusive(WL, uid, bypassLimit);
 }
 
 bool NVSStore::addToBlacklist(const char* uid, bool bypassLimit) {
-    return addExclusive(bl, uid, bypassLimit);
+    OpScope op;
+    return addExclusive(BL, uid, bypassLimit);
 }
 
 bool NVSStore::addToPending(const char* uid) {
+    OpScope op;
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
 
-    Serial.printf("[NVS] addToPending called for: %s (normalised: %s)\n", uid, norm);
+    LOGD("[NVS] addToPending called for: %s (normalised: %s)\n", uid, norm);
 
     // Check each namespace with the SAME local buffer (no re-normalization needed)
-    if (wl.isKey(norm)) {
-        Serial.printf("[NVS] UID %s already in WHITELIST, not adding to pending\n", norm);
+    if (contains(WL, norm)) {
+        LOGD("[NVS] UID %s already in WHITELIST, not adding to pending\n", norm);
         return false;
     }
-    if (bl.isKey(norm)) {
-        Serial.printf("[NVS] UID %s already in BLACKLIST, not adding to pending\n", norm);
+    if (contains(BL, norm)) {
+        LOGD("[NVS] UID %s already in BLACKLIST, not adding to pending\n", norm);
         return false;
     }
-    if (pd.isKey(norm)) {
-        Serial.printf("[NVS] UID %s already in PENDING\n", norm);
+    if (contains(PD, norm)) {
+        LOGD("[NVS] UID %s already in PENDING\n", norm);
         return false;
     }
 
-    if (getCount(pd) >= MAX_UIDS) {
-        Serial.println("[NVS] Pending full");
+    if (mirror[PD].count >= MAX_UIDS || mirror[PD].spilled) {
+        LOGW("[NVS] Pending full\n");
         return false;
     }
 
-    size_t written = pd.putUChar(norm, 1);
-    if (written == 0) {
-        Serial.printf("[NVS] ERROR: putUChar FAILED for pending key %s\n", norm);
+    mirror[PD].add(norm);
+    if (!deferred(PD) && !putKey(PD, norm)) {
+        mirror[PD].remove(norm);
         return false;
     }
-    incCount(pd);
-    Serial.printf("[NVS] Added %s to pending, new count=%d\n", norm, getCount(pd));
+    LOGD("[NVS] Added %s to pending, new count=%d\n", norm, mirror[PD].count);
     return true;
 }
 
 void NVSStore::removeUID(const char* uid) {
+    OpScope op;
     char norm[16];
     normalizeUID(uid, norm, sizeof(norm));
+    bumpGeneration();
 
-    if (wl.isKey(norm)) {
-        wl.remove(norm);
-        decCount(wl);
-    }
-    if (bl.isKey(norm)) {
-        bl.remove(norm);
-        decCount(bl);
-    }
-    if (pd.isKey(norm)) {
-        pd.remove(norm);
-        decCount(pd);
-    }
+    for (uint8_t l = 0; l < LIST_COUNT; l++) removeFrom((List)l, norm);
 }
 
 // ================= SYNC HELPERS =================
 void NVSStore::clearWhitelist() {
-    wl.clear();
-    setCount(wl, 0);
+    OpScope op;
+    clearList(WL);
 }
 
 void NVSStore::clearBlacklist() {
-    bl.clear();
-    setCount(bl, 0);
+    OpScope op;
+    clearList(BL);
 }
+
+// ================= BATCH =================
+
+void NVSStore::beginBatch() {
+    batching = true;
+}
+
+// Writes only the difference between the mirror and what flash holds.
+// Spilled lists were written through already and are left alone: their
+// flash-only keys are not in the mirror but are not stale either.
+void NVSStore::commitBatch() {
+    if (!batching) return;
+    batching = false;
+    OpScope op;
+
+    uint32_t naive = flushMirror();   // what the same calls would have written unbatched
+
+    uint32_t written = wstats.physicalWrites - op.before;
+    if (naive > written) noteCoalesced(naive - written);
+    LOGI("[NVS] Batch committed: %lu writes (%lu unbatched)\n",
+         (unsigned long)written, (unsigned long)naive);
+}
+
 // ================= RESET =================
 
 void NVSStore::factoryReset() {
-    wl.clear();
-    bl.clear();
-    pd.clear();
-    setCount(wl, 0);
-    setCount(bl, 0);
-    setCount(pd, 0);
-    Serial.println("[NVS] Factory reset completed");
-}
-
-void NVSStore::forEachPending(const std::function<void(const char* uid)>& cb) {
-    Serial.printf("[NVS] forEachPending called, count=%d\n", getCount(pd));
-    
-    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, NS_PD, NVS_TYPE_ANY);
-    
-    if (it == NULL) {
-        Serial.println("[NVS] Iterator is NULL - no entries found in namespace");
-    }
-    
-    int found = 0;
-    while (it != NULL) {
-        nvs_entry_info_t info;
-        nvs_entry_info(it, &info);
-        Serial.printf("[NVS] Found key: %s\n", info.key);
-        if (strcmp(info.key, "__count") != 0) {
-            // Copy key to local buffer before calling callback
-            char keyCopy[16];
-            strncpy(keyCopy, info.key, sizeof(keyCopy) - 1);
-            keyCopy[sizeof(keyCopy) - 1] = '\0';
-            cb(keyCopy);
-            found++;
-        }
-        it = nvs_entry_next(it);
-    }
-    
-    Serial.printf("[NVS] forEachPending found %d UIDs\n", found);
+    OpScope op;
+    clearList(WL);
+    clearList(BL);
+    clearList(PD);
+    LOGI("[NVS] Factory reset completed\n");
 }
 
 void NVSStore::clearPending() {
-    pd.clear();
-    setCount(pd, 0);
+    OpScope op;
+    clearList(PD);
 }
 
 
 // ================= COUNTS =================
 
-uint8_t NVSStore::whitelistCount() { return getCount(wl); }
-uint8_t NVSStore::blacklistCount() { return getCount(bl); }
-uint8_t NVSStore::pendingCount()   { return getCount(pd); }
+// A spilled list is counted in flash
+static uint8_t countList(List l) {
+    if (!mirror[l].spilled) return mirror[l].count;
+    uint32_t n = 0;
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, LIST_NS[l], NVS_TYPE_ANY);
+    while (it != NULL) {
+        n++;
+        it = nvs_entry_next(it);
+    }
+    nvs_release_iterator(it);
+    return n > 255 ? 255 : (uint8_t)n;
+}
 
+uint8_t NVSStore::whitelistCount() { return countList(WL); }
+uint8_t NVSStore::blacklistCount() { return countList(BL); }
+uint8_t NVSStore::pendingCount()   { return countList(PD); }
+
+
+// ================= PAGED ITERATION =================
+
+UidPage NVSStore::listPage(UIDState list, const UidCursor& start, uint8_t limit,
+                           const std::function<void(const char* uid)>& cb) {
+    UidPage page = {};
+    page.next = start;
+    page.next.after[sizeof(page.next.after) - 1] = '\0';
+    if (list == UIDState::NONE) return page;
+    if (limit == 0 || limit > NVS_UID_PAGE_MAX) limit = NVS_UID_PAGE_MAX;
+
+    // The `limit` smallest keys after the cursor, kept sorted by insertion
+    char keys[NVS_UID_PAGE_MAX][16];
+    {
+        ThreadSafe::Guard guard(200);
+        if (!guard.isAcquired()) {
+            LOGW("[NVS] Failed to acquire mutex for listPage\n");
+            page.busy = true;
+            return page;
+        }
 
+        auto consider = [&](const char* key) {
+            if (strcmp(key, page.next.after) <= 0) return;
+
+            uint8_t at = page.count;
+            while (at > 0 && strcmp(keys[at - 1], key) > 0) at--;
+            if (at >= limit) {
+                page.more = true;
+                return;
+            }
+            if (page.count == limit) {
+                page.more = true;   // the largest falls off the end
+            } else {
+                page.count++;
+            }
+            memmove(keys[at + 1], keys[at], (page.count - 1 - at) * sizeof(keys[0]));
+            memcpy(keys[at], key, sizeof(keys[0]));
+        };
+
+        List l = (List)((uint8_t)list - (uint8_t)UIDState::WHITELIST);
+        if (mirror[l].spilled) {
+            // Flash is the full list; the mirror only a part of it
+            nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, LIST_NS[l], NVS_TYPE_ANY);
+            while (it != NULL) {
+                nvs_entry_info_t info;
+                nvs_entry_info(it, &info);
+                consider(info.key);
+                it = nvs_entry_next(it);
+            }
+            nvs_release_iterator(it);
+        } else {
+            for (uint8_t i = 0; i < mirror[l].count; i++) consider(mirror[l].keys[i]);
+        }
+    }
+
+    for (uint8_t i = 0; i < page.count; i++) cb(keys[i]);
+    if (page.count) memcpy(page.next.after, keys[page.count - 1], sizeof(page.next.after));
+    return page;
+}
+
+
+// Held in RAM; update() writes it once NVS_CMD_CHECKPOINT_MS passes without
+// another command, so a burst of commands costs one write
 void NVSStore::setLastCommandId(const char* id) {
-    sys.putString("last_cmd", id);
+    if (strncmp(lastCmd, id, sizeof(lastCmd) - 1) == 0) return;
+    if (lastCmdDirty) noteCoalesced();   // the pending checkpoint is superseded
+    strncpy(lastCmd, id, sizeof(lastCmd) - 1);
+    lastCmd[sizeof(lastCmd) - 1] = '\0';
+    lastCmdDirty     = true;
+    lastCmdChangedMs = millis();
 }
 
 String NVSStore::getLastCommandId() {
-    return sys.getString("last_cmd", "");
+    return String(lastCmd);
+}
+
+uint32_t NVSStore::generation() {
+    return __atomic_load_n(&stateGeneration, __ATOMIC_ACQUIRE);
+}
+
+// Busy: the previous snapshot rather than a torn read
+NVSWriteStats NVSStore::writeStats() {
+    static NVSWriteStats snapshot = {};
+    ThreadSafe::Guard guard(20);
+    if (guard.isAcquired()) snapshot = wstats;
+    return snapshot;
 }
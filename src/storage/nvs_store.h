@@ -11,9 +11,48 @@ enum class UIDState : uint8_t {
     PENDING
 };
 
+// NVS write accounting since boot, plus the wear estimate
+struct NVSWriteStats {
+    uint32_t logicalOps;       // public mutations; a batch counts once
+    uint32_t physicalWrites;   // puts + erases reaching flash
+    uint32_t coalescedWrites;  // writes a batch or a lazy checkpoint avoided
+    uint32_t entriesWritten;   // 32-byte NVS entries consumed since boot
+    uint32_t lifetimeEntries;  // ...since first boot, checkpointed hourly
+    uint16_t pages;            // 4 KB sectors in the NVS partition
+    uint32_t sectorErasesEstimate;   // lifetime entries / page capacity, spread over all pages
+};
+
+// Resume point in a UID list. Pages come out in UID order, so a cursor
+// stays valid across mutations between pages and can be stored as text.
+struct UidCursor {
+    char after[16];   // last UID handed out; "" = from the start
+};
+
+struct UidPage {
+    uint8_t   count;
+    bool      more;   // call again with `next`
+    bool      busy;   // lock not acquired; retry with the same cursor
+    UidCursor next;
+};
+
+// ================= NVS STORE =================
+// UID lists (wl / bl / pd) with a write-coalescing layer in front of NVS:
+//   - every key is mirrored in RAM at init; queries, counts and
+//     listPage() never read flash, and the old "__count" keys are
+//     no longer written (counts are derived from the mirror)
+//   - a list longer than NVS_UID_CAPACITY keeps working: the keys that
+//     do not fit are looked up in flash and its writes go straight
+//     through, so nothing the mirror could not load is ever erased
+//   - a mutation writes only the keys it actually changes
+//   - between beginBatch() and commitBatch() mutations touch only the
+//     mirror; the commit writes the difference against flash, so a
+//     SYNC_UIDS that changes nothing writes nothing
+//   - the last command id is held in RAM and checkpointed by update()
+// Mutations and queries run under ThreadSafe, as before.
 class NVSStore {
 public:
     static void init();
+    static void update();   // Core 0 loop: lazy checkpoints
 
     // Queries
     static bool isWhitelisted(const char* uid);
@@ -34,6 +73,10 @@ public:
     static void clearBlacklist();
     static void clearPending();
 
+    // Full list replacement: clear + re-add inside a batch
+    static void beginBatch();
+    static void commitBatch();
+
     // Factory reset
     static void factoryReset();
 
@@ -45,14 +88,15 @@ public:
     static void setLastCommandId(const char* id);
     static String getLastCommandId();
 
+    // Up to `limit` (<= NVS_UID_PAGE_MAX) UIDs of one list after `start`.
+    // Takes the lock itself for the copy only; `cb` runs after it is
+    // released and may call back into the store.
+    static UidPage listPage(UIDState list, const UidCursor& start, uint8_t limit,
+                            const std::function<void(const char* uid)>& cb);
 
-    static void forEachPending(const std::function<void(const char* uid)>& cb);
-
-private:
-    static Preferences wl;
-    static Preferences bl;
-    static Preferences pd;
-    static Preferences sys;
+    // Bumped by every change that can alter a UID's state except a new
+    // pending entry; RAM caches of verdicts compare against it
+    static uint32_t generation();
 
-    static bool addExclusive(Preferences& target, const char* uid, bool bypassLimit);
+    static NVSWriteStats writeStats();
 };
@@ -0,0 +1,269 @@
+// =====================================================
+// LOG CODEC ROUND-TRIP TEST (host build: pio run -e log_codec_test)
+// =====================================================
+// Encodes a synthetic segment with LogCodec, decodes it back and checks
+// every field, then the edge cases a segment on flash actually hits:
+//   - a record torn by a power cut mid-write (every prefix of it)
+//   - a dictionary that fills up, after which new UIDs go out as literals
+//   - decoding resumed at index checkpoints with the sealed dictionary
+//   - corrupt records
+// Prints each failure and exits 1 if there was any.
+//
+//   log_codec_test
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#include "storage/log_codec.h"
+
+struct Record {
+    uint32_t    timestamp;
+    LogEvent    event;
+    std::string uid;
+    std::string info;
+    uint8_t     door;
+};
+
+struct Segment {
+    std::vector<uint8_t>  bytes;
+    std::vector<uint32_t> offsets;   // start of each record
+    LogCodec::Encoder     enc;
+};
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                \
+    do {                                                \
+        if (!(cond)) {                                  \
+            failures++;                                 \
+            printf("FAIL %s:%d: ", __func__, __LINE__); \
+            printf(__VA_ARGS__);                        \
+            printf("\n");                               \
+        }                                               \
+    } while (0)
+
+// ========== HELPERS ==========
+static void encodeAll(Segment& seg, const std::vector<Record>& recs) {
+    seg.bytes.resize(LogCodec::HEADER_BYTES);
+    LogCodec::writeHeader(seg.bytes.data(), LOG_TZ_OFFSET_MINUTES);
+    seg.enc.reset();
+    for (const Record& r : recs) {
+        uint8_t buf[LogCodec::MAX_RECORD_BYTES];
+        size_t n = seg.enc.encode(buf, r.timestamp, r.event, r.uid.c_str(), r.info.c_str(), r.door);
+        CHECK(n <= sizeof(buf), "record of %zu bytes", n);
+        seg.offsets.push_back(seg.bytes.size());
+        seg.bytes.insert(seg.bytes.end(), buf, buf + n);
+    }
+}
+
+// The text-side UID for "no card" is "-", info "" stays ""
+static void expectEntry(const LogEntry& e, const Record& r, size_t i) {
+    std::string uid = r.uid.empty() ? "-" : r.uid;
+    CHECK(e.timestamp == r.timestamp, "record %zu: timestamp %u, want %u", i, e.timestamp, r.timestamp);
+    CHECK(e.event == r.event, "record %zu: event %u, want %u", i, (unsigned)e.event, (unsigned)r.event);
+    CHECK(uid == e.uid, "record %zu: uid '%s', want '%s'", i, e.uid, uid.c_str());
+    CHECK(r.info == e.info, "record %zu: info '%s', want '%s'", i, e.info, r.info.c_str());
+    CHECK(e.door == r.door, "record %zu: door %u, want %u", i, e.door, r.door);
+    CHECK(e.timestampStr[0] != '\0', "record %zu: no timestamp string", i);
+}
+
+// Decodes records [from, recs.size()) starting at seg.offsets[from]
+static void decodeFrom(const Segment& seg, const std::vector<Record>& recs, size_t from,
+                       LogCodec::Decoder& dec) {
+    size_t pos = from < seg.offsets.size() ? seg.offsets[from] : seg.bytes.size();
+    for (size_t i = from; i < recs.size(); i++) {
+        LogEntry e;
+        int n = dec.decode(seg.bytes.data() + pos, seg.bytes.size() - pos, e);
+        CHECK(n > 0, "record %zu: decode returned %d", i, n);
+        if (n <= 0) return;
+        expectEntry(e, recs[i], i);
+        pos += n;
+    }
+    CHECK(pos == seg.bytes.size(), "%zu bytes left over", seg.bytes.size() - pos);
+}
+
+static std::string cardUid(uint32_t n) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "04%08X", n);
+    return buf;
+}
+
+// A day at a door: repeated cards, table and literal info, second door,
+// a backwards NTP correction and a long gap
+static std::vector<Record> sampleDay() {
+    uint32_t t = 1768900000;
+    return {
+        { t,         LogEvent::SYSTEM_BOOT,    "",               "boot",                         0 },
+        { t + 5,     LogEvent::ACCESS_GRANTED, "A1B2C3D4",       "ok",                           0 },
+        { t + 9,     LogEvent::ACCESS_GRANTED, "A1B2C3D4",       "ok",                           1 },
+        { t + 9,     LogEvent::ACCESS_DENIED,  "DEADBEEF",       "blacklist",                    0 },
+        { t + 3,     LogEvent::UNKNOWN_CARD,   "04A1B2C3D4E5F6", "pending",                      2 },   // clock stepped back
+        { t + 4,     LogEvent::RFID_INVALID,   "",               "invalid UID",                  0 },
+        { t + 90000, LogEvent::ACCESS_GRANTED, "A1B2C3D4",       "",                             0 },
+        { t + 90001, LogEvent::REMOTE_UNLOCK,  "",               "cloud",                        0 },
+        { t + 90002, LogEvent::COMMAND_ERROR,  "",               "free text: not in the table",  255 },
+        { t + 90002, LogEvent::EXIT_UNLOCK,    "-",              "",                             0 },
+    };
+}
+
+// ========== TESTS ==========
+static void testHeader() {
+    uint8_t hdr[LogCodec::HEADER_BYTES];
+    int16_t tz = 0;
+    LogCodec::writeHeader(hdr, -210);
+    CHECK(LogCodec::readHeader(hdr, sizeof(hdr), tz) && tz == -210, "tz %d", tz);
+    CHECK(!LogCodec::readHeader(hdr, sizeof(hdr) - 1, tz), "short header accepted");
+    hdr[0] = 'X';
+    CHECK(!LogCodec::readHeader(hdr, sizeof(hdr), tz), "bad magic accepted");
+}
+
+static void testRoundTrip() {
+    std::vector<Record> recs = sampleDay();
+    Segment seg;
+    encodeAll(seg, recs);
+
+    int16_t tz = 0;
+    CHECK(LogCodec::readHeader(seg.bytes.data(), seg.bytes.size(), tz) && tz == LOG_TZ_OFFSET_MINUTES,
+          "header tz %d", tz);
+
+    LogCodec::Decoder dec;
+    dec.reset(tz);
+    decodeFrom(seg, recs, 0, dec);
+    CHECK(dec.dict.count == seg.enc.dict.count, "decoder dictionary %u, encoder %u",
+          dec.dict.count, seg.enc.dict.count);
+}
+
+// Every cut inside the last record must read as "continues past len",
+// leave the decoder untouched, and decode once the rest arrives
+static void testTornTail() {
+    std::vector<Record> recs = sampleDay();
+    recs.push_back({ 1768990100, LogEvent::UNKNOWN_CARD, "04112233445566", "free text tail", 3 });
+    Segment seg;
+    encodeAll(seg, recs);
+
+    size_t last = recs.size() - 1;
+    size_t start = seg.offsets[last];
+    for (size_t cut = start; cut < seg.bytes.size(); cut++) {
+        LogCodec::Decoder dec;
+        dec.reset();
+        size_t pos = LogCodec::HEADER_BYTES;
+        LogEntry e;
+        for (size_t i = 0; i < last; i++) pos += dec.decode(seg.bytes.data() + pos, seg.bytes.size() - pos, e);
+
+        uint16_t dictBefore = dec.dict.count;
+        uint32_t tsBefore   = dec.prevTs;
+        int n = dec.decode(seg.bytes.data() + pos, cut - pos, e);
+        CHECK(n == 0, "cut %zu bytes into the record: decode returned %d", cut - start, n);
+        CHECK(dec.dict.count == dictBefore && dec.prevTs == tsBefore,
+              "cut %zu bytes into the record: decoder state moved", cut - start);
+
+        n = dec.decode(seg.bytes.data() + pos, seg.bytes.size() - pos, e);
+        CHECK(n == (int)(seg.bytes.size() - pos), "completed record: decode returned %d", n);
+        if (n > 0) expectEntry(e, recs[last], last);
+    }
+}
+
+// Past LOG_DICT_MAX distinct UIDs new cards are written as literals;
+// cards already in the dictionary keep using their index
+static void testDictionaryOverflow() {
+    std::vector<Record> recs;
+    uint32_t t = 1768900000;
+    for (uint32_t i = 0; i < LOG_DICT_MAX + 20; i++) {
+        recs.push_back({ t + i, LogEvent::ACCESS_GRANTED, cardUid(i), "ok", 0 });
+    }
+    for (uint32_t i = 0; i < 40; i++) {
+        uint32_t card = (i * 7) % (LOG_DICT_MAX + 20);   // both sides of the limit
+        recs.push_back({ t + 1000 + i, LogEvent::ACCESS_DENIED, cardUid(card), "", (uint8_t)(i & 1) });
+    }
+    Segment seg;
+    encodeAll(seg, recs);
+    CHECK(seg.enc.dict.count == LOG_DICT_MAX, "encoder dictionary %u", seg.enc.dict.count);
+
+    // A known card is a dictionary reference, an overflowed one a literal again
+    uint8_t buf[LogCodec::MAX_RECORD_BYTES];
+    LogCodec::Encoder probe = seg.enc;
+    size_t known    = probe.encode(buf, t + 2000, LogEvent::ACCESS_GRANTED, cardUid(0).c_str(), "ok");
+    size_t overflow = probe.encode(buf, t + 2000, LogEvent::ACCESS_GRANTED,
+                                   cardUid(LOG_DICT_MAX + 5).c_str(), "ok");
+    CHECK(known < overflow, "reference %zu bytes, literal %zu bytes", known, overflow);
+    CHECK(probe.dict.count == LOG_DICT_MAX, "literal added to a full dictionary");
+
+    LogCodec::Decoder dec;
+    dec.reset();
+    decodeFrom(seg, recs, 0, dec);
+    CHECK(dec.dict.count == LOG_DICT_MAX, "decoder dictionary %u", dec.dict.count);
+}
+
+// How LogStore seeks: a sealed segment's final dictionary preloaded,
+// then resumeAt() with the checkpoint's timestamp at its offset
+static void testResumeAtCheckpoints() {
+    std::vector<Record> recs = sampleDay();
+    uint32_t t = 1768990000;
+    for (uint32_t i = 0; i < 3 * LOG_INDEX_STRIDE; i++) {
+        recs.push_back({ t + i * 37, i % 5 ? LogEvent::ACCESS_GRANTED : LogEvent::UNKNOWN_CARD,
+                         cardUid(i % 11), i % 5 ? "ok" : "pending", (uint8_t)(i % 3) });
+    }
+    Segment seg;
+    encodeAll(seg, recs);
+
+    for (size_t from = 0; from < recs.size(); from += LOG_INDEX_STRIDE) {
+        LogCodec::Decoder dec;
+        dec.reset();
+        dec.dict = seg.enc.dict;
+        dec.resumeAt(recs[from].timestamp);
+        decodeFrom(seg, recs, from, dec);
+    }
+
+    // Resuming at the record just after a backwards clock step
+    LogCodec::Decoder dec;
+    dec.reset();
+    dec.dict = seg.enc.dict;
+    dec.resumeAt(recs[4].timestamp);
+    decodeFrom(seg, recs, 4, dec);
+}
+
+static void testCorrupt() {
+    LogCodec::Encoder enc;
+    enc.reset();
+    uint8_t buf[LogCodec::MAX_RECORD_BYTES];
+    size_t n = enc.encode(buf, 1768900000, LogEvent::ACCESS_GRANTED, "A1B2C3D4", "ok");
+
+    LogCodec::Decoder dec;
+    LogEntry e;
+
+    // Unknown event code
+    uint8_t bad[LogCodec::MAX_RECORD_BYTES];
+    memcpy(bad, buf, n);
+    bad[0] = (bad[0] & 0xF0) | 0x0F;
+    dec.reset();
+    CHECK(dec.decode(bad, n, e) < 0, "unknown event decoded");
+
+    // Dictionary reference the decoder never saw
+    n = enc.encode(buf, 1768900001, LogEvent::ACCESS_GRANTED, "A1B2C3D4", "ok");
+    dec.reset();
+    CHECK(dec.decode(buf, n, e) < 0, "dangling dictionary reference decoded");
+
+    // Info code past the table
+    n = enc.encode(buf, 1768900002, LogEvent::ACCESS_GRANTED, "-", "ok");
+    buf[n - 1] = 0xF0;
+    dec.reset();
+    CHECK(dec.decode(buf, n, e) < 0, "unknown info code decoded");
+}
+
+// ========== MAIN ==========
+int main() {
+    testHeader();
+    testRoundTrip();
+    testTornTail();
+    testDictionaryOverflow();
+    testResumeAtCheckpoints();
+    testCorrupt();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("log codec: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+// Reader stub: the replay tool injects UIDs through RFIDManager::submitUID,
+// so the hardware side never reports a card.
+
+#include <stdint.h>
+
+#define PN532_MIFARE_ISO14443A (0x00)
+
+class Adafruit_PN532 {
+public:
+    explicit Adafruit_PN532(uint8_t ss) { (void)ss; }
+    bool begin() { return true; }
+    uint32_t getFirmwareVersion() { return 0; }
+    bool SAMConfig() { return true; }
+    bool readPassiveTargetID(uint8_t, uint8_t*, uint8_t*, uint16_t = 0) { return false; }
+    bool startPassiveTargetIDDetection(uint8_t) { return true; }
+    bool readDetectedPassiveTargetID(uint8_t*, uint8_t*) { return false; }
+};
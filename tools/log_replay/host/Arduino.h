@@ -0,0 +1,125 @@
+#pragma once
+// Minimal Arduino core shim so the firmware's decision path can be
+// compiled for the host. Only what the replayed modules touch.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <algorithm>
+
+#define HIGH   0x1
+#define LOW    0x0
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+using std::min;
+using std::max;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+// ================= String =================
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v)           : s_(std::to_string(v)) {}
+    String(unsigned int v)  : s_(std::to_string(v)) {}
+    String(long v)          : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(double v, unsigned int decimals = 2) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s_ = buf;
+    }
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.length(); }
+    void reserve(unsigned int n) { s_.reserve(n); }
+
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    const char* begin() const { return s_.data(); }
+    const char* end() const { return s_.data() + s_.size(); }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o) { s_ += o; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+    friend String operator+(const char* a, const String& b) { return String(a) + b; }
+
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* o) const { return s_ == o; }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+
+    bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t i = s_.find(c, from);
+        return i == std::string::npos ? -1 : (int)i;
+    }
+    String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from >= s_.size() || to <= from) return String();
+        return String(s_.substr(from, to - from));
+    }
+    void trim() {
+        size_t a = s_.find_first_not_of(" \t\r\n");
+        size_t b = s_.find_last_not_of(" \t\r\n");
+        s_ = (a == std::string::npos) ? std::string() : s_.substr(a, b - a + 1);
+    }
+    void toUpperCase() { for (auto& c : s_) c = toupper((unsigned char)c); }
+    void replace(const String& from, const String& to) {
+        if (from.s_.empty()) return;
+        size_t pos = 0;
+        while ((pos = s_.find(from.s_, pos)) != std::string::npos) {
+            s_.replace(pos, from.s_.size(), to.s_);
+            pos += to.s_.size();
+        }
+    }
+
+private:
+    std::string s_;
+};
+
+// ================= Serial =================
+// Quiet by default: the replay tool prints its own report and only
+// forwards firmware chatter to stderr with --verbose.
+class HostSerial {
+public:
+    bool enabled = false;
+
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (!enabled) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        return n > 0 ? n : 0;
+    }
+    size_t write(const uint8_t* buf, size_t n) { return printf("%.*s", (int)n, (const char*)buf); }
+    size_t print(const String& s)   { return printf("%s", s.c_str()); }
+    size_t print(const char* s)     { return printf("%s", s); }
+    size_t print(long v)            { return printf("%ld", v); }
+    size_t println(const String& s) { return printf("%s\n", s.c_str()); }
+    size_t println(const char* s)   { return printf("%s\n", s); }
+    size_t println(long v)          { return printf("%ld\n", v); }
+    size_t println()                { return printf("\n"); }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,31 @@
+#pragma once
+// In-memory NVS. Namespaces live in one registry so the nvs.h
+// iterator shim can walk them like nvs_entry_find() on the device.
+
+#include "Arduino.h"
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() {}
+
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    size_t putUChar(const char* key, uint8_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    size_t putUInt(const char* key, uint32_t value);
+    String getString(const char* key, const String& defaultValue = String());
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+private:
+    std::map<std::string, std::string>* ns_ = nullptr;
+};
+
+// Registry backing every Preferences namespace (namespace -> key -> value)
+std::map<std::string, std::map<std::string, std::string>>& hostNvsRegistry();
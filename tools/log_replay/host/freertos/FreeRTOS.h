@@ -0,0 +1,24 @@
+#pragma once
+// Single-threaded FreeRTOS shim: queues are deques, the mutex is a flag.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define pdTRUE              ((BaseType_t)1)
+#define pdFALSE             ((BaseType_t)0)
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS  ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+// Critical sections are no-ops: the host build is single-threaded
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)      ((void)(mux))
+#define portEXIT_CRITICAL(mux)       ((void)(mux))
+inline BaseType_t xPortGetCoreID() { return 0; }
+
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,10 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct HostQueue;
+typedef HostQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
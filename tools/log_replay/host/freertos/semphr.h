@@ -0,0 +1,9 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct HostMutex;
+typedef HostMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t m);
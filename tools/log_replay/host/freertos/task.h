@@ -0,0 +1,14 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// No tasks on the host: creation fails, so callers take their
+// synchronous fallback.
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdPASS pdTRUE
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*,
+                                          UBaseType_t, TaskHandle_t*, BaseType_t) { return pdFALSE; }
+inline uint32_t   ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdTRUE; }
@@ -0,0 +1,192 @@
+// Host implementations for the Arduino / FreeRTOS / NVS shims.
+
+#include "Arduino.h"
+#include "Preferences.h"
+#include "nvs.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+HostSerial Serial;
+
+// ================= TIME =================
+static const auto hostEpoch = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hostEpoch).count();
+}
+
+uint32_t micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - hostEpoch).count();
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// ================= QUEUE =================
+struct HostQueue {
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new HostQueue{length, itemSize, {}};
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    if (!q || q->items.size() >= q->length) return pdFALSE;
+    const uint8_t* p = (const uint8_t*)item;
+    q->items.emplace_back(p, p + q->itemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+    if (!q || q->items.empty()) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    return q ? q->items.size() : 0;
+}
+
+// ================= MUTEX =================
+// The replay runs on one thread, so a non-recursive flag is enough to
+// catch a lock that is never released.
+struct HostMutex {
+    bool taken = false;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostMutex(); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t) {
+    if (!m || m->taken) return pdFALSE;
+    m->taken = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t m) {
+    if (!m || !m->taken) return pdFALSE;
+    m->taken = false;
+    return pdTRUE;
+}
+
+// ================= PREFERENCES =================
+std::map<std::string, std::map<std::string, std::string>>& hostNvsRegistry() {
+    static std::map<std::string, std::map<std::string, std::string>> registry;
+    return registry;
+}
+
+bool Preferences::begin(const char* name, bool) {
+    ns_ = &hostNvsRegistry()[name];
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return ns_ && ns_->count(key);
+}
+
+bool Preferences::remove(const char* key) {
+    return ns_ && ns_->erase(key) > 0;
+}
+
+bool Preferences::clear() {
+    if (!ns_) return false;
+    ns_->clear();
+    return true;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    if (!ns_) return defaultValue;
+    auto it = ns_->find(key);
+    return (it == ns_->end() || it->second.empty()) ? defaultValue : (uint8_t)it->second[0];
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+    if (!ns_) return 0;
+    (*ns_)[key] = std::string(1, (char)value);
+    return 1;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    if (!ns_) return defaultValue;
+    auto it = ns_->find(key);
+    if (it == ns_->end() || it->second.size() != sizeof(uint32_t)) return defaultValue;
+    uint32_t v;
+    memcpy(&v, it->second.data(), sizeof(v));
+    return v;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    if (!ns_) return 0;
+    (*ns_)[key] = std::string((const char*)&value, sizeof(value));
+    return sizeof(value);
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    if (!ns_) return defaultValue;
+    auto it = ns_->find(key);
+    return it == ns_->end() ? defaultValue : String(it->second);
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (!ns_) return 0;
+    (*ns_)[key] = value;
+    return strlen(value);
+}
+
+// ================= NVS ITERATOR =================
+struct HostNvsIterator {
+    std::string ns;
+    std::vector<std::string> keys;
+    size_t pos;
+};
+
+nvs_iterator_t nvs_entry_find(const char*, const char* ns, nvs_type_t) {
+    auto& registry = hostNvsRegistry();
+    auto found = registry.find(ns);
+    if (found == registry.end() || found->second.empty()) return nullptr;
+
+    HostNvsIterator* it = new HostNvsIterator{ns, {}, 0};
+    for (auto& kv : found->second) it->keys.push_back(kv.first);
+    return it;
+}
+
+nvs_iterator_t nvs_entry_next(nvs_iterator_t it) {
+    if (!it) return nullptr;
+    if (++it->pos >= it->keys.size()) {
+        delete it;   // matches IDF: iterator is released at the end
+        return nullptr;
+    }
+    return it;
+}
+
+void nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t* out) {
+    memset(out, 0, sizeof(*out));
+    strncpy(out->namespace_name, it->ns.c_str(), sizeof(out->namespace_name) - 1);
+    strncpy(out->key, it->keys[it->pos].c_str(), sizeof(out->key) - 1);
+    out->type = NVS_TYPE_ANY;
+}
+
+void nvs_release_iterator(nvs_iterator_t it) {
+    delete it;
+}
+
+esp_err_t nvs_get_stats(const char*, nvs_stats_t* out) {
+    size_t used = 0;
+    for (auto& ns : hostNvsRegistry()) used += ns.second.size();
+    out->total_entries   = 5 * 126;
+    out->used_entries    = used;
+    out->free_entries    = out->total_entries - used;
+    out->namespace_count = hostNvsRegistry().size();
+    return ESP_OK;
+}
@@ -0,0 +1,38 @@
+#pragma once
+// nvs_entry_find() iterator over the host Preferences registry
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define NVS_DEFAULT_PART_NAME "nvs"
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef enum { NVS_TYPE_U8 = 0x01, NVS_TYPE_STR = 0x21, NVS_TYPE_ANY = 0xff } nvs_type_t;
+
+typedef struct {
+    char namespace_name[16];
+    char key[16];
+    nvs_type_t type;
+} nvs_entry_info_t;
+
+struct HostNvsIterator;
+typedef HostNvsIterator* nvs_iterator_t;
+
+nvs_iterator_t nvs_entry_find(const char* part, const char* ns, nvs_type_t type);
+nvs_iterator_t nvs_entry_next(nvs_iterator_t it);
+void nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t* out);
+void nvs_release_iterator(nvs_iterator_t it);
+
+typedef struct {
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+
+// A 5-page (20 KB) partition, as in the default partition table
+esp_err_t nvs_get_stats(const char* part, nvs_stats_t* out);
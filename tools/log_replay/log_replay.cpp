@@ -0,0 +1,296 @@
+// =====================================================
+// LOG REPLAY TOOL (host build: pio run -e log_replay)
+// =====================================================
+// Re-feeds the card taps recorded in LogStore files through
+// RFIDManager::submitUID -> AccessDecision -> NVSStore -> EventQueue
+// and reports per-stage latencies plus every decision that differs
+// from what the door originally logged.
+//
+//   log_replay [options] log_20260120.txt seg_00000001.log ...
+//   (text daily files and text or binary segments pulled off the device)
+//     --speed N      replay N times faster than real time (0 = no waiting, default)
+//     --max-gap S    cap any single wait at S wall-clock seconds (default 2)
+//     --seed MODE    infer (default): seed WL/BL from each UID's first logged outcome
+//                    empty: start from an empty NVS
+//     --diffs N      print at most N decision diffs (default 20)
+//     --verbose      forward firmware Serial output to stderr
+
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "access/rfid_manager.h"
+#include "cloud/pending_push.h"
+#include "core/event_queue.h"
+#include "core/thread_safe.h"
+#include "storage/log_codec.h"
+#include "storage/log_format.h"
+#include "storage/nvs_store.h"
+
+struct Options {
+    double   speed     = 0.0;
+    double   maxGapSec = 2.0;
+    bool     seedInfer = true;
+    uint32_t maxDiffs  = 20;
+    std::vector<std::string> files;
+};
+
+struct StageStats {
+    const char* name;
+    std::vector<uint32_t> samples;
+
+    void print() const {
+        if (samples.empty()) {
+            printf("  %-10s      -\n", name);
+            return;
+        }
+        std::vector<uint32_t> s = samples;
+        std::sort(s.begin(), s.end());
+        uint64_t sum = 0;
+        for (uint32_t v : s) sum += v;
+        auto pct = [&](double p) { return s[std::min(s.size() - 1, (size_t)(p * s.size()))]; };
+        printf("  %-10s %8u %8.1f %8u %8u %8u\n", name, s.front(),
+               (double)sum / s.size(), pct(0.50), pct(0.99), s.back());
+    }
+};
+
+// ================= CLOUD =================
+// Stands in for the loop task's uploader: only counts what the decision
+// stage would have pushed
+
+static uint32_t pendingPushes = 0;
+
+bool PendingPush::notify(const char*, uint8_t) {
+    pendingPushes++;
+    return true;
+}
+
+// ================= HELPERS =================
+
+static bool isTap(LogEvent e) {
+    return e == LogEvent::ACCESS_GRANTED || e == LogEvent::ACCESS_DENIED ||
+           e == LogEvent::UNKNOWN_CARD   || e == LogEvent::RFID_INVALID;
+}
+
+static EventType expectedEvent(LogEvent e) {
+    switch (e) {
+        case LogEvent::ACCESS_GRANTED: return EventType::RFID_GRANTED;
+        case LogEvent::ACCESS_DENIED:  return EventType::RFID_DENIED;
+        case LogEvent::UNKNOWN_CARD:   return EventType::RFID_PENDING;
+        default:                       return EventType::RFID_INVALID;
+    }
+}
+
+static const char* eventName(EventType t) {
+    switch (t) {
+        case EventType::RFID_GRANTED: return "GRANTED";
+        case EventType::RFID_DENIED:  return "DENIED";
+        case EventType::RFID_PENDING: return "PENDING";
+        case EventType::RFID_INVALID: return "INVALID";
+        default:                      return "NONE";
+    }
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--speed" && hasValue)        opt.speed = atof(argv[++i]);
+        else if (a == "--max-gap" && hasValue) opt.maxGapSec = atof(argv[++i]);
+        else if (a == "--diffs" && hasValue)   opt.maxDiffs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--seed" && hasValue)    opt.seedInfer = std::string(argv[++i]) != "empty";
+        else if (a == "--verbose")             Serial.enabled = true;
+        else if (a.rfind("--", 0) == 0)        return false;
+        else                                   opt.files.push_back(a);
+    }
+    return !opt.files.empty();
+}
+
+// log_YYYYMMDD.txt and seg_NNNNNNNN.log names both sort chronologically (and
+// legacy daily files before segments); lines inside a file are in order
+static std::vector<LogEntry> loadRecords(std::vector<std::string> files, uint32_t& skipped) {
+    std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) {
+        return a.substr(a.find_last_of('/') + 1) < b.substr(b.find_last_of('/') + 1);
+    });
+
+    std::vector<LogEntry> records;
+    skipped = 0;
+    for (const std::string& path : files) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            fprintf(stderr, "cannot open %s\n", path.c_str());
+            continue;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                                  std::istreambuf_iterator<char>());
+
+        int16_t tz;
+        if (LogCodec::readHeader(data.data(), data.size(), tz)) {
+            LogCodec::Decoder dec;
+            dec.reset(tz);
+            size_t pos = LogCodec::HEADER_BYTES;
+            while (pos < data.size()) {
+                LogEntry e;
+                int n = dec.decode(data.data() + pos, data.size() - pos, e);
+                if (n <= 0) {
+                    skipped++;   // torn tail
+                    break;
+                }
+                records.push_back(e);
+                pos += n;
+            }
+            continue;
+        }
+
+        size_t start = 0;
+        while (start < data.size()) {
+            size_t end = start;
+            while (end < data.size() && data[end] != '\n') end++;
+            std::string line((const char*)data.data() + start, end - start);
+            start = end + 1;
+
+            LogEntry e;
+            if (LogFormat::parseLine(line.c_str(), e)) records.push_back(e);
+            else if (!line.empty()) skipped++;
+        }
+    }
+    return records;
+}
+
+// The logs don't carry the NVS state the door started with. Approximate it
+// from each UID's first appearance: a card first seen GRANTED/DENIED must
+// already have been whitelisted/blacklisted. Later UID_* admin events are
+// replayed in order, so cards approved mid-trace start unknown.
+static void seedFromRecords(const std::vector<LogEntry>& records) {
+    std::map<std::string, bool> seen;
+    for (const LogEntry& e : records) {
+        if (!strcmp(e.uid, "-") || seen.count(e.uid)) continue;
+        seen[e.uid] = true;
+        if (e.event == LogEvent::ACCESS_GRANTED) NVSStore::addToWhitelist(e.uid, true);
+        if (e.event == LogEvent::ACCESS_DENIED)  NVSStore::addToBlacklist(e.uid, true);
+    }
+}
+
+static bool applyAdminEvent(const LogEntry& e) {
+    switch (e.event) {
+        case LogEvent::UID_WHITELISTED: NVSStore::addToWhitelist(e.uid, true); return true;
+        case LogEvent::UID_BLACKLISTED: NVSStore::addToBlacklist(e.uid, true); return true;
+        case LogEvent::UID_REMOVED:     NVSStore::removeUID(e.uid);            return true;
+        case LogEvent::UID_SYNC:
+            // SYNC_UIDS always drops pending; its WL/BL payload isn't logged
+            if (!strcmp(e.info, "cloud")) NVSStore::clearPending();
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void waitGap(const Options& opt, uint32_t prevTs, uint32_t ts) {
+    if (opt.speed <= 0 || !prevTs || ts <= prevTs) return;
+    double sec = std::min((ts - prevTs) / opt.speed, opt.maxGapSec);
+    std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(sec * 1e6)));
+}
+
+// ================= MAIN =================
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [--speed N] [--max-gap S] [--seed infer|empty] "
+                        "[--diffs N] [--verbose] log_YYYYMMDD.txt...\n", argv[0]);
+        return 2;
+    }
+
+    uint32_t skipped = 0;
+    std::vector<LogEntry> records = loadRecords(opt.files, skipped);
+
+    ThreadSafe::init();
+    EventQueue::init();
+    NVSStore::init();
+    if (opt.seedInfer) seedFromRecords(records);
+
+    StageStats decision{"decision", {}}, enqueue{"enqueue", {}}, dequeue{"dequeue", {}}, total{"total", {}};
+    std::map<std::string, uint32_t> diffByKind;
+    uint32_t taps = 0, diffs = 0, adminEvents = 0;
+    uint32_t prevTs = 0, firstTs = 0, lastTs = 0;
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (const LogEntry& e : records) {
+        if (e.timestamp) {
+            waitGap(opt, prevTs, e.timestamp);
+            prevTs = e.timestamp;
+            if (!firstTs) firstTs = e.timestamp;
+            lastTs = e.timestamp;
+        }
+
+        if (!isTap(e.event)) {
+            if (applyAdminEvent(e)) adminEvents++;
+            continue;
+        }
+
+        taps++;
+        RFIDTapTiming timing = {};
+        uint32_t t0 = micros();
+        EventType replayed = RFIDManager::submitUID(e.uid, &timing);
+
+        uint32_t t1 = micros();
+        Event evt;
+        bool got = EventQueue::receive(evt);
+        uint32_t t2 = micros();
+
+        decision.samples.push_back(timing.decisionUs);
+        enqueue.samples.push_back(timing.enqueueUs);
+        dequeue.samples.push_back(t2 - t1);
+        total.samples.push_back(t2 - t0);
+
+        if (!got) replayed = EventType::NONE;   // queue overflow counts as a diff
+
+        EventType logged = expectedEvent(e.event);
+        if (replayed != logged) {
+            std::string kind = std::string(eventName(logged)) + " -> " + eventName(replayed);
+            diffByKind[kind]++;
+            if (diffs++ < opt.maxDiffs) {
+                printf("DIFF %s  uid=%-14s logged=%-7s replayed=%s\n",
+                       e.timestampStr, e.uid, eventName(logged), eventName(replayed));
+            }
+        }
+    }
+
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("\n======== LOG REPLAY ========\n");
+    printf("  files      : %zu\n", opt.files.size());
+    printf("  records    : %zu (%u unparsable lines skipped)\n", records.size(), skipped);
+    printf("  taps       : %u\n", taps);
+    printf("  admin ops  : %u\n", adminEvents);
+    printf("  new pending: %u (pushed upstream on the device)\n", pendingPushes);
+    printf("  seed       : %s (WL=%d BL=%d at end)\n", opt.seedInfer ? "infer" : "empty",
+           NVSStore::whitelistCount(), NVSStore::blacklistCount());
+    if (lastTs > firstTs) {
+        printf("  trace span : %u s, replayed in %.3f s (%.0fx)\n",
+               lastTs - firstTs, wallSec, wallSec > 0 ? (lastTs - firstTs) / wallSec : 0.0);
+    } else {
+        printf("  replayed in: %.3f s\n", wallSec);
+    }
+
+    printf("\n  stage (us)      min      avg      p50      p99      max\n");
+    decision.print();
+    enqueue.print();
+    dequeue.print();
+    total.print();
+
+    printf("\n  decision diffs: %u / %u taps\n", diffs, taps);
+    for (auto& kv : diffByKind) {
+        printf("    %-20s %u\n", kv.first.c_str(), kv.second);
+    }
+    printf("============================\n");
+
+    return diffs ? 1 : 0;
+}
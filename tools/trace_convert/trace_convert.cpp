@@ -0,0 +1,240 @@
+// =====================================================
+// TRACE CONVERTER (host build: pio run -e trace_convert)
+// =====================================================
+// Turns a Trace dump into Chrome trace event JSON, which both
+// chrome://tracing and ui.perfetto.dev open directly. Core 0 and Core 1
+// become two threads of one process, so their interleaving is visible on
+// a shared timeline.
+//
+//   trace_convert [options] <dump>
+//   <dump> is either the raw binary from GET /trace, or a serial capture
+//   containing a "[TRACE] BEGIN" ... "[TRACE] END" block (the last one wins)
+//     -o FILE        write JSON to FILE instead of stdout
+//     --summary      print per-event counts and durations to stderr
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "core/trace_format.h"
+
+static_assert(sizeof(TRACE_EVENT_NAMES) / sizeof(TRACE_EVENT_NAMES[0]) == (size_t)TraceEvent::COUNT,
+              "every TraceEvent needs a name");
+
+struct Options {
+    std::string input;
+    std::string output;
+    bool        summary = false;
+};
+
+// ================= INPUT =================
+
+static int b64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+static void b64Append(const std::string& line, std::vector<uint8_t>& out) {
+    uint32_t acc  = 0;
+    int      bits = 0;
+    for (char c : line) {
+        int v = b64Value(c);
+        if (v < 0) continue;   // '=', '\r', stray spaces
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((acc >> bits) & 0xFF);
+        }
+    }
+}
+
+// Last [TRACE] BEGIN / END block of a serial capture. Other firmware
+// output may be interleaved, so only lines made of base64 characters
+// between the markers are taken.
+static bool extractSerialDump(const std::string& text, std::vector<uint8_t>& out) {
+    size_t begin = text.rfind("[TRACE] BEGIN");
+    if (begin == std::string::npos) return false;
+    size_t end = text.find("[TRACE] END", begin);
+    if (end == std::string::npos) end = text.size();
+
+    out.clear();
+    size_t pos = text.find('\n', begin);
+    while (pos != std::string::npos && pos < end) {
+        size_t next = text.find('\n', pos + 1);
+        std::string line = text.substr(pos + 1, (next == std::string::npos ? end : next) - pos - 1);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+
+        bool isData = !line.empty() && line.find("[TRACE]") == std::string::npos &&
+                      std::all_of(line.begin(), line.end(),
+                                  [](char c) { return b64Value(c) >= 0 || c == '='; });
+        if (isData) b64Append(line, out);
+        pos = next;
+    }
+    return true;
+}
+
+static bool loadDump(const std::string& path, std::vector<uint8_t>& dump) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    uint32_t magic = 0;
+    if (raw.size() >= 4) memcpy(&magic, raw.data(), 4);
+    if (magic == TRACE_MAGIC) {
+        dump.assign(raw.begin(), raw.end());
+        return true;
+    }
+    if (!extractSerialDump(raw, dump)) {
+        fprintf(stderr, "%s: neither a binary trace dump nor a serial capture with [TRACE] BEGIN\n",
+                path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ================= OUTPUT =================
+
+struct EventSummary {
+    uint32_t count = 0;
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+};
+
+static const char* argName(TraceEvent e) {
+    switch (e) {
+        case TraceEvent::HTTP_LOG_SYNC:
+        case TraceEvent::HTTP_HEALTH:
+        case TraceEvent::HTTP_HISTORY:
+        case TraceEvent::HTTP_CMD_POLL:
+        case TraceEvent::HTTP_CMD_ACK:
+        case TraceEvent::HTTP_PENDING_PUSH: return "status";
+        case TraceEvent::FLASH_LOG:     return "bytes";
+        case TraceEvent::FLASH_SPILL:   return "samples";
+        case TraceEvent::SPI_READ:      return "card";
+        case TraceEvent::MUTEX_WAIT:    return "acquired";
+        case TraceEvent::DECISION:      return "result";
+        case TraceEvent::QUEUE_SEND:
+        case TraceEvent::QUEUE_RECV:    return "event";
+        default:                        return "arg";
+    }
+}
+
+static int convert(const std::vector<uint8_t>& dump, FILE* out, bool summary) {
+    if (dump.size() < sizeof(TraceDumpHeader)) {
+        fprintf(stderr, "dump too short (%zu bytes)\n", dump.size());
+        return 1;
+    }
+    TraceDumpHeader hdr;
+    memcpy(&hdr, dump.data(), sizeof(hdr));
+    if (hdr.magic != TRACE_MAGIC || hdr.version != TRACE_VERSION ||
+        hdr.recordSize != sizeof(TraceRecord)) {
+        fprintf(stderr, "unsupported dump (magic %08x, version %u, record %u bytes)\n",
+                hdr.magic, hdr.version, hdr.recordSize);
+        return 1;
+    }
+    size_t records = (size_t)hdr.count[0] + hdr.count[1];
+    if (dump.size() < sizeof(hdr) + records * sizeof(TraceRecord)) {
+        fprintf(stderr, "dump truncated: header promises %zu records\n", records);
+        return 1;
+    }
+
+    // micros() wraps every ~71 min; measure everything back from the dump
+    // instant, then shift so the oldest record sits at t = 0
+    struct Row { int64_t rel; TraceRecord rec; uint8_t core; };
+    std::vector<Row> rows;
+    const uint8_t* p = dump.data() + sizeof(hdr);
+    for (uint8_t core = 0; core < 2; core++) {
+        for (uint16_t i = 0; i < hdr.count[core]; i++, p += sizeof(TraceRecord)) {
+            Row r;
+            memcpy(&r.rec, p, sizeof(TraceRecord));
+            r.rel  = (int32_t)(r.rec.startUs - hdr.dumpUs);
+            r.core = core;
+            if (r.rec.event < (uint8_t)TraceEvent::COUNT) rows.push_back(r);
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.rel < b.rel; });
+    int64_t origin = rows.empty() ? 0 : rows.front().rel;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dump_epoch\":%u,\"span_us\":%lld,"
+                 "\"dropped_core0\":%u,\"dropped_core1\":%u},\n\"traceEvents\":[\n",
+            hdr.dumpEpoch, (long long)-origin, hdr.dropped[0], hdr.dropped[1]);
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"emlock\"}},\n");
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Core 0 (cloud)\"}},\n");
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Core 1 (access)\"}}");
+
+    EventSummary sums[(size_t)TraceEvent::COUNT];
+    for (const Row& r : rows) {
+        TraceEvent e = (TraceEvent)r.rec.event;
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                     "\"ts\":%lld,\"dur\":%u,\"args\":{\"%s\":%d}}",
+                TRACE_EVENT_NAMES[r.rec.event][0], TRACE_EVENT_NAMES[r.rec.event][1], r.core,
+                (long long)(r.rel - origin), r.rec.durUs, argName(e), r.rec.arg);
+
+        EventSummary& s = sums[r.rec.event];
+        s.count++;
+        s.totalUs += r.rec.durUs;
+        s.maxUs = std::max(s.maxUs, r.rec.durUs);
+    }
+    fprintf(out, "\n]}\n");
+
+    if (summary) {
+        fprintf(stderr, "  %zu records over %.3f s, dropped %u / %u (core 0 / 1)\n\n",
+                rows.size(), -origin / 1e6, hdr.dropped[0], hdr.dropped[1]);
+        fprintf(stderr, "  %-18s %8s %10s %10s\n", "event", "count", "avg us", "max us");
+        for (size_t i = 0; i < (size_t)TraceEvent::COUNT; i++) {
+            if (!sums[i].count) continue;
+            fprintf(stderr, "  %-18s %8u %10.1f %10u\n", TRACE_EVENT_NAMES[i][0], sums[i].count,
+                    (double)sums[i].totalUs / sums[i].count, sums[i].maxUs);
+        }
+    }
+    return 0;
+}
+
+// ================= MAIN =================
+
+static void usage() {
+    fprintf(stderr, "usage: trace_convert [-o out.json] [--summary] <dump.bin | serial.txt>\n");
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-o" && i + 1 < argc)  opt.output = argv[++i];
+        else if (a == "--summary")      opt.summary = true;
+        else if (a[0] == '-')           { usage(); return 2; }
+        else                            opt.input = a;
+    }
+    if (opt.input.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::vector<uint8_t> dump;
+    if (!loadDump(opt.input, dump)) return 1;
+
+    FILE* out = stdout;
+    if (!opt.output.empty()) {
+        out = fopen(opt.output.c_str(), "w");
+        if (!out) {
+            fprintf(stderr, "cannot write %s\n", opt.output.c_str());
+            return 1;
+        }
+    }
+    int rc = convert(dump, out, opt.summary);
+    if (out != stdout) fclose(out);
+    return rc;
+}